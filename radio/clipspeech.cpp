@@ -0,0 +1,261 @@
+#include "clipspeech.h"
+
+// words of an announcement: "Super E 10 bei Star Tankstelle in Holle jetzt 1 Euro 48 9. "
+constexpr uint32_t clipMaxWords = 32;
+
+ClipSpeech::ClipSpeech() {}
+
+bool ClipSpeech::begin()
+{
+  TRACE();
+
+  File directory = LITTLEFS.open(clipDirectory);
+  if (!directory || !directory.isDirectory())
+  {
+    DEB_PL("CLIPS: no clip library - speech needs the TTS service");
+    return false;
+  }
+  File file = directory.openNextFile();
+  while (file && (numberOfClips < clipTableSize))
+  {
+    char token[clipTokenLength];
+    const char* name = strrchr(file.name(), '/');
+    name = name ? name + 1 : file.name();
+    const char* extension = strrchr(name, '.');
+    size_t length = extension ? extension - name : 0;
+    if ((length > 0) && (length < clipTokenLength) && (strcmp(extension, ".mp3") == 0))
+    {
+      memcpy(token, name, length);
+      token[length] = 0;
+      // insert sorted by hash
+      uint32_t hash = getHash(token);
+      uint32_t index = numberOfClips;
+      while ((index > 0) && (clips[index - 1].hash > hash))
+      {
+        clips[index] = clips[index - 1];
+        index--;
+      }
+      clips[index].hash = hash;
+      clips[index].size = file.size();
+      numberOfClips++;
+    }
+    file.close();
+    file = directory.openNextFile();
+  }
+  directory.close();
+  DEB_PF("CLIPS: %u clips in %s\n", numberOfClips, clipDirectory);
+  return numberOfClips > 0;
+}
+
+uint32_t ClipSpeech::getHash(const char* token)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (const char* character = token; *character; character++)
+  {
+    hash = (hash ^ (uint8_t)*character) * 16777619UL;
+  }
+  return hash;
+}
+
+int32_t ClipSpeech::findClip(const char* token)
+{
+  // binary search in the sorted table
+  uint32_t hash = getHash(token);
+  int32_t low = 0;
+  int32_t high = (int32_t)numberOfClips - 1;
+  while (low <= high)
+  {
+    int32_t middle = (low + high) / 2;
+    if (clips[middle].hash == hash)
+    {
+      return middle;
+    }
+    if (clips[middle].hash < hash)
+      low = middle + 1;
+    else
+      high = middle - 1;
+  }
+  return -1;
+}
+
+uint32_t ClipSpeech::splitWords(const char* text, char words[][clipTokenLength], uint32_t maxWords)
+{
+  // lower case words; separators are blanks and punctuation (UTF-8 characters are kept)
+  uint32_t numberOfWords = 0;
+  size_t length = 0;
+
+  for (const char* character = text; ; character++)
+  {
+    bool isSeparator = (*character == 0) || (*character == ' ') || (*character == '.') || (*character == ',') ||
+                       (*character == '-') || (*character == '/');
+    if (!isSeparator)
+    {
+      if ((length < clipTokenLength - 1) && (numberOfWords < maxWords))
+      {
+        words[numberOfWords][length++] = tolower((uint8_t)*character);
+      }
+      continue;
+    }
+    if ((length > 0) && (numberOfWords < maxWords))
+    {
+      words[numberOfWords][length] = 0;
+      numberOfWords++;
+    }
+    length = 0;
+    if (*character == 0)
+    {
+      break;
+    }
+  }
+  return numberOfWords;
+}
+
+uint32_t ClipSpeech::matchPhrase(char words[][clipTokenLength], uint32_t numberOfWords, uint32_t first, char* token)
+{
+  // longest phrase starting at first that has a clip; returns number of words used (0: no clip)
+  uint32_t maxWords = min(clipMaxPhraseWords, numberOfWords - first);
+  for (uint32_t phraseWords = maxWords; phraseWords > 0; phraseWords--)
+  {
+    token[0] = 0;
+    bool isTooLong = false;
+    for (uint32_t count = 0; count < phraseWords; count++)
+    {
+      if (strlen(token) + strlen(words[first + count]) + 2 > clipTokenLength)
+      {
+        isTooLong = true;
+        break;
+      }
+      if (count)
+        strcat(token, "_");
+      strcat(token, words[first + count]);
+    }
+    if (!isTooLong && (findClip(token) >= 0))
+    {
+      return phraseWords;
+    }
+  }
+  strcpy(token, words[first]);
+  return 0;
+}
+
+bool ClipSpeech::appendClip(File& output, const char* token)
+{
+  char fileName[clipTokenLength + sizeof(clipDirectory) + 6];
+  uint8_t buffer[clipCopyBufferSize];
+
+  snprintf(fileName, sizeof(fileName), "%s/%s.mp3", clipDirectory, token);
+  File clip = LITTLEFS.open(fileName);
+  if (!clip)
+  {
+    return false;
+  }
+  size_t start = 0;
+  size_t end = clip.size();
+  // ID3v2 at the start (10 bytes header + syncsafe size), ID3v1 at the end (128 bytes "TAG...")
+  if ((clip.read(buffer, 10) == 10) && (memcmp(buffer, "ID3", 3) == 0))
+  {
+    start = 10 + ((buffer[6] & 0x7F) << 21) + ((buffer[7] & 0x7F) << 14) + ((buffer[8] & 0x7F) << 7) + (buffer[9] & 0x7F);
+  }
+  if ((end >= start + 128) && clip.seek(end - 128) && (clip.read(buffer, 3) == 3) && (memcmp(buffer, "TAG", 3) == 0))
+  {
+    end -= 128;
+  }
+  clip.seek(start);
+  size_t remaining = end > start ? end - start : 0;
+  while (remaining)
+  {
+    size_t length = clip.read(buffer, min(remaining, sizeof(buffer)));
+    if (length == 0)
+    {
+      break;
+    }
+    output.write(buffer, length);
+    remaining -= length;
+  }
+  clip.close();
+  return remaining == 0;
+}
+
+bool ClipSpeech::compose(const char* text, const char* fileName)
+{
+  // false: a word has no clip - nothing is written, the caller uses TTS
+  char words[clipMaxWords][clipTokenLength];
+  char tokens[clipMaxWords][clipTokenLength];
+  uint32_t numberOfTokens = 0;
+
+  if (numberOfClips == 0)
+  {
+    return false;
+  }
+  unsigned long startTime = millis();
+  uint32_t numberOfWords = splitWords(text, words, clipMaxWords);
+  if (numberOfWords >= clipMaxWords)
+  {
+    // may be cut off
+    incompleteCount++;
+    return false;
+  }
+  for (uint32_t first = 0; first < numberOfWords; numberOfTokens++)
+  {
+    uint32_t used = matchPhrase(words, numberOfWords, first, tokens[numberOfTokens]);
+    if (used == 0)
+    {
+      DEB_PF("CLIPS: no clip for '%s'\n", tokens[numberOfTokens]);
+      incompleteCount++;
+      return false;
+    }
+    first += used;
+  }
+
+  File output = LITTLEFS.open(fileName, "w");
+  if (!output)
+  {
+    return false;
+  }
+  bool isComplete = true;
+  for (uint32_t count = 0; isComplete && (count < numberOfTokens); count++)
+  {
+    isComplete = appendClip(output, tokens[count]);
+  }
+  lastComposeSize = output.size();
+  output.close();
+  if (!isComplete)
+  {
+    incompleteCount++;
+    return false;
+  }
+  composeCount++;
+  lastComposeTime = millis() - startTime;
+  DEB_PF("CLIPS: %u clips composed in %lu ms (%u bytes)\n", numberOfTokens, lastComposeTime, lastComposeSize);
+  return true;
+}
+
+uint32_t ClipSpeech::check(const char* text)
+{
+  char words[clipMaxWords][clipTokenLength];
+  char token[clipTokenLength];
+  uint32_t missing = 0;
+
+  uint32_t numberOfWords = splitWords(text, words, clipMaxWords);
+  for (uint32_t first = 0; first < numberOfWords; )
+  {
+    uint32_t used = matchPhrase(words, numberOfWords, first, token);
+    if (used == 0)
+    {
+      DEB_PF("    missing clip       : %s/%s.mp3\n", clipDirectory, token);
+      missing++;
+      used = 1;
+    }
+    first += used;
+  }
+  return missing;
+}
+
+void ClipSpeech::debugPrint()
+{
+  DEB_PL("Clip speech:");
+  DEB_PF("    clips              : %u\n", numberOfClips);
+  DEB_PF("    composed           : %u (%u incomplete texts)\n", composeCount, incompleteCount);
+  DEB_PF("    last composition   : %lu ms, %u bytes\n", lastComposeTime, lastComposeSize);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+#include <LITTLEFS.h>
+
+#include "trace.h"
+#include "config.h"
+
+
+class ClipSpeech
+{
+    /*
+       Offline speech: an announcement is composed from recorded MP3 clips in clipDirectory
+
+       Clip names are the lower case words of the text: "diesel.mp3", "bei.mp3", "48.mp3", ...
+       Names of several words are joined by '_' ("star_tankstelle.mp3") and win over single words.
+       compose() copies the clips (without ID3 tags) one after the other into a file
+       so the VS1053 gets one continuous MP3 stream without a gap between the clips.
+
+       The clip names are hashed into a sorted table once by begin() - lookups need no file access.
+    */
+  public:
+    ClipSpeech();
+
+    bool begin();
+    bool compose(const char* text, const char* fileName);
+    uint32_t check(const char* text);   // number of words without clip (printed)
+
+    void debugPrint();
+
+  private:
+    struct Clip
+    {
+      uint32_t hash;
+      uint32_t size;
+    };
+    Clip clips[clipTableSize];
+    uint32_t numberOfClips = 0;
+
+    uint32_t composeCount = 0;
+    uint32_t incompleteCount = 0;
+    unsigned long lastComposeTime = 0;
+    uint32_t lastComposeSize = 0;
+
+    static uint32_t getHash(const char* token);
+    static uint32_t splitWords(const char* text, char words[][clipTokenLength], uint32_t maxWords);
+    int32_t findClip(const char* token);
+    uint32_t matchPhrase(char words[][clipTokenLength], uint32_t numberOfWords, uint32_t first, char* token);
+    bool appendClip(File& output, const char* token);
+};
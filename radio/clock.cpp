@@ -60,50 +60,40 @@ const char* Clock::getWeekday()
   return weekdayText[clockTim.tm_wday];
 }
 
-bool Clock::secondEventStatus()
+ClockEvent Clock::eventStatus()
 {
-  if (secondEvent == true)
-  {
-    secondEvent = false;
-    return true;
-  }
-  return false;
-}
+  ClockEvent event;
 
-bool Clock::ntpEventStatus()
-{
-  if (ntpEvent == true)
+  if (!events.pop(event) && !simulatedEvents.pop(event))
   {
-    ntpEvent = false;
-    return true;
+    return ClockEvent::NONE;
   }
-  return false;
-}
-
-bool Clock::fuelEventStatus()
-{
-  if (fuelEvent == true)
+  if (event == ClockEvent::FUEL)
   {
-    fuelEvent = false;
     resetFuelEventInterval = true;
-    return true;
   }
-  return false;
+  return event;
 }
 
+// called by clockTask only
 void Clock::setSecondEvent()
 {
-  secondEvent = true;
+  events.push(ClockEvent::SECOND);
 }
 
 void Clock::setNtpEvent()
 {
-  ntpEvent = true;
+  events.push(ClockEvent::NTP);
 }
 
 void Clock::setFuelEvent()
 {
-  fuelEvent = true;
+  events.push(ClockEvent::FUEL);
+}
+
+void Clock::simulateFuelEvent()
+{
+  simulatedEvents.push(ClockEvent::FUEL);
 }
 
 
@@ -114,9 +104,8 @@ void Clock::off()
     // responses from display are handled in update
     vTaskDelete(clockTaskHandle);
     clockTaskHandle = NULL;
-    secondEvent = false;
-    ntpEvent = false;
-    fuelEvent = false;
+    events.clear();
+    simulatedEvents.clear();
   }
   statusOn = false;
   DEB_PL("CLOCK: clock is off");
@@ -127,10 +116,24 @@ bool Clock::isOn()
   return statusOn;
 }
 
+TaskLoad& Clock::getTaskLoad()
+{
+  return taskLoad;
+}
+
+void Clock::debugPrint()
+{
+  DEB_PL("Clock:");
+  DEB_PF("    pending events     : %u\n", events.size());
+  DEB_PF("    lost events        : %u\n", events.getOverflowCount());
+  taskLoad.debugPrint("clock task");
+}
+
 // ==================================================================================
 void clockTask(void* parameters)
 {
   Clock* theClock = (Clock*)parameters;
+  TaskLoad& load = theClock->getTaskLoad();
   unsigned long currentTime = millis();
   unsigned long lastTimeRead = currentTime;
   unsigned long lastTimeNtpRead = currentTime;
@@ -149,6 +152,7 @@ void clockTask(void* parameters)
   theClock->setNtpEvent();
   theClock->setFuelEvent();
 
+  load.begin();
   while (1)
   {
     currentTime = millis();
@@ -185,7 +189,9 @@ void clockTask(void* parameters)
       }
     }
 
+    load.end();
     delay(6);
+    load.begin();
   }
 
   // emergency case:
@@ -3,9 +3,12 @@
 
 #include "trace.h"
 #include "config.h"
+#include "monitor.h"
+#include "eventqueue.h"
 
 #include <time.h>
 
+enum class ClockEvent { NONE, SECOND, NTP, FUEL };
 
 class Clock
 {
@@ -18,23 +21,25 @@ class Clock
     uint8_t getSecond();
     char* getDate();
     const char* getWeekday();
-    bool secondEventStatus();
-    bool ntpEventStatus();
-    bool fuelEventStatus();
+    ClockEvent eventStatus();
     void setSecondEvent();
     void setNtpEvent();
     void setFuelEvent();
+    void simulateFuelEvent();   // test input from loop()
     void off();
     bool isOn();
     void forceUpdate();
+    TaskLoad& getTaskLoad();
+    void debugPrint();
 
     bool resetFuelEventInterval = false;
 
   private:
     TaskHandle_t clockTaskHandle = NULL;
-    bool secondEvent = false;
-    bool ntpEvent = false;
-    bool fuelEvent = false;
+    TaskLoad taskLoad;
+    // single producer clockTask - test input uses its own queue, produced and consumed by loop()
+    EventQueue<ClockEvent, clockEventQueueLength> events;
+    EventQueue<ClockEvent, clockEventQueueLength> simulatedEvents;
     char dateText[11];    // dd.mm.yyyy
     bool statusOn = true;
 };
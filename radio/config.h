@@ -10,6 +10,14 @@ constexpr char networkCredentialsFile[] = "/network.json";
 constexpr char fuelDataFile[] = "/tanken.json";
 constexpr char nextionTftFile[] = "/radio.tft";
 constexpr char gongFile[] = "/gong.mp3";
+constexpr char eventScriptFile[] = "/events.txt";
+constexpr char urlCacheFile[] = "/urlcache.json";
+constexpr char ttsCacheDirectory[] = "/tts";
+constexpr char ttsCacheIndexFile[] = "/tts/index.json";
+constexpr char clipDirectory[] = "/clips";               // <word>.mp3 or <word>_<word>.mp3 (lower case)
+constexpr char historyDirectory[] = "/history";         // price history segments <sequence>.bin
+constexpr char priceStatisticsFile[] = "/fuelstats.bin";
+constexpr char clipSpeechFileFormat[] = "/speech%d.mp3";  // announcements composed from clips (0 and 1)
 // nvs
 constexpr char settingsNamespace[] = "settings";
 constexpr char settingsKeyCurrentStation[] = "CurrStatIdx";
@@ -21,7 +29,13 @@ constexpr char settingsKeyLimitSuperE10[] = "LimitE10";
 // json decoding
 constexpr uint32_t jsonRadioStationListDocSize = 2048;
 constexpr uint32_t jsonNetworkListDocSize = 256;
-constexpr uint32_t jsonFuelStationListDocSize = 1024;
+constexpr uint32_t jsonFuelStationListDocFactor = 2;       // document bytes per byte of tanken.json (strings are not copied)
+constexpr uint32_t jsonUrlCacheDocSize = 8192;
+constexpr uint32_t jsonTtsCacheDocSize = 2048;
+//    Tankerkoenig price response (document size is calculated from the number of stations)
+constexpr size_t fuelStationIdLength = 37;             // UUID + '\0'
+constexpr size_t fuelStationStatusLength = 10;         // "no prices" + '\0'
+constexpr size_t fuelMessageLength = 128;              // error message ("ok":false)
 
 // nextion upload
 constexpr size_t segmentSize = 4096;
@@ -34,17 +48,54 @@ constexpr unsigned long ntpUpdateInterval = (123UL);    // in seconds (~2min)
 //constexpr unsigned long ntpUpdateInterval = (987UL);    // in seconds (~17min)
 // https://github.com/nayarsystems/posix_tz_db/blob/master/zones.csv
 constexpr char ntpTimeszone[] = "CET-1CEST,M3.5.0/02,M10.5.0/03";
+constexpr uint32_t clockEventQueueLength = 16;                      // power of two
 
 // HMI et al
 constexpr uint8_t numberOfStationKeys = 6;
 constexpr int32_t nextionBufferSize = 32;
+constexpr size_t  nextionCommandBufferSize = 512;
+constexpr uint8_t nextionShadowSize = 24;
+constexpr size_t  nextionShadowNameLength = 20;            // "priceDiesel.click" + '\0'
+constexpr size_t  nextionShadowValueLength = 50;           // quoted cheapest text (cheapestTextLength) + '\0'; longer values are not shadowed
+constexpr uint8_t nextionEventQueueLength = 8;
+constexpr unsigned long nextionReceivePollInterval = 10;   // milliseconds (~10 bytes at 9600bps)
+constexpr unsigned long nextionValueTimeout = 500;         // milliseconds
 constexpr int8_t  numberOfDebugLines = 8;
 constexpr uint8_t vs1053MaxVolume = 21;
 constexpr uint8_t defaultVolume = 16; // Headphones: 5-8  amplifier connected: 12-18
+constexpr uint32_t audioFeedTaskStackSize = 10240;
+constexpr uint32_t audioFeedTaskPriority = 3;          // loop() runs with priority 1
+constexpr int audioFeedTaskCore = 0;
+constexpr uint32_t audioFeedInterval = 1;              // ticks (1ms) between two calls of mp3.loop()
+//    stream statistics per station
+constexpr unsigned long streamRateInterval = 1000;      // ms: window for the data rate estimate
+//    resolved stream URLs (playlists, redirects)
+constexpr size_t stationUrlLength = 256;
+constexpr time_t urlCacheTtl = (7 * 24 * 3600);          // seconds
+constexpr time_t urlCacheValidTime = 1600000000;         // earlier time stamps: clock not set
+//    warm standby: next, previous and last key station are resolved in the background (playlists, redirects)
+constexpr bool standbyDefault = true;                   // serial command 'w' toggles
+constexpr uint32_t standbyMaxStations = 3;              // in order next, last key, previous
+constexpr uint32_t standbyMinFreeHeap = 60000;          // bytes: memory budget - no standby preparation below
+constexpr uint32_t standbyTaskStackSize = 8192;
+constexpr uint32_t standbyTaskPriority = 1;
+constexpr int standbyTaskCore = 0;
+constexpr unsigned long standbyDelay = 3000;            // ms the station must stay selected before neighbours are prepared
+constexpr unsigned long standbyValidTime = (10 * 60 * 1000UL);   // ms
+constexpr uint16_t standbyHttpTimeout = 2000;           // ms
+constexpr uint32_t standbyMaxRedirects = 3;
+constexpr int standbyPlaylistLength = 2048;             // bytes; larger playlists are not parsed
+constexpr unsigned long stationScrollSettleTime = 800;  // ms without encoder turn before the previewed station is connected
+//    DNS prefetch: hosts are resolved before the connect, lwIP keeps the answers for their TTL
+constexpr size_t dnsHostLength = 64;
+constexpr unsigned long dnsHitTime = 5;                 // ms: faster lookups were answered by the lwIP table
 constexpr int32_t brightnessInterval = 5;
 constexpr int32_t brightnessWhenOff = 10;
 constexpr int32_t titleTextLength = 96;
 
+// profiler
+constexpr uint32_t profilerHistogramBuckets = 24;     // log2 buckets: up to 2^23us (~8s)
+
 enum class Pages { DEBUG, PLAYER, CLOCK, FUEL, DOWNLOAD };
 constexpr Pages   startPage = Pages::CLOCK;
 
@@ -68,6 +119,7 @@ constexpr uint8_t encDT     = 26;  // GPIO26   Rotary encoder DT
 constexpr uint8_t encSW     = 27;  // GPIO27   Rotary encoder SW
 constexpr unsigned long encoderSwitchDebounceInterval = 5;          // milliseconds
 constexpr unsigned long encoderSwitchLongPressInterval = (2000);    // milliseconds
+constexpr uint32_t encoderEventQueueLength = 32;                    // power of two
 
 // Tankerkoenig
 constexpr unsigned long fuelUpdateInterval = 678UL;    // in seconds (~11.3min)
@@ -78,8 +130,60 @@ constexpr int32_t initialLimitSuperE10 = 187;
 constexpr uint8_t fuelScanStartHour =   6;   // starts at   ">="
 constexpr uint8_t fuelScanEndHour   =  22;   // ends before "<"
 constexpr bool enableFuelPriceScanWhileOff = true;
+//    alarm rules of tanken.json, in addition to the limits set on the FUEL page
+constexpr uint32_t fuelRulesPerSlot = 4;               // rules per station and fuel type
+constexpr time_t fuelAverageTime = (7 * 24 * 3600);    // seconds: time constant of the moving average
+constexpr time_t fuelAverageMinAge = (24 * 3600);      // seconds of samples before "belowAverage" is used
+//    alarm changes
+constexpr int16_t fuelAlarmHysteresis = 10;            // tenth cent: an active alarm is cleared at limit + band
+constexpr unsigned long fuelReannounceInterval = (60 * 60 * 1000UL);   // ms: same station and fuel type announced again
+constexpr uint32_t fuelAlarmListLength = 16;           // entries of the new and cleared alarm lists
 constexpr bool enableSpeechOutput = true;
+constexpr char speechLanguage[] = "de";
+//    speech cache: MP3 of announced texts in LITTLEFS, least recently used are removed first
+constexpr char ttsUrl[] = "https://translate.google.com/translate_tts?ie=UTF-8&client=tw-ob&tl=%s&q=%s";   // same service as vs1053_ext
+constexpr size_t ttsUrlLength = 1024;                  // url + percent encoded alarm text
+constexpr size_t ttsFileNameLength = 20;               // "/tts/0123abcd.mp3"
+constexpr size_t ttsLanguageLength = 8;
+constexpr uint32_t ttsCacheEntries = 32;
+constexpr uint32_t ttsCacheBudget = (256 * 1024);      // bytes of all cached files
+constexpr uint32_t ttsDownloadQueueLength = 4;
+constexpr uint16_t ttsHttpTimeout = 5000;              // ms
+constexpr uint32_t ttsTaskStackSize = 10240;
+constexpr uint32_t ttsTaskPriority = 1;
+constexpr int ttsTaskCore = 0;
+//    offline speech: announcements composed from recorded clips, TTS only if a clip is missing
+constexpr bool enableClipSpeech = true;
+constexpr uint32_t clipTableSize = 256;
+constexpr size_t clipTokenLength = 48;                 // longest clip name without ".mp3"
+constexpr uint32_t clipMaxPhraseWords = 3;             // "super_e_10", "star_tankstelle"
+constexpr size_t clipCopyBufferSize = 1024;
+constexpr uint32_t announcementQueueLength = 1 + fuelAlarmListLength;   // gong + one speech per new alarm of a cycle
 constexpr bool UseTankerkoenigFakeValues = false;
+constexpr char fuelPricesUrl[] = "https://creativecommons.tankerkoenig.de/json/prices.php";
+constexpr uint32_t fuelRequestMaxStations = 10;        // API limit of ids per request
+constexpr size_t fuelRequestUrlLength = 512;           // url + 10 ids + api key
+constexpr size_t fuelHostLength = 64;
+//    price history: fixed size delta records, one write per update cycle
+constexpr uint32_t historySegmentSize = (32 * 1024);   // bytes; a new segment is started above
+constexpr uint32_t historyMaxSegments = 8;             // oldest segment is removed
+constexpr uint32_t historyMaxStations = 32;
+constexpr size_t historyReadBufferSize = 256;          // bytes read at once by PriceHistoryReader
+//    hour-of-week statistics: min and mean per station, fuel type and hour of the scan window
+//    RAM: stations * 3 * slots * 6 bytes (~2KB per station)
+constexpr uint32_t statisticsHoursPerDay = fuelScanEndHour - fuelScanStartHour;   // no prices outside of the scan window
+constexpr uint32_t statisticsSlots = 7 * statisticsHoursPerDay;
+constexpr size_t statisticsBudget = (32 * 1024);       // bytes: 16 stations; further stations of tanken.json show "keine Prognose"
+constexpr uint16_t statisticsMaxCount = 32;            // mean follows later changes: older samples weigh like 32
+constexpr uint16_t statisticsMinCount = 2;             // samples needed before a slot is used for prediction
+constexpr size_t cheapestTextLength = 48;
+//    price update task
+constexpr uint32_t fuelTaskStackSize = 10240;
+constexpr int fuelTaskCore = 0;                        // loop() runs on core 1
+constexpr uint16_t fuelHttpTimeout = 5000;             // milliseconds
+constexpr uint32_t fuelUpdateAttempts = 3;             // first try + 2 retries
+constexpr unsigned long fuelUpdateRetryDelay = 5000;   // milliseconds
+constexpr uint32_t fuelMaxFailedUpdates = 2;           // failed updates in a row before all stations are handled as closed
 
 
 //=====================================================================================================
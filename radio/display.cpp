@@ -5,7 +5,6 @@
 //#define VERBOSE_UTF_ISO_CONVERSION
 #include "display.h"
 
-SemaphoreHandle_t displayMutex;
 void displayReceiveTask(void* parameters);
 
 Display::Display() {};
@@ -20,7 +19,8 @@ void Display::begin(uint8_t rx, uint8_t tx)
   Serial2.begin(9600, SERIAL_8N1, rxPin, txPin);
   delay(100);
 
-  displayMutex = xSemaphoreCreateMutex();
+  eventQueue = xQueueCreate(nextionEventQueueLength, sizeof(DisplayEvent));
+  valueQueue = xQueueCreate(2, sizeof(int32_t));
   xTaskCreate(    displayReceiveTask,   /* Task function. */
                   "NextRecv",           /* String with name of task. */
                   4096,                 /* Stack size in bytes. */
@@ -39,44 +39,49 @@ void Display::begin(uint8_t rx, uint8_t tx)
 void Display::selectPage(Pages page)
 {
   TRACE();
-  Serial2.print("page ");
+  int32_t pageNumber = 0;
   switch (page)
   {
     case Pages::DEBUG:
       DEB_PL("page DEBUG");
-      Serial2.print(0);
+      pageNumber = 0;
       break;
     case Pages::PLAYER:
-      Serial2.print(1);
+      pageNumber = 1;
       DEB_PL("page PLAYER");
       break;
     case Pages::CLOCK:
-      Serial2.print(2);
+      pageNumber = 2;
       DEB_PL("page CLOCK");
       break;
     case Pages::FUEL:
-      Serial2.print(3);
+      pageNumber = 3;
       DEB_PL("page FUEL");
       break;
     // fuel limits is page #4
     case Pages::DOWNLOAD:
       DEB_PL("page DOWNLOAD");
-      Serial2.print(5);
+      pageNumber = 5;
       break;
   }
-  endCommand();
+  // the page command and the initialisation of the page may need several writes (buffer full)
+  pageSwitchPending = true;
+  pageSwitchStart = commandLength;
+  lastPageSwitchBytes = 0;
+  queueCommand("page %d", pageNumber);
+  // all components of the new page show their default values
+  clearShadow();
   currentPage = page;
 }
 
 void Display::off()
 {
+  flush();
   if (receiveTaskHandle != NULL)
   {
     // responses from display are handled in update
-    xSemaphoreTake(displayMutex, portMAX_DELAY);
     vTaskDelete(receiveTaskHandle);
     receiveTaskHandle = NULL;
-    xSemaphoreGive(displayMutex);
   }
   DEB_PL("display is off");
 }
@@ -92,8 +97,7 @@ void Display::debug(const char* text, bool appendText)
   if (currentPage == Pages::DEBUG)
   {
     adjustDebugLine(appendText);
-    Serial2.printf("t%d.txt%s=\"%s\"", currentDebugLine, (appendText ? "+" : ""), text);
-    endCommand();
+    queueCommand("t%d.txt%s=\"%s\"", currentDebugLine, (appendText ? "+" : ""), text);
     currentDebugLine++;
   }
   DEB_PF("DISPLAY%c debug '%s'\n", (appendText ? '+' : ':'), text);
@@ -104,8 +108,7 @@ void Display::debug(const int32_t value, bool appendValue)
   if (currentPage == Pages::DEBUG)
   {
     adjustDebugLine(appendValue);
-    Serial2.printf("t%d.txt%s=\"%d\"", currentDebugLine, (appendValue ? "+" : ""), value);
-    endCommand();
+    queueCommand("t%d.txt%s=\"%d\"", currentDebugLine, (appendValue ? "+" : ""), value);
     currentDebugLine++;
   }
   DEB_PF("DISPLAY%c debug '%d'\n", (appendValue ? '+' : ':'), value);
@@ -116,8 +119,7 @@ void Display::debug(const size_t value, bool appendValue)
   if (currentPage == Pages::DEBUG)
   {
     adjustDebugLine(appendValue);
-    Serial2.printf("t%d.txt%s=\"%zu\"", currentDebugLine, (appendValue ? "+" : ""), value);
-    endCommand();
+    queueCommand("t%d.txt%s=\"%zu\"", currentDebugLine, (appendValue ? "+" : ""), value);
     currentDebugLine++;
   }
   DEB_PF("DISPLAY%c debug '%zu'\n", (appendValue ? '+' : ':'), value);
@@ -131,8 +133,7 @@ void Display::adjustDebugLine(bool append)
     if (currentDebugLine == numberOfDebugLines)
     {
       // move all texts one line up
-      Serial2.printf("click scroll,1");
-      endCommand();
+      queueCommand("click scroll,1");
       currentDebugLine = numberOfDebugLines - 1;
     }
   }
@@ -151,6 +152,215 @@ void Display::endCommand()
   Serial2.write(0xFF);
 }
 
+void Display::queueCommand(const char* format, ...)
+{
+  va_list arguments;
+
+  va_start(arguments, format);
+  appendCommand(NULL, format, arguments);
+  va_end(arguments);
+}
+
+void Display::appendCommand(const char* component, const char* format, va_list arguments)
+{
+  // Commands are collected in commandBuffer (including the 0xFF 0xFF 0xFF terminator)
+  // and sent with a single write by flush(). Outside of a batch every command is sent immediately.
+  // component: prefix "component=" of an assignment, NULL for other commands
+  for (int8_t attempt = 0; attempt < 2; attempt++)
+  {
+    size_t space = nextionCommandBufferSize - commandLength;
+    int prefixLength = 0;
+    if (component != NULL)
+    {
+      prefixLength = snprintf(&commandBuffer[commandLength], space, "%s=", component);
+    }
+    int length = -1;
+    if ((prefixLength >= 0) && ((size_t)prefixLength < space))
+    {
+      va_list copy;
+      va_copy(copy, arguments);
+      length = vsnprintf(&commandBuffer[commandLength + prefixLength], space - prefixLength, format, copy);
+      va_end(copy);
+    }
+
+    if ((length >= 0) && ((size_t)(prefixLength + length) + 3 <= space))
+    {
+      commandLength += prefixLength + length;
+      commandBuffer[commandLength++] = 0xFF;
+      commandBuffer[commandLength++] = 0xFF;
+      commandBuffer[commandLength++] = 0xFF;
+      if (batchLevel == 0)
+      {
+        flush();
+      }
+      return;
+    }
+    if (commandLength == 0)
+    {
+      // does not even fit into an empty buffer
+      break;
+    }
+    // buffer full: send what is there and try again
+    flush();
+  }
+  DEB_PF("DISPLAY: command too long for buffer of %zu bytes - dropped\n", nextionCommandBufferSize);
+}
+
+void Display::queueValue(const char* component, const char* format, ...)
+{
+  // Assignment "component=value" which is only sent if the value differs from what has
+  // been sent to this component since the last page switch. Values too long for the
+  // shadow (titles) are not tracked and always sent.
+  char value[nextionShadowValueLength];
+  va_list arguments;
+
+  va_start(arguments, format);
+  va_list copy;
+  va_copy(copy, arguments);
+  int length = vsnprintf(value, sizeof(value), format, copy);
+  va_end(copy);
+
+  if ((length >= 0) && ((size_t)length < sizeof(value)))
+  {
+    if (!isUnchanged(component, value))
+    {
+      queueCommand("%s=%s", component, value);
+    }
+  }
+  else
+  {
+    forgetValue(component);
+    appendCommand(component, format, arguments);
+  }
+  va_end(arguments);
+}
+
+Display::ShadowEntry* Display::findShadow(const char* component)
+{
+  for (uint8_t count = 0; count < shadowCount; count++)
+  {
+    if (strcmp(shadow[count].component, component) == 0)
+    {
+      return &shadow[count];
+    }
+  }
+  return NULL;
+}
+
+bool Display::isUnchanged(const char* component, const char* value)
+{
+  // value is shorter than nextionShadowValueLength (checked by queueValue)
+  ShadowEntry* entry = findShadow(component);
+
+  if (entry != NULL)
+  {
+    if (strcmp(entry->value, value) == 0)
+    {
+      suppressedCount++;
+      return true;
+    }
+    strcpy(entry->value, value);
+    return false;
+  }
+  if ((shadowCount < nextionShadowSize) && (strlen(component) < nextionShadowNameLength))
+  {
+    strcpy(shadow[shadowCount].component, component);
+    strcpy(shadow[shadowCount].value, value);
+    shadowCount++;
+  }
+  // shadow full or name too long: component is not tracked and always sent
+  return false;
+}
+
+void Display::forgetValue(const char* component)
+{
+  // the display shows a value the shadow does not know: the next short value has to be sent
+  ShadowEntry* entry = findShadow(component);
+
+  if (entry != NULL)
+  {
+    *entry = shadow[--shadowCount];
+  }
+}
+
+void Display::clearShadow()
+{
+  shadowCount = 0;
+}
+
+void Display::flush()
+{
+  if (commandLength == 0)
+  {
+    return;
+  }
+
+  unsigned long startTime = micros();
+  Serial2.write((const uint8_t*)commandBuffer, commandLength);
+  unsigned long flushTime = micros() - startTime;
+
+  bytesSent += commandLength;
+  flushCount++;
+  lastFlushTime = flushTime;
+  if (flushTime > maxFlushTime)
+    maxFlushTime = flushTime;
+  if (pageSwitchPending)
+  {
+    // all writes of the batch that switched the page: page command and initialisation of the page
+    lastPageSwitchBytes += commandLength - pageSwitchStart;
+    pageSwitchStart = 0;
+    if (batchLevel == 0)
+    {
+      pageSwitchPending = false;
+    }
+  }
+  commandLength = 0;
+}
+
+void Display::beginBatch()
+{
+  batchLevel++;
+}
+
+void Display::endBatch()
+{
+  if (batchLevel > 0)
+  {
+    batchLevel--;
+  }
+  if (batchLevel == 0)
+  {
+    flush();
+  }
+}
+
+uint32_t Display::getBytesSent()
+{
+  return bytesSent;
+}
+
+size_t Display::getLastPageSwitchBytes()
+{
+  return lastPageSwitchBytes;
+}
+
+unsigned long Display::getMaxFlushTime()
+{
+  return maxFlushTime;
+}
+
+void Display::debugPrint()
+{
+  DEB_PL("Display:");
+  DEB_PF("    bytes sent         : %u in %u writes\n", bytesSent, flushCount);
+  DEB_PF("    last page switch   : %zu bytes\n", lastPageSwitchBytes);
+  DEB_PF("    suppressed (shadow): %u commands\n", suppressedCount);
+  DEB_PF("    flush time         : last %lu us  max %lu us\n", lastFlushTime, maxFlushTime);
+  DEB_PF("    events lost        : %u\n", lostEventCount);
+  DEB_PF("    return codes       : %u\n", returnCodeCount);
+  receiveTaskLoad.debugPrint("receive task");
+}
+
 void Display::setStation(const char* stationName)
 {
   TRACE();
@@ -161,8 +371,7 @@ void Display::setStation(const char* stationName)
   {
     case Pages::PLAYER:
     case Pages::FUEL:
-      Serial2.printf("station.txt=\"%s\"", textBuffer);
-      endCommand();
+      queueValue("station.txt", "\"%s\"", textBuffer);
       DEB_PF("DISPLAY: set stationName '%s'\n", textBuffer);
       break;
     case Pages::DEBUG:
@@ -297,8 +506,7 @@ void Display::setTitle(const char* titleText)
 
   if (currentPage == Pages::PLAYER)
   {
-    Serial2.printf("title.txt=\"%s\"", (char*)textBuffer);
-    endCommand();
+    queueValue("title.txt", "\"%s\"", (char*)textBuffer);
   }
 #if defined (VERBOSE_UTF_ISO_CONVERSION)
   DEB_PL();
@@ -310,8 +518,9 @@ void Display::setKeyText(const uint8_t key, const char* text)
 {
   if (currentPage == Pages::PLAYER)
   {
-    Serial2.printf("key%d.txt=\"%s\"", key, text);
-    endCommand();
+    char component[16];
+    snprintf(component, sizeof(component), "key%d.txt", key);
+    queueValue(component, "\"%s\"", text);
   }
   DEB_PF("DISPLAY: player.key key=%d '%s'\n", key, text);
 }
@@ -321,11 +530,14 @@ void Display::deactivateKeys(const uint8_t number)
   DEB_PL("DISPLAY: deactivate all keys");
   if (currentPage == Pages::PLAYER)
   {
+    beginBatch();
     for (uint8_t count = 1; count < number; count++)
     {
-      Serial2.printf("key%d.bco=%d", count, 19049);
-      endCommand();
+      char component[16];
+      snprintf(component, sizeof(component), "key%d.bco", count);
+      queueValue(component, "%d", 19049);
     }
+    endBatch();
   }
 }
 
@@ -334,8 +546,9 @@ void Display::activateKey(const uint8_t key, const bool activate)
   if (currentPage == Pages::PLAYER)
   {
     // TODO: get colors from display
-    Serial2.printf("key%d.bco=%d", key, activate ? 396 : 19049);
-    endCommand();
+    char component[16];
+    snprintf(component, sizeof(component), "key%d.bco", key);
+    queueValue(component, "%d", activate ? 396 : 19049);
   }
   DEB_PF("DISPLAY: player.activateKey index=%d '%s'\n", key, activate ? "ACTIVE" : "inactive");
 }
@@ -366,37 +579,29 @@ int32_t Display::setBrightness(int32_t value)
 
   // send to display
   DEB_PF("brightness set to %d\n", brightness);
-  Serial2.printf("dim=%d", brightness);
-  endCommand();
+  queueCommand("dim=%d", brightness);
 
   return previousValue;
 }
 
 
-void Display::setButtonEvent(ButtonEvent value)
-{
-  buttonEvent = value;
-}
-
-void Display::setButtonKey(uint8_t key)
+void Display::setButtonEvent(ButtonEvent value, uint8_t key)
 {
-  buttonKey = key;
-}
-
-char* Display::getReceiveBuffer()
-{
-  return receiveBuffer;
+  DisplayEvent event = { value, key };
+  if (xQueueSend(eventQueue, &event, 0) != pdTRUE)
+  {
+    lostEventCount++;
+  }
 }
 
 ButtonEvent Display::buttonEventStatus()
 {
-  if (buttonEvent != ButtonEvent::NONE)
+  DisplayEvent event;
+  if (xQueueReceive(eventQueue, &event, 0) == pdTRUE)
   {
     TRACE();
-    ButtonEvent lastEvent = buttonEvent;
-    buttonEvent = ButtonEvent::NONE;
-    xSemaphoreGive(displayMutex);
-    return lastEvent;
+    buttonKey = event.key;
+    return event.event;
   }
   return ButtonEvent::NONE;
 }
@@ -406,22 +611,25 @@ uint8_t Display::getButtonKey()
   return buttonKey;
 }
 
+TaskLoad& Display::getReceiveTaskLoad()
+{
+  return receiveTaskLoad;
+}
+
 
 void Display::setClockTime(const uint8_t hh, const uint8_t mm, const uint8_t ss, const char* dateText, const char* weekdayText)
 {
   TRACE();
   if (currentPage == Pages::CLOCK)
   {
-    Serial2.printf("timeHour.val=%d", hh);
-    endCommand();
-    Serial2.printf("timeMinute.val=%d", mm);
-    endCommand();
-    Serial2.printf("timeSecond.val=%d", ss);
-    endCommand();
-    Serial2.printf("date.txt=\"%s\"", dateText);
-    endCommand();
-    Serial2.printf("weekday.txt=\"%s\"", weekdayText);
-    endCommand();
+    // not shadowed: the clock page counts on its own (click timeSecond)
+    beginBatch();
+    queueCommand("timeHour.val=%d", hh);
+    queueCommand("timeMinute.val=%d", mm);
+    queueCommand("timeSecond.val=%d", ss);
+    queueCommand("date.txt=\"%s\"", dateText);
+    queueCommand("weekday.txt=\"%s\"", weekdayText);
+    endBatch();
     DEB_PF("time set to %2.2d:%2.2d:%2.2d  %s  %s\n", hh, mm, ss, dateText, weekdayText);
   }
 }
@@ -430,8 +638,7 @@ void Display::incrementClockSecond()
 {
   if (currentPage == Pages::CLOCK)
   {
-    Serial2.printf("click timeSecond,1");
-    endCommand();
+    queueCommand("click timeSecond,1");
   }
 }
 
@@ -441,8 +648,10 @@ void Display::setFuelData(const char* stationName, const float priceDiesel, cons
   TRACE();
   if (currentPage == Pages::FUEL)
   {
+    beginBatch();
     setStation(stationName);
     setFuelPrices(priceDiesel, priceSuper, isOpen);
+    endBatch();
     DEB_PF("fuel data set to station='%s' priceDiesel=%5.3f priceSuper=%5.3f\n", stationName, priceDiesel, priceSuper);
   }
 }
@@ -452,101 +661,222 @@ void Display::setFuelPrices(const float priceDiesel, const float priceSuper, con
   char outbuf[6];
   if (currentPage == Pages::FUEL)
   {
+    beginBatch();
     if (isOpen)
     {
       sprintf(outbuf, "%5.3f", priceDiesel);
-      Serial2.printf("pDieselLast.txt=\"%c\"", outbuf[4]);
-      endCommand();
+      queueValue("pDieselLast.txt", "\"%c\"", outbuf[4]);
       outbuf[4] = 0;
-      Serial2.printf("priceDiesel.txt=\"%s\"", outbuf);
-      endCommand();
+      queueValue("priceDiesel.txt", "\"%s\"", outbuf);
       
       sprintf(outbuf, "%5.3f", priceSuper);
-      Serial2.printf("pSuperLast.txt=\"%c\"", outbuf[4]);
-      endCommand();
+      queueValue("pSuperLast.txt", "\"%c\"", outbuf[4]);
       outbuf[4] = 0;
-      Serial2.printf("priceSuper.txt=\"%s\"", outbuf);
-      endCommand();
+      queueValue("priceSuper.txt", "\"%s\"", outbuf);
 
       DEB_PF("update fuel prices priceDiesel=%5.3f priceSuper=%5.3f\n", priceDiesel, priceSuper);
     }
     else
     {
-      Serial2.printf("pDieselLast.txt=\" \"");
-      endCommand();
-      Serial2.printf("priceDiesel.txt=\"---\"");
-      endCommand();
-      Serial2.printf("pSuperLast.txt=\" \"");
-      endCommand();
-      Serial2.printf("priceSuper.txt=\"---\"");
-      endCommand();
+      queueValue("pDieselLast.txt", "\" \"");
+      queueValue("priceDiesel.txt", "\"---\"");
+      queueValue("pSuperLast.txt", "\" \"");
+      queueValue("priceSuper.txt", "\"---\"");
       
       DEB_PF("station closed; remove fuel prices\n");
     }
+    endBatch();
   }
 }
 
 void Display::setFuelLimits(const int32_t limitDiesel, const int32_t limitSuper)
 {
   // global variables - independent from current page
-  Serial2.printf("currentLimitDiesel=%d", limitDiesel);
-  endCommand();
-  Serial2.printf("currentLimitSuper=%d", limitSuper);
-  endCommand();
+  beginBatch();
+  queueCommand("currentLimitDiesel=%d", limitDiesel);
+  queueCommand("currentLimitSuper=%d", limitSuper);
+  endBatch();
 }
 
 void Display::setFuelAlarmDiesel(const bool activate)
 {
-  Serial2.printf("click priceDiesel,%c", activate ? '1' : '0');
-  endCommand();
+  if ((currentPage == Pages::FUEL) && !isUnchanged("priceDiesel.click", activate ? "1" : "0"))
+  {
+    queueCommand("click priceDiesel,%c", activate ? '1' : '0');
+  }
 }
 
 void Display::setFuelAlarmSuper(const bool activate)
 {
-  Serial2.printf("click priceSuper,%c", activate ? '1' : '0');
-  endCommand();
+  if ((currentPage == Pages::FUEL) && !isUnchanged("priceSuper.click", activate ? "1" : "0"))
+  {
+    queueCommand("click priceSuper,%c", activate ? '1' : '0');
+  }
+}
+
+void Display::setFuelCheapest(const char* cheapestText)
+{
+  // needs text component "cheapest" on page FUEL of the HMI
+  if (currentPage == Pages::FUEL)
+  {
+    queueValue("cheapest.txt", "\"%s\"", cheapestText);
+  }
 }
 
 void Display::setType(const char* typeText)
 {
-  Serial2.printf("type.txt=\"%s\"", typeText);
-  endCommand();
+  queueCommand("type.txt=\"%s\"", typeText);
 }
 
 void Display::setProgress(const byte value)
 {
-  Serial2.printf("progress.val=%d", value > 100 ? 100 : value);
-  endCommand();
+  queueCommand("progress.val=%d", value > 100 ? 100 : value);
 }
 
 
 
 void Display::requestValue(ValueType value)
 {
+  // drop answers which came too late for a previous request
+  xQueueReset(valueQueue);
   switch (value)
   {
     case ValueType::LIMIT_DIESEL:
-      Serial2.printf("get currentLimitDiesel");
-      endCommand();
+      queueCommand("get currentLimitDiesel");
       break;
     case ValueType::LIMIT_SUPER:
-      Serial2.printf("get currentLimitSuper");
-      endCommand();
+      queueCommand("get currentLimitSuper");
       break;
   }
+  // the answer is awaited in getReceivedValue() - the request must not wait in the batch
+  flush();
 }
 
 int32_t Display::getReceivedValue()
 {
-  // TODO: wait for "received" event
-  while (!valueReceived)
-    delay(1);
-  xSemaphoreTake(displayMutex, portMAX_DELAY);
-  int32_t retValue = lastReceivedValue;
-  lastReceivedValue = -1;
-  valueReceived = false;
-  xSemaphoreGive(displayMutex);
-  return retValue;
+  int32_t value;
+  if (xQueueReceive(valueQueue, &value, pdMS_TO_TICKS(nextionValueTimeout)) != pdTRUE)
+  {
+    DEB_PF("DISPLAY: no value received within %lu ms\n", nextionValueTimeout);
+    return -1;
+  }
+  return value;
+}
+
+void Display::receiveFrame(const uint8_t* frame, size_t length)
+{
+  // frame without the 0xFF 0xFF 0xFF terminator
+  switch (frame[0])
+  {
+    case 0x65:
+      // touch event
+      // 65 <page> <component> <event: 01 press / 00 release>
+      // Not used - the HMI sends its buttons as strings (0x70) from the release events.
+      if (length == 4)
+      {
+        DEB_PF("DISP: touch page %d component %d %s\n", frame[1], frame[2], frame[3] ? "press" : "release");
+      }
+      break;
+
+    case 0x70:
+      // string data: button release
+      if (length < 2)
+      {
+        break;
+      }
+      switch (frame[1])
+      {
+        case 0x4B:
+          // Station key buttons
+          // 70 4B 65 79 31 FF FF FF   pKey1
+          // 70 4B 65 79 32 FF FF FF   pKey2
+          // 70 4B 65 79 33 FF FF FF   pKey3
+          // 70 4B 65 79 34 FF FF FF   pKey4
+          // 70 4B 65 79 35 FF FF FF   pKey5
+          if (length >= 5)
+          {
+            DEB_PF("DISP: station key button %d pressed\n", frame[4] - '0');
+            setButtonEvent(ButtonEvent::KEY, frame[4] - '0');
+          }
+          break;
+
+        case 0x50:
+          // invisible previous hotspot
+          // 70 50 72 65 76 69 6F 75 73 FF FF FF   pPrevious
+          DEB_PF("DISP: PREVIOUS hotspot pressed\n");
+          setButtonEvent(ButtonEvent::PREVIOUS);
+          break;
+        case 0x4E:
+          // invisible next hotspot
+          // 70 4E 65 78 74 FF FF FF   pNext
+          DEB_PF("DISP: NEXT hotspot pressed\n");
+          setButtonEvent(ButtonEvent::NEXT);
+          break;
+
+        case 0x44:
+          // invisible brighness hotspot
+          // 70 44 61 72 6B 65 72 FF FF FF   pDarker
+          DEB_PF("DISP: DARK hotspot pressed\n");
+          setButtonEvent(ButtonEvent::DARK);
+          break;
+        case 0x42:
+          // invisible brighness hotspot
+          // 70 42 72 69 67 68 74 65 72 FF FF FF   pBrighter
+          DEB_PF("DISP: BRIGHT hotspot pressed\n");
+          setButtonEvent(ButtonEvent::BRIGHT);
+          break;
+
+        case 0x4C:
+          // hotspot LEFT
+          // 70 4C 65 66 74 FF FF FF   pLeft
+          DEB_PF("DISP: LEFT hotspot pressed\n");
+          setButtonEvent(ButtonEvent::LEFT);
+          break;
+        case 0x4D:
+          // headline middle button
+          // 70 4D 69 64 64 6C 65 FF FF FF   pMiddle
+          DEB_PF("DISP: MIDDLE hotspot pressed\n");
+          setButtonEvent(ButtonEvent::MIDDLE);
+          break;
+        case 0x52:
+          // 70 52 69 67 68 74 FF FF FF   pRight
+          DEB_PF("DISP: RIGHT hotspot pressed\n");
+          setButtonEvent(ButtonEvent::RIGHT);
+          break;
+        case 0x46:
+          // 70 46 75 65 6C 4C 69 6D 69 74 73 FF FF FF   pFuelLimits
+          DEB_PF("DISP: fuel price limits set\n");
+          setButtonEvent(ButtonEvent::LIMITS);
+          break;
+
+        default:
+          break;
+      }
+      break;
+
+    // receive limit values for fuel price
+    case 0x71:
+      // numeric data, little endian
+      // Simulator:
+      // 71 7F 00 00 00 FF FF FF   127
+      // 71 00 01 00 00 FF FF FF   256
+      // Display:
+      // 71 7F 00 FF FF FF   127
+      // 71 00 01 FF FF FF   256
+      if (length >= 3)
+      {
+        int32_t value = (int32_t)((int16_t)frame[1] + ((int16_t)frame[2] << 8));
+        DEB_PF("DISP: value %d\n", value);
+        xQueueOverwrite(valueQueue, &value);
+      }
+      break;
+
+    default:
+      // instruction return codes (0x00 invalid instruction, 0x1A invalid variable, ...)
+      DEB_PF("DISP: return code 0x%2.2X\n", frame[0]);
+      returnCodeCount++;
+      break;
+  }
 }
 
 // ==================================================================================
@@ -554,137 +884,63 @@ void displayReceiveTask(void* parameters)
 {
   TRACE();
   Display* disp = (Display*)parameters;
-  char* bufferPointer = disp->getReceiveBuffer();
+  TaskLoad& load = disp->getReceiveTaskLoad();
+  uint8_t frame[::nextionBufferSize];
   int32_t receiveIndex = 0;
   int32_t ffCount = 0;
 
   DEB_P("displayReceiveTask() running on core ");
   DEB_PL(xPortGetCoreID());
 
+  load.begin();
+
   while (1)
   {
-    if (Serial2.available())
+    int available = Serial2.available();
+    if (available == 0)
+    {
+      // nothing received: give the CPU away instead of spinning on available()
+      load.end();
+      vTaskDelay(pdMS_TO_TICKS(nextionReceivePollInterval));
+      load.begin();
+      continue;
+    }
+
+    while (available--)
     {
-      byte value  = Serial2.read();
-      bufferPointer[receiveIndex] = value;
-      receiveIndex++;
-      //DEB_P(value, HEX);
+      uint8_t value = Serial2.read();
       if (value == 0xFF)
       {
         ffCount++;
+        if (ffCount == 3)
+        {
+          // end of frame (terminator is not stored)
+          if (receiveIndex)
+          {
+            disp->receiveFrame(frame, receiveIndex);
+          }
+          ffCount = 0;
+          receiveIndex = 0;
+        }
+        continue;
       }
-      else
+
+      // 0xFF bytes not followed by the complete terminator are data
+      while (ffCount)
       {
-        ffCount = 0;
+        if (receiveIndex < ::nextionBufferSize)
+          frame[receiveIndex++] = 0xFF;
+        ffCount--;
       }
-
-      if (ffCount == 3)
+      if (receiveIndex < ::nextionBufferSize)
       {
-        //DEB_PL();
-        // end of data
-        // handle event immeadiately
-
-        switch (bufferPointer[0])
-        {
-          case 0x70:
-            // Button release
-            switch (bufferPointer[1])
-            {
-              case 0x4B:
-                // Station key buttons
-                // 70 4B 65 79 31 FF FF FF   pKey1
-                // 70 4B 65 79 32 FF FF FF   pKey2
-                // 70 4B 65 79 33 FF FF FF   pKey3
-                // 70 4B 65 79 34 FF FF FF   pKey4
-                // 70 4B 65 79 35 FF FF FF   pKey5
-                DEB_PF("DISP: station key button %d pressed\n", bufferPointer[4] - '0');
-                xSemaphoreTake(displayMutex, portMAX_DELAY);
-                disp->setButtonEvent(ButtonEvent::KEY);
-                disp->setButtonKey(bufferPointer[4] - '0');
-                xSemaphoreGive(displayMutex);
-                break;
-
-              case 0x50:
-                // invisible previous hotspot
-                // 70 50 72 65 76 69 6F 75 73 FF FF FF   pPrevious
-                DEB_PF("DISP: PREVIOUS hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::PREVIOUS);
-                break;
-              case 0x4E:
-                // invisible previous hotspot
-                // 70 4E 65 78 74 FF FF FF   pNext
-                DEB_PF("DISP: PREVIOUS hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::NEXT);
-                break;
-
-              case 0x44:
-                // invisible brighness hotspot
-                // 70 44 61 72 6B 65 72 FF FF FF   pDarker
-                DEB_PF("DISP: DARK hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::DARK);
-                break;
-              case 0x42:
-                // invisible brighness hotspot
-                // 70 42 72 69 67 68 74 65 72 FF FF FF   pBrighter
-                DEB_PF("DISP: BRIGHT hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::BRIGHT);
-                break;
-
-              case 0x4C:
-                // hotspot LEFT
-                // 70 4C 65 66 74 FF FF FF   pLeft
-                DEB_PF("DISP: LEFT hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::LEFT);
-                break;
-              case 0x4D:
-                // headline middle button
-                // 70 4D 69 64 64 6C 65 FF FF FF   pMiddle
-                DEB_PF("DISP: MIDDLE hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::MIDDLE);
-                break;
-              case 0x52:
-                // 70 52 69 67 68 74 FF FF FF   pRight
-                DEB_PF("DISP: RIGHT hotspot pressed\n");
-                disp->setButtonEvent(ButtonEvent::RIGHT);
-                break;
-              case 0x46:
-                // 70 46 75 65 6C 4C 69 6D 69 74 73 FF FF FF   pFuelLimits
-                DEB_PF("DISP: fuel price limits set\n");
-                disp->setButtonEvent(ButtonEvent::LIMITS);
-                break;
-
-              default:
-                break;
-            }
-            break;
-
-          // receive limit values for fuel price
-          case 0x71:
-            // Simulator:
-            // 71 7F 00 00 00 FF FF FF   127
-            // 71 00 01 00 00 FF FF FF   256
-            // Display:
-            // 71 7F 00 FF FF FF   127
-            // 71 00 01 FF FF FF   256
-            DEB_PF("DISP: value %d\n", disp->lastReceivedValue);
-            xSemaphoreTake(displayMutex, portMAX_DELAY);
-            disp->lastReceivedValue = (int32_t)((int16_t)bufferPointer[1] + ((int16_t)bufferPointer[2] << 8));
-            disp->valueReceived = true;
-            xSemaphoreGive(displayMutex);
-            break;
-
-          default:
-            break;
-        }
-        DEB_PF("DISP: stack %d\n", uxTaskGetStackHighWaterMark(NULL));
-        ffCount = 0;
-        receiveIndex = 0;
+        frame[receiveIndex++] = value;
       }
+      // frames longer than the buffer are truncated; the terminator resynchronises
     }
   }
 
   // emergency case:
-  xSemaphoreGive(displayMutex);
   vTaskDelete(NULL);
 }
 
@@ -4,6 +4,7 @@
 
 #include "trace.h"
 #include "config.h"
+#include "monitor.h"
 
 enum class ButtonEvent { NONE, KEY, PREVIOUS, NEXT, LEFT, RIGHT, DARK, BRIGHT, MIDDLE, LIMITS };
 enum class ValueType { LIMIT_DIESEL, LIMIT_SUPER };
@@ -41,43 +42,86 @@ class Display
     int32_t getReceivedValue();
     void setFuelAlarmDiesel(const bool activate);
     void setFuelAlarmSuper(const bool activate);
+    void setFuelCheapest(const char* cheapestText);
 
     // Nextion page 5: Download
     void setType(const char* typeText);
     void setProgress(const byte value);
 
     // Nextion receive
-    void setButtonEvent(ButtonEvent value);
-    void setButtonKey(uint8_t key);
-    char* getReceiveBuffer();
+    void setButtonEvent(ButtonEvent value, uint8_t key = 0);
     ButtonEvent buttonEventStatus();
     uint8_t getButtonKey();
+    void receiveFrame(const uint8_t* frame, size_t length);   // called by receive task
+    TaskLoad& getReceiveTaskLoad();
+
+    // command queue
+    // Commands between beginBatch() and endBatch() are sent with a single write.
+    void beginBatch();
+    void endBatch();
+    void flush();
+    uint32_t getBytesSent();
+    size_t getLastPageSwitchBytes();
+    unsigned long getMaxFlushTime();
+    // the HMI has reset the components of the current page by itself (e.g. back from page 4)
+    void clearShadow();
 
     // settings and others
     void endCommand();
     void off();
     int32_t setBrightness(int32_t value);
     int32_t adjustBrightness(bool brighter);
-
-    // TODO: Clean up access for task - this should be private
-    int32_t lastReceivedValue = -1;
-    // TODO: use event here
-    bool valueReceived = false;
+    void debugPrint();
 
   private:
     void adjustDebugLine(bool append);
+    void queueCommand(const char* format, ...);
+    void appendCommand(const char* component, const char* format, va_list arguments);
+    void queueValue(const char* component, const char* format, ...);
+
+    // shadow copy of component values sent since the last page switch
+    struct ShadowEntry
+    {
+      char component[nextionShadowNameLength];
+      char value[nextionShadowValueLength];
+    };
+    ShadowEntry* findShadow(const char* component);
+    bool isUnchanged(const char* component, const char* value);
+    void forgetValue(const char* component);
+    ShadowEntry shadow[nextionShadowSize];
+    uint8_t shadowCount = 0;
+    uint32_t suppressedCount = 0;
 
     uint8_t rxPin = nextionRXD;
     uint8_t txPin = nextionTXD;
 
-    char receiveBuffer[::nextionBufferSize];
+    struct DisplayEvent
+    {
+      ButtonEvent event;
+      uint8_t key;
+    };
     TaskHandle_t receiveTaskHandle = NULL;
-    ButtonEvent buttonEvent = ButtonEvent::NONE;
-    uint8_t buttonKey;
+    TaskLoad receiveTaskLoad;
+    QueueHandle_t eventQueue = NULL;    // button events for loop()
+    QueueHandle_t valueQueue = NULL;    // numeric answers to requestValue()
+    uint8_t buttonKey = 0;
+    uint32_t lostEventCount = 0;
+    uint32_t returnCodeCount = 0;
 
     Pages currentPage = Pages::DEBUG;
     int8_t currentDebugLine = 0;
 
+    char commandBuffer[nextionCommandBufferSize];
+    size_t commandLength = 0;
+    int8_t batchLevel = 0;
+    bool pageSwitchPending = false;
+    size_t pageSwitchStart = 0;         // commandBuffer bytes queued before the page command
+    uint32_t bytesSent = 0;
+    uint32_t flushCount = 0;
+    size_t lastPageSwitchBytes = 0;
+    unsigned long lastFlushTime = 0;
+    unsigned long maxFlushTime = 0;
+
     int brightness;
     void convertUtf8toIso(const char* text, uint8_t* textBuffer);
 
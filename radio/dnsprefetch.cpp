@@ -0,0 +1,76 @@
+#include "dnsprefetch.h"
+
+DnsPrefetch::DnsPrefetch() {}
+
+void DnsPrefetch::begin()
+{
+  statisticsMutex = xSemaphoreCreateMutex();
+}
+
+bool DnsPrefetch::getHost(const char* url, char* host, size_t size)
+{
+  // "http://host:port/path" -> "host"
+  const char* start = strstr(url, "://");
+  start = start ? start + 3 : url;
+  size_t length = strcspn(start, ":/?#");
+  if ((length == 0) || (length >= size))
+  {
+    return false;
+  }
+  memcpy(host, start, length);
+  host[length] = 0;
+  return true;
+}
+
+bool DnsPrefetch::prefetch(const char* url, uint32_t* lookupTime)
+{
+  // called by the feed task (before a connect) and the standby task (neighbour stations)
+  char host[dnsHostLength];
+  IPAddress address;
+
+  if ((url == NULL) || !getHost(url, host, sizeof(host)) || address.fromString(host))
+  {
+    // no host name: nothing to resolve
+    return false;
+  }
+  unsigned long startTime = millis();
+  bool isResolved = WiFi.hostByName(host, address) == 1;
+  unsigned long time = millis() - startTime;
+  if (lookupTime != NULL)
+    *lookupTime = time;
+
+  if (statisticsMutex != NULL)
+    xSemaphoreTake(statisticsMutex, portMAX_DELAY);
+  lastLookupTime = time;
+  if (time > maxLookupTime)
+    maxLookupTime = time;
+  if (!isResolved)
+  {
+    failCount++;
+  }
+  else if (time < dnsHitTime)
+  {
+    hitCount++;
+  }
+  else
+  {
+    missCount++;
+    missLookupTimeSum += time;
+  }
+  if (statisticsMutex != NULL)
+    xSemaphoreGive(statisticsMutex);
+
+  if (!isResolved)
+  {
+    DEB_PF("DNS: '%s' not resolved after %lu ms\n", host, time);
+  }
+  return isResolved;
+}
+
+void DnsPrefetch::debugPrint()
+{
+  DEB_PL("DNS prefetch:");
+  DEB_PF("    lookups            : %u hits (lwIP table), %u misses, %u failed\n", hitCount, missCount, failCount);
+  DEB_PF("    lookup time        : last %lu ms  miss avg %lu ms  max %lu ms\n", lastLookupTime,
+         missCount ? missLookupTimeSum / missCount : 0, maxLookupTime);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "trace.h"
+#include "config.h"
+
+
+class DnsPrefetch
+{
+    /*
+       Host names are resolved ahead of the connect that needs them
+
+       The stream library and HTTPClient connect by name (Host header, SNI), the WiFi stack
+       resolves that name with lwIP. lwIP keeps its answers in a small table for the TTL of
+       the record - a lookup shortly before the connect fills that table, so the connect
+       itself is answered from it.
+
+       prefetch()   resolves the host of a URL and records the time of the lookup:
+                    answered in less than dnsHitTime: hit (lwIP table), otherwise miss
+    */
+  public:
+    DnsPrefetch();
+
+    void begin();
+    bool prefetch(const char* url, uint32_t* lookupTime = NULL);
+    static bool getHost(const char* url, char* host, size_t size);
+
+    void debugPrint();
+
+  private:
+    SemaphoreHandle_t statisticsMutex = NULL;
+    uint32_t hitCount = 0;
+    uint32_t missCount = 0;
+    uint32_t failCount = 0;
+    unsigned long lastLookupTime = 0;
+    unsigned long maxLookupTime = 0;
+    unsigned long missLookupTimeSum = 0;
+};
@@ -5,9 +5,12 @@
 void IRAM_ATTR isrEncoderSwitch();
 void IRAM_ATTR isrEncoderTurn();
 
-DRAM_ATTR static volatile bool encoderClick = false;
-DRAM_ATTR static volatile bool encoderLongClick = false;
-DRAM_ATTR static volatile int16_t encoderRotationCount = 0;
+// Events from the ISRs to loop(). Every detent is one event, so nothing coalesces between two polls.
+// Both ISRs are called by the one GPIO interrupt handler of the core they were attached on, so they
+// never run concurrently and form a single producer - no lock is needed.
+DRAM_ATTR static EventQueue<EncoderEvent, encoderEventQueueLength> encoderEvents;
+// test input: produced and consumed by loop()
+static EventQueue<EncoderEvent, encoderEventQueueLength> simulatedEvents;
 
 Encoder::Encoder() {};
 
@@ -25,32 +28,30 @@ void Encoder::begin(Display& theScreen)
 
 EncoderEvent Encoder::eventStatus()
 {
-  if (encoderClick)
-  {
-    DEB_PL("Encoder click");
-    encoderClick = false;
-    return EncoderEvent::CLICK;
-  }
-  if (encoderLongClick)
+  EncoderEvent event;
+
+  if (!encoderEvents.pop(event) && !simulatedEvents.pop(event))
   {
-    DEB_PL("Encoder long click");
-    encoderLongClick = false;
-    return EncoderEvent::LONGCLICK;
+    return EncoderEvent::NONE;
   }
-  ticks += encoderRotationCount;
-  if (encoderRotationCount != 0)
+  switch (event)
   {
-    encoderRotationCount = 0;
-    if (ticks < 0)
-    {
-      return EncoderEvent::TURN_LEFT;
-    }
-    else
-    {
-      return EncoderEvent::TURN_RIGHT;
-    }
+    case EncoderEvent::CLICK:
+      DEB_PL("Encoder click");
+      break;
+    case EncoderEvent::LONGCLICK:
+      DEB_PL("Encoder long click");
+      break;
+    case EncoderEvent::TURN_LEFT:
+      ticks--;
+      break;
+    case EncoderEvent::TURN_RIGHT:
+      ticks++;
+      break;
+    case EncoderEvent::NONE:
+      break;
   }
-  return EncoderEvent::NONE;
+  return event;
 }
 
 void Encoder::setEncoderEvent(EncoderEvent value)
@@ -58,27 +59,27 @@ void Encoder::setEncoderEvent(EncoderEvent value)
   switch (value)
   {
     case EncoderEvent::NONE:
-      encoderClick = false;
-      encoderLongClick = false;
+      encoderEvents.clear();
+      simulatedEvents.clear();
       ticks = 0;
       break;
     case EncoderEvent::CLICK:
-      encoderClick = true;
-      break;
     case EncoderEvent::LONGCLICK:
-      encoderLongClick = false;
-      break;
     case EncoderEvent::TURN_LEFT:
-      ticks = 0;
-      encoderRotationCount--;
-      break;
     case EncoderEvent::TURN_RIGHT:
-      ticks = 0;
-      encoderRotationCount++;
+      simulatedEvents.push(value);
       break;
   }
 }
 
+void Encoder::debugPrint()
+{
+  DEB_PL("Encoder:");
+  DEB_PF("    pending events     : %u\n", encoderEvents.size());
+  DEB_PF("    lost events        : %u\n", encoderEvents.getOverflowCount());
+  DEB_PF("    simulated events   : %u pending\n", simulatedEvents.size());
+}
+
 int16_t Encoder::getTicks()
 {
   int16_t tickValue = ticks;
@@ -115,11 +116,11 @@ void IRAM_ATTR isrEncoderSwitch()
     {
       if ((newtime - oldtime) > encoderSwitchLongPressInterval) // More than [x] second?
       {
-        encoderLongClick = true ;                          // Yes, register longclick
+        encoderEvents.push(EncoderEvent::LONGCLICK);       // Yes, register longclick
       }
       else
       {
-        encoderClick = true;                               // Yes, click detected
+        encoderEvents.push(EncoderEvent::CLICK);           // Yes, click detected
       }
     }
   }
@@ -172,12 +173,12 @@ void IRAM_ATTR isrEncoderTurn()
   locrotcount += enc_states[inx];                               // Get delta: 0, +1 or -1
   if (locrotcount == 4)
   {
-    encoderRotationCount++;
+    encoderEvents.push(EncoderEvent::TURN_RIGHT);
     locrotcount = 0;
   }
   else if (locrotcount == -4)
   {
-    encoderRotationCount--;
+    encoderEvents.push(EncoderEvent::TURN_LEFT);
     locrotcount = 0;
   }
   old_state = act_state;                                        // Remember current status
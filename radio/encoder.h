@@ -4,6 +4,7 @@
 #include "config.h"
 
 #include "display.h"
+#include "eventqueue.h"
 
 enum class EncoderEvent { NONE, CLICK, LONGCLICK, TURN_LEFT, TURN_RIGHT };
 
@@ -16,8 +17,9 @@ class Encoder
     EncoderEvent eventStatus();
     int16_t getTicks();
     void setEncoderEvent(EncoderEvent value);   // needed only for test using key in PuTTY
+    void debugPrint();
 
   private:
     Display screen;
-    int16_t ticks;
+    int16_t ticks = 0;
 };
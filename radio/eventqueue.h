@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+
+template <typename T, uint32_t N>
+class EventQueue
+{
+    /*
+       Lock-free ring buffer for one producer (ISR or task) and one consumer (loop()).
+       It is safe only with exactly one producer context: a second producer (e.g. test input)
+       needs its own queue, not a lock around push().
+
+       The producer only writes head, the consumer only writes tail; both indices run freely
+       and are masked on access, therefore N must be a power of two.
+       A full queue drops the new event and counts it as overflow.
+       push() is forced inline so that it ends up in IRAM when called from an ISR.
+    */
+    static_assert((N & (N - 1)) == 0, "EventQueue size must be a power of two");
+
+  public:
+    inline __attribute__((always_inline)) bool push(const T& item)
+    {
+      uint32_t currentHead = head.load(std::memory_order_relaxed);
+      if (currentHead - tail.load(std::memory_order_acquire) >= N)
+      {
+        overflowCount++;
+        return false;
+      }
+      items[currentHead & (N - 1)] = item;
+      head.store(currentHead + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T& item)
+    {
+      uint32_t currentTail = tail.load(std::memory_order_relaxed);
+      if (currentTail == head.load(std::memory_order_acquire))
+      {
+        return false;
+      }
+      item = items[currentTail & (N - 1)];
+      tail.store(currentTail + 1, std::memory_order_release);
+      return true;
+    }
+
+    // consumer side: drop all pending events
+    void clear()
+    {
+      tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    uint32_t size()
+    {
+      return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t getOverflowCount()
+    {
+      return overflowCount;
+    }
+
+  private:
+    T items[N];
+    std::atomic<uint32_t> head {0};
+    std::atomic<uint32_t> tail {0};
+    volatile uint32_t overflowCount = 0;
+};
@@ -4,6 +4,7 @@
 //#define TANKERKOENIG_VERBOSE
 
 #include <HTTPClient.h>
+#include <WiFiClientSecure.h>
 #define ARDUINOJSON_USE_LONG_LONG 0
 #define ARDUINOJSON_USE_DOUBLE 0
 #include <ArduinoJson.h>
@@ -43,7 +44,52 @@ const char* root_ca = \
                       "emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=\n" \
                       "-----END CERTIFICATE-----\n";
 
-String fuelJsonBuffer;
+// size of the filter document: {"ok", "message", "prices":{"<id>":{"status","diesel","e5","e10"}, ...}}
+// the ids are not copied (const char* keys)
+static size_t filterDocumentSize(uint32_t numberOfStations)
+{
+  return JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(numberOfStations) + numberOfStations * JSON_OBJECT_SIZE(4);
+}
+
+// size of the filtered response; keys and strings are copied from the stream
+static size_t priceDocumentSize(uint32_t numberOfStations)
+{
+  return filterDocumentSize(numberOfStations) + numberOfStations * (fuelStationIdLength + fuelStationStatusLength) + fuelMessageLength;
+}
+
+// counts the bytes read from the response stream
+class CountingStream : public Stream
+{
+  public:
+    CountingStream(Stream& source) : source(source) {}
+    int available() override
+    {
+      return source.available();
+    }
+    int read() override
+    {
+      int value = source.read();
+      if (value >= 0)
+        count++;
+      return value;
+    }
+    int peek() override
+    {
+      return source.peek();
+    }
+    size_t write(uint8_t) override
+    {
+      return 0;
+    }
+    uint32_t getCount()
+    {
+      return count;
+    }
+
+  private:
+    Stream& source;
+    uint32_t count = 0;
+};
 
 
 const char* fuelTypeName(FuelType fuelType)
@@ -87,34 +133,6 @@ void FuelStation::setId(const char* stationId)
   id = stationId;
 }
 
-void FuelStation::setIsOpen(const bool value)
-{
-  if (!value)
-  {
-    // reset all alarms
-    activateAlarm(FuelType::DIESEL, false);
-    activateAlarm(FuelType::SUPER, false);
-    activateAlarm(FuelType::SUPER_E10, false);
-  }
-  isOpenFlag = value;
-}
-
-void FuelStation::setPrice(const FuelType fuelType, const float value)
-{
-  switch (fuelType)
-  {
-    case FuelType::DIESEL:
-      priceDiesel = value;
-      break;
-    case FuelType::SUPER:
-      priceE5 = value;
-      break;
-    case FuelType::SUPER_E10:
-      priceE10 = value;
-      break;
-  }
-}
-
 const char* FuelStation::getUiName()
 {
   return uiName;
@@ -137,66 +155,21 @@ const char* FuelStation::getId()
 
 bool FuelStation::isOpen()
 {
-  return isOpenFlag;
+  return (owner != NULL) && owner->isStationOpen(index);
 }
 
 float FuelStation::getPrice(const FuelType fuelType)
 {
-  if (isOpen())
+  if (owner == NULL)
   {
-    switch (fuelType)
-    {
-      case FuelType::DIESEL:
-        return priceDiesel;
-        break;
-      case FuelType::SUPER:
-        return priceE5;
-        break;
-      case FuelType::SUPER_E10:
-        return priceE10;
-        break;
-    }
-  }
-  return 0.0;
-}
-
-void FuelStation::activateAlarm(const FuelType fuelType, const bool activate)
-{
-  if (isOpen())
-  {
-    switch (fuelType)
-    {
-      case FuelType::DIESEL:
-        alarmDiesel = activate;
-        break;
-      case FuelType::SUPER:
-        alarmE5 = activate;
-        break;
-      case FuelType::SUPER_E10:
-        alarmE10 = activate;
-        break;
-    }
+    return 0.0;
   }
+  return owner->getPriceTenthCent(index, fuelType) / 1000.0;
 }
 
 bool FuelStation::getAlarm(const FuelType fuelType)
 {
-  if (isOpen())
-  {
-    switch (fuelType)
-    {
-      case FuelType::DIESEL:
-        return alarmDiesel;
-        break;
-      case FuelType::SUPER:
-        return alarmE5;
-        break;
-      case FuelType::SUPER_E10:
-        return alarmE10;
-        break;
-    }
-  }
-  return false;
+  return (owner != NULL) && owner->getAlarm(index, fuelType);
 }
 
 const char* getFuelTypeName(const FuelType fuelType)
@@ -223,23 +196,30 @@ char* FuelStation::createAlarmText(const FuelType fuelType)
   if (getAlarm(fuelType))
   {
     DEB_PF("alarm active for %s\n", getFuelTypeName(fuelType));
-    int32_t price = getPrice(fuelType) * 1000.;
-    int32_t euros = price / 1000;
-    int32_t cents = (price - euros * 1000) / 10;
-    int32_t rest  = price - euros * 1000 - cents * 10;
-    DEB_PF("%s bei %s in %s jetzt %d Euro %d %d\n",
-           getFuelTypeName(fuelType), speechName, speechCity, euros, cents, rest);
-    snprintf(alarmText, alarmTextLength, "%s bei %s in %s jetzt %d Euro %d %d. ",
-             getFuelTypeName(fuelType), speechName, speechCity, euros, cents, rest);
+    formatAlarmText(fuelType, getPrice(fuelType));
   }
   return alarmText;
 }
 
+char* FuelStation::formatAlarmText(const FuelType fuelType, const float floatPrice)
+{
+  // also used to check the clip library with sample prices
+  int32_t price = floatPrice * 1000.;
+  int32_t euros = price / 1000;
+  int32_t cents = (price - euros * 1000) / 10;
+  int32_t rest  = price - euros * 1000 - cents * 10;
+  DEB_PF("%s bei %s in %s jetzt %d Euro %d %d\n",
+         getFuelTypeName(fuelType), speechName, speechCity, euros, cents, rest);
+  snprintf(alarmText, alarmTextLength, "%s bei %s in %s jetzt %d Euro %d %d. ",
+           getFuelTypeName(fuelType), speechName, speechCity, euros, cents, rest);
+  return alarmText;
+}
+
 void FuelStation::debugPrint()
 {
-  if (isOpenFlag)
+  if (isOpen())
   {
-    DEB_PF(" %s  Diesel: %5.3f  E5: %5.3f  E10: %5.3f\n", uiName, priceDiesel, priceE5, priceE10);
+    DEB_PF(" %s  Diesel: %5.3f  E5: %5.3f  E10: %5.3f\n", uiName, getPrice(FuelType::DIESEL), getPrice(FuelType::SUPER), getPrice(FuelType::SUPER_E10));
   }
   else
   {
@@ -261,6 +241,16 @@ void FuelStations::setAPIKey(const char* keyString)
   APIKey = keyString;
 }
 
+void FuelStations::setAPIServer(const char* url, const char* cert)
+{
+  // optional: other server (e.g. local stand-in for tests) and its root certificate
+  if (url != NULL)
+  {
+    APIUrl = url;
+  }
+  APICert = cert;
+}
+
 bool FuelStations::createStationList(uint32_t number)
 {
   TRACE();
@@ -269,14 +259,37 @@ bool FuelStations::createStationList(uint32_t number)
   {
     DEB_PF("station list is not empty ( %d elements). Deleting.\n", numberOfStations);
     delete stationList;
+    delete[] resultList;
+    delete[] requestList;
+    delete[] priceTable;
+    delete[] maskTable;
+    delete[] announceTimes;
   }
   numberOfStations = number;
+  numberOfRequests = (numberOfStations + fuelRequestMaxStations - 1) / fuelRequestMaxStations;
+  numberOfMaskWords = (numberOfStations + 31) / 32;
   stationList = new FuelStation[numberOfStations]();
-  if (stationList == NULL)
+  resultList = new FuelPriceResult[numberOfStations]();
+  requestList = new FuelRequest[numberOfRequests]();
+  // padding stations of the last word: price 0, closed
+  priceTable = new int16_t[numberOfFuelTypes * numberOfMaskWords * 32]();
+  maskTable = new uint32_t[(4 * numberOfFuelTypes + 1) * numberOfMaskWords]();
+  announceTimes = new unsigned long[numberOfStations * numberOfFuelTypes]();
+  if ((stationList == NULL) || (resultList == NULL) || (requestList == NULL) || (priceTable == NULL) || (maskTable == NULL) || (announceTimes == NULL) ||
+      !rules.begin(numberOfStations))
   {
     DEB_PL("creation of station list failed");
     return false;
   }
+  for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+  {
+    prices[fuel] = priceTable + fuel * numberOfMaskWords * 32;
+    alarms[fuel] = maskTable + (4 * fuel) * numberOfMaskWords;
+    newAlarms[fuel] = maskTable + (4 * fuel + 1) * numberOfMaskWords;
+    clearedAlarms[fuel] = maskTable + (4 * fuel + 2) * numberOfMaskWords;
+    ruleAlarms[fuel] = maskTable + (4 * fuel + 3) * numberOfMaskWords;
+  }
+  openStations = maskTable + 4 * numberOfFuelTypes * numberOfMaskWords;
   DEB_PF("station list created for %d elements\n", numberOfStations);
   return true;
 }
@@ -289,6 +302,8 @@ bool FuelStations::setStation(uint32_t index, FuelStation& station)
     return false;
   }
   stationList[index] = station;
+  stationList[index].owner = this;
+  stationList[index].index = index;
   DEB_PF("station[ %d] set to '%s'\n", index, stationList[index].getUiName());
   return true;
 }
@@ -311,59 +326,82 @@ FuelStation& FuelStations::operator[](uint32_t index)
 
 bool FuelStations::isBelowLimit(const FuelType fuelType, const int32_t stationIndex)
 {
-  if (stationList[stationIndex].isOpen())
+  int16_t price = getPriceTenthCent(stationIndex, fuelType);
+  return (price > 0) && (price < limits[static_cast<uint32_t>(fuelType)] * 10);
+}
+
+bool FuelStations::isStationOpen(uint32_t station)
+{
+  if (station >= numberOfStations)
   {
-    switch (fuelType)
-    {
-      case FuelType::DIESEL:
-        return (stationList[stationIndex].getPrice(fuelType) < floatLimitDiesel);
-        break;
-      case FuelType::SUPER:
-        return (stationList[stationIndex].getPrice(fuelType) < floatLimitE5);
-        break;
-      case FuelType::SUPER_E10:
-        return (stationList[stationIndex].getPrice(fuelType) < floatLimitE10);
-        break;
-    }
+    return false;
   }
-  return false;
+  return (openStations[station / 32] >> (station % 32)) & 1;
 }
 
-void FuelStations::setLimit(const FuelType fuelType, const int32_t value)
+int16_t FuelStations::getPriceTenthCent(uint32_t station, const FuelType fuelType)
 {
-  switch (fuelType)
+  // 0 if closed or no price
+  if (!isStationOpen(station))
   {
-    case FuelType::DIESEL:
-      limitDiesel = value;
-      floatLimitDiesel = (float)value / 100.;
-      break;
-    case FuelType::SUPER:
-      limitE5 = value;
-      floatLimitE5 = (float)value / 100.;
-      break;
-    case FuelType::SUPER_E10:
-      limitE10 = value;
-      floatLimitE10 = (float)value / 100.;
-      break;
+    return 0;
   }
-  DEB_PF("FUEL : limit for %s set to %4.2f\n", fuelTypeName(fuelType), (float)value / 100.);
+  return prices[static_cast<uint32_t>(fuelType)][station];
 }
 
-int32_t FuelStations::getLimit(const FuelType fuelType)
+bool FuelStations::getAlarm(uint32_t station, const FuelType fuelType)
 {
-  switch (fuelType)
+  if (!isStationOpen(station))
   {
-    case FuelType::DIESEL:
-      return limitDiesel;
-      break;
-    case FuelType::SUPER:
-      return limitE5;
-      break;
-    case FuelType::SUPER_E10:
-      return limitE10;
-      break;
+    return false;
   }
-  return -1;
+  return (alarms[static_cast<uint32_t>(fuelType)][station / 32] >> (station % 32)) & 1;
+}
+
+uint32_t FuelStations::getNumberOfMaskWords()
+{
+  return numberOfMaskWords;
+}
+
+const uint32_t* FuelStations::getNewAlarms(const FuelType fuelType)
+{
+  // bit (station % 32) of word (station / 32): alarm raised by the last checkLimits()
+  return newAlarms[static_cast<uint32_t>(fuelType)];
+}
+
+const uint32_t* FuelStations::getClearedAlarms(const FuelType fuelType)
+{
+  return clearedAlarms[static_cast<uint32_t>(fuelType)];
+}
+
+void FuelStations::setStationOpen(uint32_t station, bool isOpen)
+{
+  // closed stations keep their alarm bits until the next checkLimits() reports them as cleared
+  uint32_t bit = 1UL << (station % 32);
+  openStations[station / 32] = isOpen ? (openStations[station / 32] | bit) : (openStations[station / 32] & ~bit);
+}
+
+void FuelStations::setPrice(uint32_t station, const FuelType fuelType, const float value)
+{
+  prices[static_cast<uint32_t>(fuelType)][station] = lroundf(value * 1000.0);
+}
+
+void FuelStations::setLimit(const FuelType fuelType, const int32_t value)
+{
+  limits[static_cast<uint32_t>(fuelType)] = value;
+  DEB_PF("FUEL : limit for %s set to %4.2f\n", fuelTypeName(fuelType), (float)value / 100.);
+}
+
+int32_t FuelStations::getLimit(const FuelType fuelType)
+{
+  return limits[static_cast<uint32_t>(fuelType)];
+}
+
+bool FuelStations::addRule(const char* station, const char* fuel, const char* days, const char* hours,
+                           float below, float belowAverage, bool cheapest)
+{
+  // station list must be complete: stations are looked up by name or key
+  return rules.compile(*this, station, fuel, days, hours, below, belowAverage, cheapest);
 }
 
 int32_t FuelStations::getCurrentStationIndex()
@@ -402,58 +440,124 @@ bool FuelStations::selectNextPrevious(bool next)
 
 bool FuelStations::checkLimits()
 {
-  bool retValue = false;
-  int32_t firstAlarmIndex = -1;
+  // active alarms keep their state within the hysteresis band: the price has to rise to limit + band
+  unsigned long now = millis();
+  uint32_t newCount = 0;
+  uint32_t clearedCount = 0;
 
   DEB_PL("FUEL : check limits");
-  for (int32_t count = 0; count < numberOfStations; count++)
+  for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
   {
-    if (isBelowLimit(FuelType::DIESEL, count))
-    {
-      stationList[count].activateAlarm(FuelType::DIESEL, true);
-      retValue = true;
-      if (firstAlarmIndex == -1)
-        firstAlarmIndex = count;
-      DEB_PF("    Diesel %5.3f below limit %5.3f at %s\n", stationList[count].getPrice(FuelType::DIESEL), floatLimitDiesel, stationList[count].getUiName());
-    }
-    else
+    memset(ruleAlarms[fuel], 0, numberOfMaskWords * sizeof(uint32_t));
+  }
+  rules.evaluate(prices, openStations, time(NULL), alarms, fuelAlarmHysteresis, ruleAlarms);
+  for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+  {
+    int32_t limit = limits[fuel] * 10;
+    for (uint32_t word = 0; word < numberOfMaskWords; word++)
     {
-      stationList[count].activateAlarm(FuelType::DIESEL, false);
+      uint32_t below = belowLimitMask(prices[fuel] + word * 32, limit);
+      uint32_t belowBand = belowLimitMask(prices[fuel] + word * 32, limit + fuelAlarmHysteresis);
+      uint32_t active = (below | (alarms[fuel][word] & belowBand) | ruleAlarms[fuel][word]) & openStations[word];
+      newAlarms[fuel][word] = active & ~alarms[fuel][word];
+      clearedAlarms[fuel][word] = alarms[fuel][word] & ~active;
+      alarms[fuel][word] = active;
+      newCount += __builtin_popcount(newAlarms[fuel][word]);
+      clearedCount += __builtin_popcount(clearedAlarms[fuel][word]);
     }
+  }
 
-    if (isBelowLimit(FuelType::SUPER, count))
-    {
-      stationList[count].activateAlarm(FuelType::SUPER, true);
-      retValue = true;
-      if (firstAlarmIndex == -1)
-        firstAlarmIndex = count;
-      DEB_PF("    Super  %5.3f below limit %5.3f at %s\n", stationList[count].getPrice(FuelType::SUPER), floatLimitE5, stationList[count].getUiName());
-    }
-    else
+  // delta lists in station order; a new alarm is not announced again within fuelReannounceInterval
+  numberOfNewAlarms = 0;
+  numberOfClearedAlarms = 0;
+  uint32_t suppressedCount = 0;
+  for (uint32_t word = 0; (word < numberOfMaskWords) && (newCount + clearedCount); word++)
+  {
+    uint32_t changed = newAlarms[0][word] | newAlarms[1][word] | newAlarms[2][word] |
+                       clearedAlarms[0][word] | clearedAlarms[1][word] | clearedAlarms[2][word];
+    for (; changed; changed &= changed - 1)
     {
-      stationList[count].activateAlarm(FuelType::SUPER, false);
+      uint32_t bit = __builtin_ctz(changed);
+      uint32_t station = word * 32 + bit;
+      for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+      {
+        FuelAlarmChange change = {(uint16_t)station, static_cast<FuelType>(fuel)};
+        unsigned long& announceTime = announceTimes[station * numberOfFuelTypes + fuel];
+        if ((newAlarms[fuel][word] >> bit) & 1)
+        {
+          if ((announceTime != 0) && (now - announceTime < fuelReannounceInterval))
+          {
+            suppressedCount++;
+          }
+          else if (numberOfNewAlarms < fuelAlarmListLength)
+          {
+            announceTime = now;
+            newAlarmList[numberOfNewAlarms++] = change;
+            DEB_PF("    new     %-9s %5.3f at %s (limit %4.2f, average %5.3f)\n", fuelTypeName(change.fuelType),
+                   prices[fuel][station] / 1000.0, stationList[station].getUiName(), limits[fuel] / 100.0,
+                   rules.getAverage(station, fuel) / 1000.0);
+          }
+          else
+          {
+            lostAlarmChanges++;
+          }
+        }
+        if ((clearedAlarms[fuel][word] >> bit) & 1)
+        {
+          if (numberOfClearedAlarms < fuelAlarmListLength)
+          {
+            clearedAlarmList[numberOfClearedAlarms++] = change;
+            DEB_PF("    cleared %-9s at %s\n", fuelTypeName(change.fuelType), stationList[station].getUiName());
+          }
+          else
+          {
+            lostAlarmChanges++;
+          }
+        }
+      }
     }
+  }
+  DEB_PF("    %u new (%u not announced again), %u cleared alarm(s)\n", newCount, suppressedCount, clearedCount);
 
-    if (isBelowLimit(FuelType::SUPER_E10, count))
-    {
-      stationList[count].activateAlarm(FuelType::SUPER_E10, true);
-      retValue = true;
-      if (firstAlarmIndex == -1)
-        firstAlarmIndex = count;
-      DEB_PF("    Super E10  %5.3f below limit %5.3f at %s\n", stationList[count].getPrice(FuelType::SUPER_E10), floatLimitE10, stationList[count].getUiName());
-    }
-    else
-    {
-      stationList[count].activateAlarm(FuelType::SUPER_E10, false);
-    }
+  // show the first newly announced station
+  if (numberOfNewAlarms)
+  {
+    currentStationIndex = newAlarmList[0].station;
   }
 
-  if (retValue)
+  return isAlarmActive();
+}
+
+bool FuelStations::isAlarmActive()
+{
+  for (uint32_t word = 0; word < numberOfMaskWords; word++)
   {
-    currentStationIndex = firstAlarmIndex;
+    if (alarms[0][word] | alarms[1][word] | alarms[2][word])
+    {
+      return true;
+    }
   }
+  return false;
+}
+
+uint32_t FuelStations::getNumberOfNewAlarms()
+{
+  return numberOfNewAlarms;
+}
+
+FuelAlarmChange FuelStations::getNewAlarm(uint32_t index)
+{
+  return newAlarmList[min(index, fuelAlarmListLength - 1)];
+}
+
+uint32_t FuelStations::getNumberOfClearedAlarms()
+{
+  return numberOfClearedAlarms;
+}
 
-  return retValue;
+FuelAlarmChange FuelStations::getClearedAlarm(uint32_t index)
+{
+  return clearedAlarmList[min(index, fuelAlarmListLength - 1)];
 }
 
 char* FuelStations::getAlarmText(const FuelType fuelType)
@@ -468,87 +572,65 @@ char* FuelStations::getAlarmText(const FuelType fuelType)
 void FuelStations::debugPrint()
 {
   DEB_PL("Fuel station list : ");
-  DEB_PF("    limit price Diesel   : %4.2f€\n", floatLimitDiesel);
-  DEB_PF("    limit price Super    : %4.2f€\n", floatLimitE5);
-  DEB_PF("    limit price Super E10 : %4.2f€\n", floatLimitE10);
+  DEB_PF("    limit price Diesel   : %4.2f€\n", limits[0] / 100.0);
+  DEB_PF("    limit price Super    : %4.2f€\n", limits[1] / 100.0);
+  DEB_PF("    limit price Super E10 : %4.2f€\n", limits[2] / 100.0);
   DEB_PF("    number of stations : %d\n", numberOfStations);
+  DEB_PF("    last update        : %lu ms, %u attempt(s), %u failed updates (%u in a row)\n", lastFetchDuration, lastFetchAttempts,
+         failedUpdateCount, consecutiveFailedUpdates);
+  DEB_PF("    heap used by update: %u bytes\n", lastUpdateHeapUsage);
+  DEB_PF("    server             : %s:%u\n", APIHost, APIPort);
+  DEB_PF("    last handshake     : %lu ms (%u handshakes, %u reused connections)\n", lastHandshakeTime, handshakeCount, reusedConnectionCount);
+  DEB_PF("    last bytes received: %u\n", lastBytesReceived);
+  DEB_PF("    active alarms      : %s (%u new, %u cleared, %u changes lost)\n", isAlarmActive() ? "yes" : "no",
+         numberOfNewAlarms, numberOfClearedAlarms, lostAlarmChanges);
   DEB_PL("    station list : ");
   for (uint32_t count = 0; count < numberOfStations; count++)
   {
     DEB_PF("       [ %3d]  ", count);
     stationList[count].debugPrint();
   }
+  rules.debugPrint();
 }
 
-String FuelStations::httpGETRequest(const char* serverName)
+const char* FuelStations::getFakeResponse()
 {
-  if (UseTankerkoenigFakeValues)
+  // Test: return fake results
+  static int callNumber = 0;
+  callNumber++;
+  if (callNumber > 5)
+    callNumber = 1;
+  DEB_PF("    [ %2d] fake result\n", callNumber);
+  // assume: Limit Diesel = 1.40, Super = 1.50  (Super E10 not used)
+  switch (callNumber)
   {
-    // Test: return fake results
-    static int callNumber = 0;
-    callNumber++;
-    if (callNumber > 5)
-      callNumber = 1;
-    DEB_PF("    [ %2d] fake result\n", callNumber);
-    // assume: Limit Diesel = 1.40, Super = 1.50  (Super E10 not used)
-    switch (callNumber)
-    {
-      case 1:
-        // all stations open, all prices above limit
-        return String(" {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.589},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}");
-        break;
-      case 2:
-        // Holle closed, all prices above limit
-        return String("{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"closed\"},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}");
-        break;
-      case 3:
-        // all stations open, Gross Duengen Dieesl below, Ochtersum both below
-        return String("{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.529},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.619,\"e10\":1.659,\"diesel\":1.449},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.559,\"e10\":1.629,\"diesel\":1.379}}}");
-        break;
-      case 4:
-        // all stations open, all prices above limit
-        return String(" {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.589},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}");
-        break;
-      case 5:
-        // all stations open, Holle Diesel & Super below limit
-        return String(" {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.589,\"e10\":1.649,\"diesel\":1.479},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}");
-        break;
-    }
-    return String("{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"closed\"},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"closed\"},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"closed\"},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"closed\"}}}");
-  }
-
-  WiFiClient client;
-  HTTPClient http;
-
-  // Your Domain name with URL path or IP address with path
-  http.begin(serverName, root_ca);
-
-  // Send HTTP POST request
-  int httpResponseCode = http.GET();
-
-  String payload = "{}";
-
-  if (httpResponseCode > 0)
-  {
-#if defined(TANKERKOENIG_VERBOSE)
-    DEB_P("HTTP Response code: ");
-    DEB_PL(httpResponseCode);
-#endif
-    payload = http.getString();
-  }
-  else
-  {
-    DEB_P("Error code: ");
-    DEB_PL(httpResponseCode);
+    case 1:
+      // all stations open, all prices above limit
+      return " {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.589},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}";
+      break;
+    case 2:
+      // Holle closed, all prices above limit
+      return "{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"closed\"},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}";
+      break;
+    case 3:
+      // all stations open, Gross Duengen Dieesl below, Ochtersum both below
+      return "{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.529},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.619,\"e10\":1.659,\"diesel\":1.449},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.559,\"e10\":1.629,\"diesel\":1.379}}}";
+      break;
+    case 4:
+      // all stations open, all prices above limit
+      return " {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.699,\"e10\":1.649,\"diesel\":1.589},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}";
+      break;
+    case 5:
+      // all stations open, Holle Diesel & Super below limit
+      return " {\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":1.579},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"open\",\"e5\":1.589,\"e10\":1.649,\"diesel\":1.479},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"open\",\"e5\":1.669,\"e10\":1.659,\"diesel\":1.549},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"open\",\"e5\":1.689,\"e10\":1.679,\"diesel\":1.569}}}";
+      break;
   }
-  // Free resources
-  http.end();
-
-  return payload;
+  return "{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{\"1a1ec4ba-cc2a-4663-8330-81efc48b9256\":{\"status\":\"closed\"},\"3c034790-3d2a-4093-8417-032a48cb9f25\":{\"status\":\"closed\"},\"e1a15081-24c2-9107-e040-0b0a3dfe563c\":{\"status\":\"closed\"},\"51d4b5e1-a095-1aa0-e100-80009459e03a\":{\"status\":\"closed\"}}}";
 }
 
 bool FuelStations::updatePrices(const bool closeAllStations)
 {
+  // synchronous update - blocks the caller for the whole HTTPS request
 
   DEB_PL("TANKERKOENIG: Update");
 
@@ -557,37 +639,132 @@ bool FuelStations::updatePrices(const bool closeAllStations)
   {
     for (uint32_t count = 0; count < numberOfStations; count++)
     {
-      stationList[count].setIsOpen(false);
+      setStationOpen(count, false);
     }
     return true;
   }
 
-  String serverPath = "https://creativecommons.tankerkoenig.de/json/prices.php?ids=";
-  for (uint32_t count = 0; count < numberOfStations; count++)
+  if (!fetchPrices())
   {
-    serverPath += stationList[count].getId();
-    serverPath += ',';
+    return false;
   }
-  int lastKomma = serverPath.lastIndexOf(',');
-  serverPath[lastKomma] = '&';   // ersetze das letzte Komma durch ein & (was vorher am Anfang des apikey-Strings stand)
-  serverPath += "apikey=" + String(APIKey);
+  applyPrices();
+  return true;
+}
+
+bool FuelStations::fetchPrices()
+{
+  // request prices of all stations and store them in resultList
+  // one request per batch of up to fuelRequestMaxStations; all requests share one kept-alive connection
+  uint32_t freeHeapBefore = ESP.getFreeHeap();
+  updateFreeHeapMin = freeHeapBefore;
+
+  if (secureClient == NULL)
+  {
+    // created once and kept: the connection is reused for all batches of an update
+    secureClient = new WiFiClientSecure();
+    secureClient->setCACert(APICert ? APICert : root_ca);
+  }
+  lastHandshakeTime = 0;
+  lastBytesReceived = 0;
 
+  HTTPClient http;
+  bool success = true;
+  for (uint32_t request = 0; (request < numberOfRequests) && success; request++)
+  {
+    success = fetchRequest(http, requestList[request]);
+  }
+  http.setReuse(false);
+  http.end();
+  // keep-alive timeout of the server is much shorter than fuelUpdateInterval: don't keep the connection until the next update
+  secureClient->stop();
+
+  lastUpdateHeapUsage = freeHeapBefore - updateFreeHeapMin;
+  DEB_PF("TANKERKOENIG: %u request(s), handshake %lu ms, %u bytes received, heap used by update %u bytes\n",
+         numberOfRequests, lastHandshakeTime, lastBytesReceived, lastUpdateHeapUsage);
+  return success;
+}
+
+bool FuelStations::fetchRequest(HTTPClient& http, FuelRequest& request)
+{
+  // request prices of the stations of one batch and store them in resultList
 #if defined(TANKERKOENIG_VERBOSE)
   DEB_P("TANKERKOENIG: RequestString\n    '");
-  DEB_P(serverPath);
+  DEB_P(request.url);
   DEB_PL("'");
 #endif
+  if (request.url[0] == 0)
+  {
+    DEB_PL("TANKERKOENIG: no valid request");
+    return false;
+  }
   // TEST: don't call server until request string is correct
   //return true;
 
-  fuelJsonBuffer = httpGETRequest(serverPath.c_str());
+  // parse the response directly from the stream, keeping only the values of the stations of this batch
+  DynamicJsonDocument filter(filterDocumentSize(request.numberOfStations));
+  filter["ok"] = true;
+  filter["message"] = true;
+  JsonObject filterPrices = filter.createNestedObject("prices");
+  for (uint32_t count = request.firstStation; count < request.firstStation + request.numberOfStations; count++)
+  {
+    JsonObject filterStation = filterPrices.createNestedObject(stationList[count].getId());
+    filterStation["status"] = true;
+    filterStation["diesel"] = true;
+    filterStation["e5"] = true;
+    filterStation["e10"] = true;
+  }
+  DynamicJsonDocument doc(priceDocumentSize(request.numberOfStations));
+  updateFreeHeapMin = min(updateFreeHeapMin, ESP.getFreeHeap());
+
+  DeserializationError error;
+  if (UseTankerkoenigFakeValues)
+  {
+    error = deserializeJson(doc, getFakeResponse(), DeserializationOption::Filter(filter));
+  }
+  else
+  {
+    if (!secureClient->connected())
+    {
+      // explicit connect to measure TCP connect + TLS handshake
+      unsigned long handshakeStartTime = millis();
+      if (!secureClient->connect(APIHost, APIPort))
+      {
+        DEB_PF("TANKERKOENIG: connect to %s:%u failed\n", APIHost, APIPort);
+        return false;
+      }
+      lastHandshakeTime += millis() - handshakeStartTime;
+      handshakeCount++;
+    }
+    else
+    {
+      reusedConnectionCount++;
+    }
+    http.begin(*secureClient, request.url);   // connected client is used as it is
+    http.setConnectTimeout(fuelHttpTimeout);
+    http.setTimeout(fuelHttpTimeout);
+    http.useHTTP10(true);     // no chunked transfer encoding: the stream is the plain JSON body
+    http.setReuse(true);      // useHTTP10() disables reuse; HTTP/1.0 with "Connection: keep-alive"
+
+    int httpResponseCode = http.GET();
+    updateFreeHeapMin = min(updateFreeHeapMin, ESP.getFreeHeap());
+    if (httpResponseCode <= 0)
+    {
+      DEB_P("Error code: ");
+      DEB_PL(httpResponseCode);
+      return false;
+    }
 #if defined(TANKERKOENIG_VERBOSE)
-  DEB_P("    ");
-  DEB_PL(fuelJsonBuffer);
+    DEB_P("HTTP Response code: ");
+    DEB_PL(httpResponseCode);
 #endif
-
-  StaticJsonDocument<1024> doc;
-  DeserializationError error = deserializeJson(doc, fuelJsonBuffer);
+    CountingStream stream(http.getStream());
+    stream.setTimeout(fuelHttpTimeout);
+    error = deserializeJson(doc, stream, DeserializationOption::Filter(filter));
+    lastBytesReceived += stream.getCount();
+    updateFreeHeapMin = min(updateFreeHeapMin, ESP.getFreeHeap());
+    http.end();             // with reuse: connection stays open for the next batch
+  }
 
   if (error)
   {
@@ -595,47 +772,284 @@ bool FuelStations::updatePrices(const bool closeAllStations)
     DEB_PL(error.f_str());
     return false;
   }
+#if defined(TANKERKOENIG_VERBOSE)
+  DEB_P("    ");
+  serializeJson(doc, Serial);
+  DEB_PL();
+#endif
 
   // von Tommy
   bool isOk = doc["ok"];
   if (!isOk)
   {
-    String msg = doc["message"];
+    const char* msg = doc["message"] | "no message";
     DEB_PL(msg);
     return false;
   }
 
   JsonObject prices = doc["prices"];
-  for (uint32_t count = 0; count < numberOfStations; count++)
+  for (uint32_t count = request.firstStation; count < request.firstStation + request.numberOfStations; count++)
   {
-    DEB_PL(stationList[count].getUiName());
     JsonObject station = prices[stationList[count].getId()];
+    if (station.isNull())
+    {
+      resultList[count].status = FuelPriceResult::Status::MISSING;
+      continue;
+    }
     if (station["status"] == "closed")
     {
-      stationList[count].setIsOpen(false);
-      stationList[count].activateAlarm(FuelType::DIESEL, false);
-      stationList[count].activateAlarm(FuelType::SUPER, false);
-      stationList[count].activateAlarm(FuelType::SUPER_E10, false);
-      DEB_PL("    geschlossen");
+      resultList[count].status = FuelPriceResult::Status::CLOSED;
       continue;
     }
     if (station["status"] == "no prices")
     {
-      DEB_PL("    keine Preise verfügbar");
+      resultList[count].status = FuelPriceResult::Status::NO_PRICES;
       continue;
     }
+    resultList[count].status = FuelPriceResult::Status::OPEN;
+    resultList[count].priceDiesel = station["diesel"];
+    resultList[count].priceE5 = station["e5"];
+    resultList[count].priceE10 = station["e10"];
+  }
 
-    stationList[count].setIsOpen(true);
-    float stationDiesel = station["diesel"];
-    float stationE5 = station["e5"];
-    float stationE10 = station["e10"];
-    stationList[count].setPrice(FuelType::DIESEL, stationDiesel);
-    stationList[count].setPrice(FuelType::SUPER,  stationE5);
-    stationList[count].setPrice(FuelType::SUPER_E10,  stationE10);
-    DEB_PF("    Diesel    : %5.3f\n", stationDiesel);
-    DEB_PF("    Super E5  : %5.3f\n", stationE5);
-    DEB_PF("    Super E10 : %5.3f\n", stationE10);
+  return true;
+}
+
+bool FuelStations::buildRequests()
+{
+  // build the request URLs once after the station list and the API key are known
+  TRACE();
+
+  // host and port for the explicit connect: "https://<host>[:<port>]/<path>"
+  const char* hostStart = strstr(APIUrl, "://");
+  hostStart = hostStart ? hostStart + 3 : APIUrl;
+  size_t hostLength = strcspn(hostStart, ":/");
+  if (hostLength >= sizeof(APIHost))
+  {
+    DEB_PF("TANKERKOENIG: host name too long in '%s'\n", APIUrl);
+    hostLength = 0;
+  }
+  memcpy(APIHost, hostStart, hostLength);
+  APIHost[hostLength] = 0;
+  APIPort = (hostStart[hostLength] == ':') ? atoi(hostStart + hostLength + 1) : 443;
+
+  bool success = true;
+  for (uint32_t request = 0; request < numberOfRequests; request++)
+  {
+    FuelRequest& current = requestList[request];
+    current.firstStation = request * fuelRequestMaxStations;
+    current.numberOfStations = min(fuelRequestMaxStations, numberOfStations - current.firstStation);
+
+    size_t length = snprintf(current.url, fuelRequestUrlLength, "%s?ids=", APIUrl);
+    for (uint32_t count = 0; (count < current.numberOfStations) && (length < fuelRequestUrlLength); count++)
+    {
+      length += snprintf(current.url + length, fuelRequestUrlLength - length, "%s%s", count ? "," : "", stationList[current.firstStation + count].getId());
+    }
+    if (length < fuelRequestUrlLength)
+    {
+      length += snprintf(current.url + length, fuelRequestUrlLength - length, "&apikey=%s", APIKey);
+    }
+    if (length >= fuelRequestUrlLength)
+    {
+      DEB_PF("TANKERKOENIG: request %u too long (%zu bytes)\n", request, length);
+      current.url[0] = 0;
+      success = false;
+    }
+  }
+  DEB_PF("TANKERKOENIG: %u request(s) for %u stations\n", numberOfRequests, numberOfStations);
+  return success;
+}
+
+void FuelStations::applyPrices()
+{
+  // transfer resultList into the station list (loop() context)
+  for (uint32_t count = 0; count < numberOfStations; count++)
+  {
+    DEB_PL(stationList[count].getUiName());
+    FuelPriceResult& result = resultList[count];
+    switch (result.status)
+    {
+      // no current prices: handled like closed, so old prices cannot keep an alarm active
+      case FuelPriceResult::Status::MISSING:
+        setStationOpen(count, false);
+        DEB_PL("    nicht in Antwort enthalten");
+        break;
+      case FuelPriceResult::Status::CLOSED:
+        setStationOpen(count, false);
+        DEB_PL("    geschlossen");
+        break;
+      case FuelPriceResult::Status::NO_PRICES:
+        setStationOpen(count, false);
+        DEB_PL("    keine Preise verfügbar");
+        break;
+      case FuelPriceResult::Status::OPEN:
+        setStationOpen(count, true);
+        setPrice(count, FuelType::DIESEL, result.priceDiesel);
+        setPrice(count, FuelType::SUPER,  result.priceE5);
+        setPrice(count, FuelType::SUPER_E10,  result.priceE10);
+        DEB_PF("    Diesel    : %5.3f\n", result.priceDiesel);
+        DEB_PF("    Super E5  : %5.3f\n", result.priceE5);
+        DEB_PF("    Super E10 : %5.3f\n", result.priceE10);
+        break;
+    }
+  }
+  rules.updateAverages(prices, openStations, time(NULL));
+}
+
+// ============================================================================================================================
+// asynchronous update
+//
+//   loop()                        fuel task
+//   requestUpdate()   IDLE -> REQUESTED
+//                                 REQUESTED -> FETCHING   (HTTPS request, retries)
+//                                 FETCHING  -> DONE | FAILED
+//   updateStatus()    DONE -> IDLE: prices applied, returns true
+//                     FAILED -> IDLE
+//
+// Only the fuel task writes resultList, and only while FETCHING. loop() reads it after DONE.
+
+void fuelTask(void* parameters);
+
+bool FuelStations::beginUpdateTask()
+{
+  TRACE();
+
+  if (updateTaskHandle != NULL)
+  {
+    return true;
+  }
+  BaseType_t retValue = xTaskCreatePinnedToCore(
+                          fuelTask,             /* Task function. */
+                          "FuelTask",           /* String with name of task. */
+                          fuelTaskStackSize,    /* Stack size in bytes. */
+                          (void*)this,          /* Parameter passed as input of the task: This FuelStations object*/
+                          1,                    /* Priority of the task. */
+                          &updateTaskHandle,    /* Task handle. */
+                          fuelTaskCore);        /* Core: keep away from loop() */
+  if (retValue != pdPASS)
+  {
+    DEB_PL("FUEL : creation of fuel task failed");
+    updateTaskHandle = NULL;
+    return false;
+  }
+  DEB_PF("FUEL : fuel task created on core %d\n", fuelTaskCore);
+  return true;
+}
+
+bool FuelStations::requestUpdate()
+{
+  if (updateTaskHandle == NULL)
+  {
+    // no task: fall back to synchronous update
+    if (updatePrices())
+    {
+      updateState = FuelUpdateState::DONE;
+      return true;
+    }
+    return false;
   }
 
+  FuelUpdateState expected = FuelUpdateState::IDLE;
+  if (!updateState.compare_exchange_strong(expected, FuelUpdateState::REQUESTED))
+  {
+    DEB_PL("FUEL : update still running - request ignored");
+    return false;
+  }
+  xTaskNotifyGive(updateTaskHandle);
   return true;
 }
+
+bool FuelStations::updateStatus()
+{
+  switch (updateState.load())
+  {
+    case FuelUpdateState::DONE:
+      if (updateTaskHandle != NULL)
+      {
+        DEB_PL("TANKERKOENIG: Update received");
+        applyPrices();
+      }
+      consecutiveFailedUpdates = 0;
+      updateState = FuelUpdateState::IDLE;
+      return true;
+    case FuelUpdateState::FAILED:
+      DEB_PL("TANKERKOENIG: Update failed");
+      failedUpdateCount++;
+      consecutiveFailedUpdates++;
+      updateState = FuelUpdateState::IDLE;
+      if (consecutiveFailedUpdates == fuelMaxFailedUpdates)
+      {
+        // prices are outdated: close all stations - their alarms are cleared by the next checkLimits()
+        DEB_PF("TANKERKOENIG: %u failed updates - all stations closed\n", consecutiveFailedUpdates);
+        updatePrices(true);
+        return true;
+      }
+      return false;
+    case FuelUpdateState::IDLE:
+    case FuelUpdateState::REQUESTED:
+    case FuelUpdateState::FETCHING:
+      break;
+  }
+  return false;
+}
+
+FuelUpdateState FuelStations::getUpdateState()
+{
+  return updateState.load();
+}
+
+unsigned long FuelStations::getLastFetchDuration()
+{
+  return lastFetchDuration;
+}
+
+void FuelStations::runUpdateTask()
+{
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (updateState.load() != FuelUpdateState::REQUESTED)
+    {
+      continue;
+    }
+    updateState = FuelUpdateState::FETCHING;
+    DEB_PL("TANKERKOENIG: Update (fuel task)");
+
+    unsigned long startTime = millis();
+    bool success = false;
+    uint32_t attempt;
+    for (attempt = 1; attempt <= fuelUpdateAttempts; attempt++)
+    {
+      success = fetchPrices();
+      if (success)
+      {
+        break;
+      }
+      if (attempt < fuelUpdateAttempts)
+      {
+        DEB_PF("TANKERKOENIG: attempt %u failed; retry in %lu ms\n", attempt, fuelUpdateRetryDelay);
+        vTaskDelay(pdMS_TO_TICKS(fuelUpdateRetryDelay));
+      }
+    }
+    lastFetchDuration = millis() - startTime;
+    lastFetchAttempts = success ? attempt : fuelUpdateAttempts;
+    updateState = success ? FuelUpdateState::DONE : FuelUpdateState::FAILED;
+  }
+}
+
+// ==================================================================================
+void fuelTask(void* parameters)
+{
+  TRACE();
+  FuelStations* stations = (FuelStations*)parameters;
+
+  DEB_P("fuelTask() running on core ");
+  DEB_PL(xPortGetCoreID());
+
+  stations->runUpdateTask();
+
+  // emergency case:
+  vTaskDelete(NULL);
+}
+
+// ==================================================================================
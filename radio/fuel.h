@@ -8,13 +8,61 @@
 
 #pragma once
 #include <Arduino.h>
+#include <atomic>
 
 #include "trace.h"
 #include "config.h"
+#include "fuelrules.h"
 
 enum class FuelType { DIESEL, SUPER, SUPER_E10 };
+constexpr uint32_t numberOfFuelTypes = 3;            // column index is the value of FuelType
 const char* fuelTypeName(FuelType fuelType);
 
+// state of the asynchronous price update (loop() <-> fuel task)
+enum class FuelUpdateState { IDLE, REQUESTED, FETCHING, DONE, FAILED };
+
+// prices of one station as received by the fuel task; applied to FuelStation by loop()
+struct FuelPriceResult
+{
+  enum class Status { MISSING, OPEN, CLOSED, NO_PRICES };
+  Status status = Status::MISSING;
+  float priceDiesel = 0.0;
+  float priceE5 = 0.0;
+  float priceE10 = 0.0;
+};
+
+// one price request for up to fuelRequestMaxStations stations (API limit); built once by buildRequests()
+struct FuelRequest
+{
+  char url[fuelRequestUrlLength];
+  uint32_t firstStation;
+  uint32_t numberOfStations;
+};
+
+// entry of the delta lists of checkLimits()
+struct FuelAlarmChange
+{
+  uint16_t station;
+  FuelType fuelType;
+};
+
+// bit n is set if station n of the 32 stations has a price below the limit
+// sign of (price - limit) & (-price): below limit and price available - no branch per station
+inline uint32_t belowLimitMask(const int16_t* prices, int32_t limit)
+{
+  uint32_t mask = 0;
+  for (uint32_t bit = 0; bit < 32; bit++)
+  {
+    int32_t price = prices[bit];
+    mask |= ((uint32_t)((price - limit) & -price) >> 31) << bit;
+  }
+  return mask;
+}
+
+class HTTPClient;
+class WiFiClientSecure;
+class FuelStations;
+
 
 class FuelStation
 {
@@ -25,8 +73,6 @@ class FuelStation
     void setSpeechName(const char* stationName);
     void setSpeechCity(const char* stationCity);
     void setId(const char* stationId);
-    void setIsOpen(const bool value);
-    void setPrice(const FuelType fuelType, const float value);
 
     const char* getUiName();
     const char* getSpeechName();
@@ -34,24 +80,20 @@ class FuelStation
     const char* getId();
     bool isOpen();
     float getPrice(const FuelType fuelType);
-    void activateAlarm(const FuelType fuelType, const bool activate);
     bool getAlarm(const FuelType fuelType);
     char* createAlarmText(const FuelType fuelType);
+    char* formatAlarmText(const FuelType fuelType, const float price);
 
     void debugPrint();
 
   private:
+    friend class FuelStations;
     const char* uiName;
     const char* speechName;
     const char* speechCity;
     const char* id;
-    bool isOpenFlag = false;
-    float priceE5;
-    float priceE10;
-    float priceDiesel;
-    bool alarmE5 = false;
-    bool alarmE10 = false;
-    bool alarmDiesel = false;
+    FuelStations* owner = NULL;            // prices and alarms are kept in the columns of the list
+    uint32_t index = 0;
     char alarmText[alarmTextLength];
 };
 
@@ -60,38 +102,109 @@ class FuelStations
 {
     /*
        List of fuel stations found in file tanken.json
+
+       prices and alarm state are stored as columns (structure of arrays):
+         prices : int16_t tenth cent per station, one column per fuel type (0: no price)
+         masks  : one bit per station, 32 stations per word - open, alarm, new alarm, cleared alarm
+       checkLimits() evaluates a column without a branch per station against the limit of the FUEL
+       page and adds the alarms of the rules in tanken.json. An active alarm is kept until the price
+       leaves the hysteresis band. The changes are returned as delta lists (new, cleared); a new alarm
+       is listed only if the alarm has not been announced within fuelReannounceInterval.
     */
   public:
     FuelStations();
 
     uint32_t getNumberOfStations();
     void setAPIKey(const char* keyString);
+    void setAPIServer(const char* url, const char* cert = NULL);
     bool createStationList(uint32_t number);
     bool setStation(uint32_t index, FuelStation& station);
+    bool buildRequests();
     FuelStation& getStation(uint32_t index);
     FuelStation& operator[](uint32_t index);
     void setLimit(const FuelType fuelType, const int32_t value);
     int32_t getLimit(const FuelType fuelType);
+    bool addRule(const char* station, const char* fuel, const char* days, const char* hours,
+                 float below, float belowAverage, bool cheapest);
     bool isBelowLimit(const FuelType fuelType, const int32_t stationIndex = 0);
+    bool isStationOpen(uint32_t station);
+    int16_t getPriceTenthCent(uint32_t station, const FuelType fuelType);
+    bool getAlarm(uint32_t station, const FuelType fuelType);
+    uint32_t getNumberOfMaskWords();
+    const uint32_t* getNewAlarms(const FuelType fuelType);
+    const uint32_t* getClearedAlarms(const FuelType fuelType);
     bool updatePrices(const bool closeAllStations = false);
+    // asynchronous update
+    bool beginUpdateTask();
+    bool requestUpdate();
+    bool updateStatus();
+    FuelUpdateState getUpdateState();
+    unsigned long getLastFetchDuration();
+    void runUpdateTask();   // called by fuel task only
     int32_t getCurrentStationIndex();
     bool selectNextPrevious(bool next);
     bool checkLimits();
+    bool isAlarmActive();
+    uint32_t getNumberOfNewAlarms();
+    FuelAlarmChange getNewAlarm(uint32_t index);
+    uint32_t getNumberOfClearedAlarms();
+    FuelAlarmChange getClearedAlarm(uint32_t index);
     char* getAlarmText(const FuelType fuelType = FuelType::SUPER);
 
     void debugPrint();
 
   private:
+    friend class FuelStationsTest;        // host tests (test/)
     const char* APIKey;
+    const char* APIUrl = fuelPricesUrl;
+    const char* APICert = NULL;           // NULL: root certificate of Tankerkoenig
+    char APIHost[fuelHostLength];
+    uint16_t APIPort = 443;
     uint32_t numberOfStations;
     FuelStation* stationList;
-    int32_t limitDiesel;
-    int32_t limitE5;
-    int32_t limitE10;
-    float floatLimitDiesel;
-    float floatLimitE5;
-    float floatLimitE10;
+    int32_t limits[numberOfFuelTypes] = {initialLimitDiesel, initialLimitSuper, initialLimitSuperE10};   // cent
+    // columns
+    uint32_t numberOfMaskWords = 0;
+    int16_t* priceTable = NULL;                       // all price columns, padded to whole mask words
+    uint32_t* maskTable = NULL;                       // all masks
+    int16_t* prices[numberOfFuelTypes];
+    uint32_t* alarms[numberOfFuelTypes];
+    uint32_t* newAlarms[numberOfFuelTypes];
+    uint32_t* clearedAlarms[numberOfFuelTypes];
+    uint32_t* ruleAlarms[numberOfFuelTypes];
+    uint32_t* openStations = NULL;
+    FuelRules rules;
+    // delta lists of the last checkLimits()
+    unsigned long* announceTimes = NULL;              // millis() per station and fuel type, 0: never announced
+    FuelAlarmChange newAlarmList[fuelAlarmListLength];
+    FuelAlarmChange clearedAlarmList[fuelAlarmListLength];
+    uint32_t numberOfNewAlarms = 0;
+    uint32_t numberOfClearedAlarms = 0;
+    uint32_t lostAlarmChanges = 0;
+    void setStationOpen(uint32_t station, bool isOpen);
+    void setPrice(uint32_t station, const FuelType fuelType, const float value);
     int32_t currentStationIndex = 0;
-    String httpGETRequest(const char* serverName);
+    const char* getFakeResponse();
+    bool fetchPrices();
+    bool fetchRequest(HTTPClient& http, FuelRequest& request);
+    void applyPrices();
+
+    // asynchronous update
+    FuelRequest* requestList = NULL;
+    uint32_t numberOfRequests = 0;
+    FuelPriceResult* resultList = NULL;       // written by fuel task while FETCHING
+    TaskHandle_t updateTaskHandle = NULL;
+    std::atomic<FuelUpdateState> updateState {FuelUpdateState::IDLE};
+    unsigned long lastFetchDuration = 0;
+    uint32_t lastFetchAttempts = 0;
+    uint32_t failedUpdateCount = 0;
+    uint32_t consecutiveFailedUpdates = 0;
+    uint32_t lastUpdateHeapUsage = 0;
+    uint32_t updateFreeHeapMin = 0;
+    WiFiClientSecure* secureClient = NULL;
+    unsigned long lastHandshakeTime = 0;
+    uint32_t handshakeCount = 0;
+    uint32_t reusedConnectionCount = 0;
+    uint32_t lastBytesReceived = 0;
     char alarmText[alarmTextLength];
 };
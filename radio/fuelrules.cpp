@@ -0,0 +1,318 @@
+#include "fuelrules.h"
+#include "fuel.h"
+
+FuelRules::FuelRules() {}
+
+bool FuelRules::begin(uint32_t stations)
+{
+  TRACE();
+
+  delete[] ruleTable;
+  delete[] ruleCount;
+  delete[] averages;
+  numberOfStations = stations;
+  numberOfRules = 0;
+  droppedRules = 0;
+  averageTime = 0;
+  averageStartTime = 0;
+  ruleTable = new Rule[numberOfStations * numberOfFuelTypes * fuelRulesPerSlot]();
+  ruleCount = new uint8_t[numberOfStations * numberOfFuelTypes]();
+  averages = new int32_t[numberOfStations * numberOfFuelTypes]();
+  if ((ruleTable == NULL) || (ruleCount == NULL) || (averages == NULL))
+  {
+    DEB_PL("FUEL RULES: out of memory");
+    numberOfStations = 0;
+    return false;
+  }
+  return true;
+}
+
+uint32_t FuelRules::parseRanges(const char* text, int32_t first, int32_t last, bool isEndExclusive)
+{
+  // "1-5,7" -> bits 1..5 and 7; NULL: all; 0 on syntax error
+  uint32_t mask = 0;
+
+  if (text == NULL)
+  {
+    for (int32_t value = first; value <= last; value++)
+    {
+      mask |= 1UL << value;
+    }
+    return mask;
+  }
+  while (*text)
+  {
+    char* end;
+    int32_t from = strtol(text, &end, 10);
+    int32_t to = from;
+    if (end == text)
+    {
+      return 0;
+    }
+    text = end;
+    if (*text == '-')
+    {
+      text++;
+      to = strtol(text, &end, 10);
+      if (end == text)
+      {
+        return 0;
+      }
+      text = end;
+      if (isEndExclusive)
+      {
+        to--;
+      }
+    }
+    if ((from < first) || (to > last) || (from > to))
+    {
+      return 0;
+    }
+    for (int32_t value = from; value <= to; value++)
+    {
+      mask |= 1UL << value;
+    }
+    while ((*text == ',') || (*text == ' '))
+    {
+      text++;
+    }
+  }
+  return mask;
+}
+
+bool FuelRules::compile(FuelStations& fuelStations, const char* station, const char* fuel, const char* days, const char* hours,
+                        float below, float belowAverage, bool cheapest)
+{
+  // station: uiname or key, NULL or "*" for all; fuel: "diesel", "e5", "e10", NULL or "*" for all
+  // days: "1-5" (1: Monday .. 7: Sunday); hours: "6-9" (6:00 until 9:00)
+  Rule rule;
+  int32_t stationIndex = -1;
+  int32_t fuelIndex = -1;
+
+  if (numberOfStations == 0)
+  {
+    return false;
+  }
+  if ((station != NULL) && strcmp(station, "*"))
+  {
+    for (uint32_t index = 0; index < fuelStations.getNumberOfStations(); index++)
+    {
+      if (!strcmp(station, fuelStations[index].getUiName()) || !strcmp(station, fuelStations[index].getId()))
+      {
+        stationIndex = index;
+        break;
+      }
+    }
+    if (stationIndex < 0)
+    {
+      DEB_PF("FUEL RULES: unknown station '%s'\n", station);
+      return false;
+    }
+  }
+  if ((fuel != NULL) && strcmp(fuel, "*"))
+  {
+    if (!strcasecmp(fuel, "diesel"))
+      fuelIndex = static_cast<int32_t>(FuelType::DIESEL);
+    else if (!strcasecmp(fuel, "e5") || !strcasecmp(fuel, "super"))
+      fuelIndex = static_cast<int32_t>(FuelType::SUPER);
+    else if (!strcasecmp(fuel, "e10"))
+      fuelIndex = static_cast<int32_t>(FuelType::SUPER_E10);
+    else
+    {
+      DEB_PF("FUEL RULES: unknown fuel type '%s'\n", fuel);
+      return false;
+    }
+  }
+
+  uint32_t dayMask = parseRanges(days, 1, 7, false);
+  rule.hours = parseRanges(hours, 0, 24, true) & 0xFFFFFF;
+  rule.weekdays = (dayMask & 0x7E) | ((dayMask >> 7) & 1);   // tm_wday: Sunday is 0
+  rule.limit = lroundf(below * 1000.0);
+  rule.belowAverage = lroundf(belowAverage * 1000.0);
+  rule.isCheapest = cheapest;
+  if ((rule.hours == 0) || (rule.weekdays == 0))
+  {
+    DEB_PL("FUEL RULES: wrong days or hours");
+    return false;
+  }
+  if ((rule.limit <= 0) && (rule.belowAverage <= 0) && !rule.isCheapest)
+  {
+    DEB_PL("FUEL RULES: rule without condition");
+    return false;
+  }
+
+  // expand into the slots of all matching stations and fuel types
+  bool success = true;
+  for (uint32_t index = 0; index < numberOfStations; index++)
+  {
+    if ((stationIndex >= 0) && (index != (uint32_t)stationIndex))
+    {
+      continue;
+    }
+    for (uint32_t fuelType = 0; fuelType < numberOfFuelTypes; fuelType++)
+    {
+      if ((fuelIndex < 0) || (fuelType == (uint32_t)fuelIndex))
+      {
+        success = addRule(index, fuelType, rule) && success;
+      }
+    }
+  }
+  numberOfRules++;
+  return success;
+}
+
+bool FuelRules::addRule(uint32_t station, uint32_t fuel, const Rule& rule)
+{
+  uint32_t slot = station * numberOfFuelTypes + fuel;
+  if (ruleCount[slot] >= fuelRulesPerSlot)
+  {
+    droppedRules++;
+    return false;
+  }
+  ruleTable[slot * fuelRulesPerSlot + ruleCount[slot]] = rule;
+  ruleCount[slot]++;
+  return true;
+}
+
+void FuelRules::updateAverages(int16_t* const prices[], const uint32_t* openStations, time_t time)
+{
+  // exponential moving average with the weight of the elapsed time
+  if ((averages == NULL) || (time < urlCacheValidTime))
+  {
+    return;
+  }
+  int64_t elapsed = (averageTime == 0) ? 0 : min((int64_t)(time - averageTime), (int64_t)fuelAverageTime);
+  averageTime = time;
+  if (averageStartTime == 0)
+  {
+    averageStartTime = time;
+  }
+  for (uint32_t station = 0; station < numberOfStations; station++)
+  {
+    if (!((openStations[station / 32] >> (station % 32)) & 1))
+    {
+      continue;
+    }
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      int32_t price = (int32_t)prices[fuel][station] << 8;
+      int32_t& average = averages[station * numberOfFuelTypes + fuel];
+      if (price <= 0)
+      {
+        continue;
+      }
+      if (average == 0)
+      {
+        average = price;
+      }
+      else
+      {
+        average += (int32_t)(((int64_t)(price - average) * elapsed) / fuelAverageTime);
+      }
+    }
+  }
+}
+
+void FuelRules::evaluate(int16_t* const prices[], const uint32_t* openStations, time_t time, uint32_t* const activeAlarms[],
+                         int16_t band, uint32_t* const alarms[])
+{
+  // sets the alarm bit of every open station whose slot has a matching rule
+  int16_t cheapest[numberOfFuelTypes];
+  uint32_t hourBit = 0;
+  uint8_t dayBit = 0;
+  bool isAverageValid = (averageStartTime != 0) && (time - averageStartTime >= fuelAverageMinAge);
+
+  if ((numberOfRules == 0) || (numberOfStations == 0))
+  {
+    return;
+  }
+  if (time >= urlCacheValidTime)
+  {
+    struct tm timeInfo;
+    localtime_r(&time, &timeInfo);
+    hourBit = 1UL << timeInfo.tm_hour;
+    dayBit = 1 << timeInfo.tm_wday;
+  }
+
+  // lowest price of all open stations per fuel type
+  for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+  {
+    cheapest[fuel] = INT16_MAX;
+    for (uint32_t station = 0; station < numberOfStations; station++)
+    {
+      int16_t price = prices[fuel][station];
+      if (((openStations[station / 32] >> (station % 32)) & 1) && (price > 0) && (price < cheapest[fuel]))
+      {
+        cheapest[fuel] = price;
+      }
+    }
+  }
+
+  for (uint32_t station = 0; station < numberOfStations; station++)
+  {
+    if (!((openStations[station / 32] >> (station % 32)) & 1))
+    {
+      continue;
+    }
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      uint32_t slot = station * numberOfFuelTypes + fuel;
+      int16_t price = prices[fuel][station];
+      int32_t average = averages[slot] >> 8;
+      if (price <= 0)
+      {
+        continue;
+      }
+      if ((activeAlarms[fuel][station / 32] >> (station % 32)) & 1)
+      {
+        price -= band;
+      }
+      for (uint32_t count = 0; count < ruleCount[slot]; count++)
+      {
+        const Rule& rule = ruleTable[slot * fuelRulesPerSlot + count];
+        bool isMatch = (rule.hours & hourBit) && (rule.weekdays & dayBit) &&
+                       ((rule.limit <= 0) || (price < rule.limit)) &&
+                       ((rule.belowAverage <= 0) || (isAverageValid && (average > 0) && (price <= average - rule.belowAverage))) &&
+                       (!rule.isCheapest || (price <= cheapest[fuel]));
+        if (isMatch)
+        {
+          alarms[fuel][station / 32] |= 1UL << (station % 32);
+          break;
+        }
+      }
+    }
+  }
+}
+
+uint32_t FuelRules::getNumberOfRules()
+{
+  return numberOfRules;
+}
+
+int16_t FuelRules::getAverage(uint32_t station, uint32_t fuel)
+{
+  // tenth cent, 0: no sample yet
+  if ((averages == NULL) || (station >= numberOfStations) || (fuel >= numberOfFuelTypes))
+  {
+    return 0;
+  }
+  return averages[station * numberOfFuelTypes + fuel] >> 8;
+}
+
+void FuelRules::debugPrint()
+{
+  DEB_PL("Fuel rules:");
+  DEB_PF("    rules              : %u (%u slot entries dropped)\n", numberOfRules, droppedRules);
+  DEB_PF("    table              : %u bytes\n", numberOfStations * numberOfFuelTypes * (fuelRulesPerSlot * sizeof(Rule) + sizeof(uint8_t) + sizeof(int32_t)));
+  DEB_PF("    averages since     : %ld\n", (long)averageStartTime);
+  for (uint32_t slot = 0; slot < numberOfStations * numberOfFuelTypes; slot++)
+  {
+    for (uint32_t count = 0; count < ruleCount[slot]; count++)
+    {
+      const Rule& rule = ruleTable[slot * fuelRulesPerSlot + count];
+      DEB_PF("       [%2u] %-9s limit %4d  below average %3d  cheapest %u  days %02x  hours %06x\n", slot / numberOfFuelTypes,
+             fuelTypeName(static_cast<FuelType>(slot % numberOfFuelTypes)), rule.limit, rule.belowAverage, rule.isCheapest,
+             rule.weekdays, rule.hours);
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+#include "trace.h"
+#include "config.h"
+
+class FuelStations;
+
+
+class FuelRules
+{
+    /*
+       Alarm rules of tanken.json ("Rules"), compiled at load time into a flat table
+
+       table    : fuelRulesPerSlot entries per station and fuel type - [station * 3 + fuel]
+       rule     : all given conditions must hold - price below a limit, below the 7-day average
+                  by an amount, cheapest open station of this fuel type, weekday and hour window
+       slot     : alarm if one of its rules holds; an active alarm is evaluated with the price lowered
+                  by the hysteresis band
+       averages : exponential moving average per station and fuel type (time constant fuelAverageTime)
+
+       evaluate() is linear in the number of stations and does not allocate.
+    */
+  public:
+    FuelRules();
+
+    bool begin(uint32_t stations);
+    bool compile(FuelStations& fuelStations, const char* station, const char* fuel, const char* days, const char* hours,
+                 float below, float belowAverage, bool cheapest);
+    void updateAverages(int16_t* const prices[], const uint32_t* openStations, time_t time);
+    void evaluate(int16_t* const prices[], const uint32_t* openStations, time_t time, uint32_t* const activeAlarms[],
+                  int16_t band, uint32_t* const alarms[]);
+    uint32_t getNumberOfRules();
+    int16_t getAverage(uint32_t station, uint32_t fuel);
+
+    void debugPrint();
+
+  private:
+    struct Rule
+    {
+      int16_t limit;             // tenth cent, 0: no limit
+      int16_t belowAverage;      // tenth cent, 0: no average condition
+      uint32_t hours;            // bit per hour of the day
+      uint8_t weekdays;          // bit per tm_wday (0: Sunday)
+      bool isCheapest;
+    };
+
+    Rule* ruleTable = NULL;
+    uint8_t* ruleCount = NULL;           // per station and fuel type
+    int32_t* averages = NULL;            // tenth cent * 256, 0: no sample yet
+    uint32_t numberOfStations = 0;
+    uint32_t numberOfRules = 0;
+    uint32_t droppedRules = 0;
+    time_t averageTime = 0;              // last update of the averages
+    time_t averageStartTime = 0;         // first update: belowAverage needs fuelAverageMinAge
+
+    static uint32_t parseRanges(const char* text, int32_t first, int32_t last, bool isEndExclusive);
+    bool addRule(uint32_t station, uint32_t fuel, const Rule& rule);
+};
@@ -0,0 +1,202 @@
+#include "trace.h"
+
+#include "monitor.h"
+
+TaskLoad::TaskLoad() {}
+
+void TaskLoad::begin()
+{
+  busyStartTime = micros();
+}
+
+void TaskLoad::end()
+{
+  busyTime += micros() - busyStartTime;
+}
+
+uint32_t TaskLoad::getLoad()
+{
+  unsigned long currentTime = micros();
+  unsigned long elapsed = currentTime - windowStartTime;
+  uint32_t load = 0;
+
+  if (elapsed)
+  {
+    load = (uint32_t)(((uint64_t)busyTime * 1000ULL) / elapsed);
+  }
+  if (load > maxLoad)
+    maxLoad = load;
+  busyTime = 0;
+  windowStartTime = currentTime;
+  return load;
+}
+
+void TaskLoad::debugPrint(const char* taskName)
+{
+  uint32_t load = getLoad();
+  DEB_PF("    %-18s : %3u.%u%% CPU (max %u.%u%%)\n", taskName, load / 10, load % 10, maxLoad / 10, maxLoad % 10);
+}
+
+// ============================================================================================================================
+
+Monitor::Monitor() {}
+
+void Monitor::loopBegin()
+{
+  unsigned long currentTime = micros();
+
+  if (loopCount)
+  {
+    unsigned long gap = currentTime - loopStartTime;
+    if (gap > maxLoopGap)
+      maxLoopGap = gap;
+  }
+  loopStartTime = currentTime;
+}
+
+void Monitor::loopEnd()
+{
+  unsigned long currentTime = micros();
+  unsigned long duration = currentTime - loopStartTime;
+
+  loopCount++;
+  sumLoopDuration += duration;
+  if (duration > maxLoopDuration)
+    maxLoopDuration = duration;
+
+  uint32_t freeHeap = ESP.getFreeHeap();
+  if (freeHeap < minFreeHeap)
+    minFreeHeap = freeHeap;
+}
+
+void Monitor::reset()
+{
+  loopCount = 0;
+  sumLoopDuration = 0;
+  maxLoopDuration = 0;
+  maxLoopGap = 0;
+  minFreeHeap = UINT32_MAX;
+}
+
+unsigned long Monitor::getMaxLoopDuration()
+{
+  return maxLoopDuration;
+}
+
+unsigned long Monitor::getMaxLoopGap()
+{
+  return maxLoopGap;
+}
+
+uint32_t Monitor::getMinFreeHeap()
+{
+  return minFreeHeap;
+}
+
+
+bool Monitor::startScript(const char* fileName)
+{
+  TRACE();
+
+  stopScript();
+  scriptFile = LITTLEFS.open(fileName);
+  if (!scriptFile || scriptFile.isDirectory())
+  {
+    DEB_PF("MONITOR: event script '%s' not found\n", fileName);
+    return false;
+  }
+  DEB_PF("MONITOR: event script '%s' started\n", fileName);
+  scriptRunning = readScriptLine();
+  return scriptRunning;
+}
+
+void Monitor::stopScript()
+{
+  if (scriptFile)
+  {
+    scriptFile.close();
+  }
+  if (scriptRunning)
+  {
+    DEB_PL("MONITOR: event script finished");
+  }
+  scriptRunning = false;
+  scriptCommand = -1;
+}
+
+bool Monitor::isScriptRunning()
+{
+  return scriptRunning;
+}
+
+int Monitor::nextScriptCommand()
+{
+  if (!scriptRunning)
+  {
+    return -1;
+  }
+  if ((long)(millis() - scriptDueTime) < 0)
+  {
+    // not yet due
+    return -1;
+  }
+
+  int command = scriptCommand;
+  DEB_PF("MONITOR: script command '%c'\n", command);
+  if (!readScriptLine())
+  {
+    stopScript();
+  }
+  return command;
+}
+
+bool Monitor::readScriptLine()
+{
+  // read next line "<delay in ms> <command>"; empty lines and lines starting with '#' are skipped
+  char line[32];
+
+  while (scriptFile.available())
+  {
+    size_t length = scriptFile.readBytesUntil('\n', line, sizeof(line) - 1);
+    line[length] = 0;
+    if (length == sizeof(line) - 1)
+    {
+      // the rest of a long line (comment) must not be read as the next line
+      while (scriptFile.available() && (scriptFile.read() != '\n'))
+      {
+      }
+    }
+    if ((length == 0) || (line[0] == '#') || (line[0] == '\r'))
+    {
+      continue;
+    }
+
+    char* commandPointer;
+    unsigned long delayTime = strtoul(line, &commandPointer, 10);
+    while (*commandPointer == ' ')
+    {
+      commandPointer++;
+    }
+    if ((*commandPointer == 0) || (*commandPointer == '\r'))
+    {
+      DEB_PF("MONITOR: script line '%s' ignored\n", line);
+      continue;
+    }
+    scriptCommand = *commandPointer;
+    scriptDueTime = millis() + delayTime;
+    return true;
+  }
+  return false;
+}
+
+
+void Monitor::debugPrint()
+{
+  DEB_PL("Monitor:");
+  DEB_PF("    loops              : %lu\n", loopCount);
+  DEB_PF("    loop duration avg  : %lu us\n", loopCount ? sumLoopDuration / loopCount : 0);
+  DEB_PF("    loop duration max  : %lu us\n", maxLoopDuration);
+  DEB_PF("    loop gap max       : %lu us\n", maxLoopGap);
+  DEB_PF("    free heap min      : %u (since boot %u)\n", minFreeHeap, ESP.getMinFreeHeap());
+  DEB_PF("    event script       : %s\n", scriptRunning ? "running" : "idle");
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <Arduino.h>
+#include <LITTLEFS.h>
+
+#include "trace.h"
+#include "config.h"
+
+
+class TaskLoad
+{
+    /*
+       CPU usage of a task: share of time between begin() and end() (busy)
+       of the time elapsed since the last call of getLoad().
+       begin()/end() are called by the task itself around its work.
+    */
+  public:
+    TaskLoad();
+
+    void begin();
+    void end();
+    uint32_t getLoad();     // in 1/1000; starts a new measurement window
+    void debugPrint(const char* taskName);
+
+  private:
+    unsigned long busyStartTime = 0;
+    unsigned long windowStartTime = 0;
+    unsigned long busyTime = 0;
+    uint32_t maxLoad = 0;
+};
+
+// ============================================================================================================================
+class Monitor
+{
+    /*
+       Runtime measurements of the radio firmware
+
+       loop() timing  duration of a single loop() pass and the time between two loop() starts
+                      (the gap is what the VS1053 feed in player.run() has to survive)
+       heap           lowest free heap seen at the end of loop()
+       event script   replay of test commands from file eventScriptFile
+                      (same characters as the serial test input, one command per line:
+                       "<delay in ms> <command>")
+    */
+  public:
+    Monitor();
+
+    // loop() timing and heap
+    void loopBegin();
+    void loopEnd();
+    void reset();
+    unsigned long getMaxLoopDuration();
+    unsigned long getMaxLoopGap();
+    uint32_t getMinFreeHeap();
+
+    // scripted event feed
+    bool startScript(const char* fileName = eventScriptFile);
+    void stopScript();
+    bool isScriptRunning();
+    int nextScriptCommand();
+
+    void debugPrint();
+
+  private:
+    unsigned long loopCount = 0;
+    unsigned long loopStartTime = 0;
+    unsigned long sumLoopDuration = 0;
+    unsigned long maxLoopDuration = 0;
+    unsigned long maxLoopGap = 0;
+    uint32_t minFreeHeap = UINT32_MAX;
+
+    File scriptFile;
+    bool scriptRunning = false;
+    unsigned long scriptDueTime = 0;
+    int scriptCommand = -1;
+    bool readScriptLine();
+};
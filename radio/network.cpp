@@ -283,7 +283,9 @@ const char* Networks::getCurrentIP()
 {
   if (isConnected)
   {
-    return WiFi.localIP().toString().c_str();
+    // copied: the String of toString() is gone after this statement
+    snprintf(currentIP, sizeof(currentIP), "%s", WiFi.localIP().toString().c_str());
+    return currentIP;
   }
   return "";
 }
@@ -88,6 +88,7 @@ class Networks
 
     // handle connection
     bool isConnected = false;
+    char currentIP[16];
     unsigned long lastCheckTime;
     const unsigned long checkInterval {5000};
 };
@@ -1,18 +1,73 @@
 
 #include "player.h"
 
+#include <HTTPClient.h>
+
 // The one and only mp3 player board
 VS1053 mp3(vs1053CS, vs1053DCS, vs1053DREQ);
 
+// Player is used by loop(), the audio feed task and the standby task
+//   playerMutex : player state - the getters of loop() only wait for this one
+//   audioMutex  : the vs1053 library (one stream client) - always taken before playerMutex
+// Stations are connected by run() of the feed task only, with audioMutex but without playerMutex,
+// so loop() is not blocked by DNS and connecttohost().
+class PlayerLock
+{
+  public:
+    PlayerLock(SemaphoreHandle_t mutex) : mutex(mutex)
+    {
+      if (mutex != NULL)
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+    }
+    ~PlayerLock()
+    {
+      if (mutex != NULL)
+        xSemaphoreGiveRecursive(mutex);
+    }
+
+  private:
+    SemaphoreHandle_t mutex;
+};
+
+class AudioLock
+{
+  public:
+    // playerMutex NULL: audioMutex only
+    AudioLock(SemaphoreHandle_t audioMutex, SemaphoreHandle_t playerMutex) : audioMutex(audioMutex), playerMutex(playerMutex)
+    {
+      if (audioMutex != NULL)
+        xSemaphoreTakeRecursive(audioMutex, portMAX_DELAY);
+      if (playerMutex != NULL)
+        xSemaphoreTakeRecursive(playerMutex, portMAX_DELAY);
+    }
+    ~AudioLock()
+    {
+      if (playerMutex != NULL)
+        xSemaphoreGiveRecursive(playerMutex);
+      if (audioMutex != NULL)
+        xSemaphoreGiveRecursive(audioMutex);
+    }
+
+  private:
+    SemaphoreHandle_t audioMutex;
+    SemaphoreHandle_t playerMutex;
+};
+
 Player::Player() {}
 
-void Player::begin(RadioStations& stationList, RadioStationKeys& keyList)
+void Player::begin(RadioStations& stationList, RadioStationKeys& keyList, TtsCache& speechCache, ClipSpeech& clips)
 {
   TRACE();
 
   stations = stationList;
   keys = keyList;
+  ttsCache = &speechCache;
+  clipSpeech = &clips;
   memset(currentTitleText, 0, titleTextLength);
+  memset(titleTextCopy, 0, titleTextLength);
+  playerMutex = xSemaphoreCreateRecursiveMutex();
+  audioMutex = xSemaphoreCreateRecursiveMutex();
+  dnsPrefetch.begin();
 
   DEB_PF("SPI (%d %d %d)\n", spiSCK, spiMISO, spiMOSI);
   SPI.begin(spiSCK, spiMISO, spiMOSI);
@@ -28,6 +83,8 @@ void Player::begin(RadioStations& stationList, RadioStationKeys& keyList)
 
 bool Player::isPlaying()
 {
+  PlayerLock lock(playerMutex);
+
   switch (state)
   {
     case PlayerState::PLAYING:
@@ -47,6 +104,8 @@ bool Player::isPlaying()
 
 bool Player::setCurrentStationIndex(int32_t index, int32_t maxIndex)
 {
+  PlayerLock lock(playerMutex);
+
   if ((index >= 0) && (index < maxIndex))
   {
     currentStationIndex = index;
@@ -57,23 +116,45 @@ bool Player::setCurrentStationIndex(int32_t index, int32_t maxIndex)
 
 int32_t Player::getCurrentStationIndex()
 {
+  PlayerLock lock(playerMutex);
+
   return currentStationIndex;
 }
 
 void Player::setTitleText(const char* newTitleText)
 {
+  PlayerLock lock(playerMutex);
+
   strncpy(currentTitleText, newTitleText, titleTextLength);
+  titleHasChanged = true;
+}
+
+bool Player::hasTitleChanged()
+{
+  PlayerLock lock(playerMutex);
+
+  if (titleHasChanged)
+  {
+    titleHasChanged = false;
+    return true;
+  }
+  return false;
 }
 
 char* Player::getTitleText()
 {
-  return currentTitleText;
+  // copy: the title may be changed by the audio feed task while the caller is using it
+  PlayerLock lock(playerMutex);
+
+  strncpy(titleTextCopy, currentTitleText, titleTextLength);
+  return titleTextCopy;
 }
 
 // play a radio station
 bool Player::play(int32_t stationToPlay)
 {
   TRACE();
+  PlayerLock lock(playerMutex);
 
   if ((stationToPlay == currentStationIndex) && isPlaying())
   {
@@ -97,11 +178,15 @@ bool Player::play(int32_t stationToPlay)
       return false;
       break;
 
+    case PlayerState::SWITCH:
+      // connect running (without lock): run() switches again when it is done
+      nextStationIndex = stationToPlay;
+      break;
+
     // other cases:
     // should not happen, but not really a problem - don't change something
     case PlayerState::PLAYING_FILE:
     case PlayerState::PLAYING_SPEECH:
-    case PlayerState::SWITCH:
       break;
   }
 
@@ -111,74 +196,261 @@ bool Player::play(int32_t stationToPlay)
 bool Player::playKey(int32_t key)
 {
   TRACE();
+  PlayerLock lock(playerMutex);
 
   DEB_PF("PLAYER: key: %d   stationIndex: %d\n", key, keys.getStationIndex(key));
+  lastKeyStationIndex = keys.getStationIndex(key);
   return play(keys.getStationIndex(key));
 }
 
 bool Player::playStation(int32_t index)
 {
+  // connected by run() of the feed task, like a station switch
   TRACE();
+  PlayerLock lock(playerMutex);
 
   DEB_PF("PLAYER: direct play %d '%s'\n", index, stations[index].getName());
-  mp3.connecttohost(stations[index].getUrl());
-  currentStationIndex = index;
-  mp3.setVolume(defaultVolume);
   currentVolume = defaultVolume;
-  state = PlayerState::PLAYING;
-  stationHasChanged = true;
+  nextStationIndex = index;
+  state = PlayerState::SWITCH;
   return true;
 }
 
 bool Player::playFile(const char* fileName)
 {
+  // single announcement: replaces a running one
   TRACE();
+  AudioLock lock(audioMutex, playerMutex);
 
   DEB_PF("PLAYER: direct play file '%s'\n", fileName);
-  if ((state != PlayerState::PLAYING_FILE) && (state != PlayerState::PLAYING_SPEECH))
+  announcementCount = 0;
+  queueFile(fileName);
+  return beginAnnouncements();
+}
+
+bool Player::playSpeech(const char* text)
+{
+  TRACE();
+  AudioLock lock(audioMutex, playerMutex);
+
+  DEB_PF("PLAYER: play text '%s'\n", text);
+  announcementCount = 0;
+  queueSpeech(text);
+  return beginAnnouncements();
+}
+
+// ============================================================================================================================
+// announcements: files, speech and stations played back to back, then the station is connected again
+
+bool Player::queueAnnouncement(AnnouncementType type, const char* text, int32_t stationIndex)
+{
+  PlayerLock lock(playerMutex);
+
+  if (announcementCount >= announcementQueueLength)
   {
-    lastStateBeforeFileOrSpeech = state;
+    DEB_PL("PLAYER: announcement queue full");
+    return false;
   }
-  stop();
-  mp3.connecttoFS(LITTLEFS, fileName);
-  mp3.setVolume(defaultVolume);
-  currentVolume = defaultVolume;
-  state = PlayerState::PLAYING_FILE;
+  Announcement& item = announcements[(announcementHead + announcementCount) % announcementQueueLength];
+  item.type = type;
+  strncpy(item.text, text, alarmTextLength - 1);
+  item.text[alarmTextLength - 1] = 0;
+  item.stationIndex = stationIndex;
+  item.sequence = ++announcementSequence;
+  item.preparedFileIndex = -1;
+  announcementCount++;
   return true;
 }
 
-void Player::setSpeechPending(const bool isPending)
+bool Player::queueFile(const char* fileName)
 {
-  isSpeechPending = isPending;
+  return queueAnnouncement(AnnouncementType::FILE, fileName, -1);
 }
 
-bool Player::getSpeechPending()
+bool Player::queueSpeech(const char* text)
 {
-  return isSpeechPending;
+  return queueAnnouncement(AnnouncementType::SPEECH, text, -1);
 }
 
-bool Player::playSpeech(const char* text)
+bool Player::queueStation(int32_t stationIndex)
+{
+  return queueAnnouncement(AnnouncementType::STATION, "", stationIndex);
+}
+
+bool Player::isAnnouncing()
 {
+  PlayerLock lock(playerMutex);
+
+  return (state == PlayerState::PLAYING_FILE) || (state == PlayerState::PLAYING_SPEECH);
+}
+
+bool Player::startAnnouncements()
+{
+  // called by loop(): the first speech is prepared here, the following ones by prepareAnnouncement()
+  // a running announcement is not interrupted: the new items follow it
   TRACE();
+  prepareAnnouncement();
 
-  DEB_PF("PLAYER: play text '%s'\n", text);
-  if ((state != PlayerState::PLAYING_FILE) && (state != PlayerState::PLAYING_SPEECH))
+  AudioLock lock(audioMutex, playerMutex);
+  if (announcementCount == 0)
+  {
+    return false;
+  }
+  if (isAnnouncing())
+  {
+    DEB_PF("PLAYER: %u announcement(s) queued\n", announcementCount);
+    return true;
+  }
+  return beginAnnouncements();
+}
+
+bool Player::beginAnnouncements()
+{
+  // starts the first item now; the radio state is kept for the resume
+  AudioLock lock(audioMutex, playerMutex);
+
+  if (announcementCount == 0)
+  {
+    return false;
+  }
+  if (!isAnnouncing())
   {
     lastStateBeforeFileOrSpeech = state;
+    volumeBeforeFileOrSpeech = currentVolume;
+    if (state == PlayerState::SWITCH)
+    {
+      // selected station not connected yet (run() holds audioMutex while connecting): it is resumed
+      currentStationIndex = nextStationIndex;
+      lastStateBeforeFileOrSpeech = PlayerState::PLAYING;
+    }
+  }
+  nextAnnouncement();
+  return true;
+}
+
+void Player::prepareAnnouncement()
+{
+  // called by loop() while the current item plays: the next speech is composed from clips
+  // (or its TTS download is requested) - composing in the feed task would starve the decoder
+  char text[alarmTextLength];
+  char fileName[ttsFileNameLength];
+  int8_t fileIndex;
+  uint32_t sequence;
+  {
+    PlayerLock lock(playerMutex);
+    if (announcementCount == 0)
+    {
+      return;
+    }
+    Announcement& item = announcements[announcementHead];
+    if ((item.type != AnnouncementType::SPEECH) || (item.preparedFileIndex >= 0) || (item.sequence == preparedSequence))
+    {
+      return;
+    }
+    strcpy(text, item.text);
+    sequence = item.sequence;
+    preparedSequence = sequence;    // tried once
+    // two files: one may be playing while the next is composed
+    fileIndex = playingSpeechFile == 0 ? 1 : 0;
+    snprintf(fileName, sizeof(fileName), clipSpeechFileFormat, fileIndex);
+  }
+
+  bool isPrepared = false;
+  if (enableClipSpeech && clipSpeech->compose(text, fileName))
+  {
+    isPrepared = true;
+  }
+  else if (!ttsCache->isCached(text, speechLanguage))
+  {
+    // may be stored before the item is played
+    ttsCache->requestDownload(text, speechLanguage);
+  }
+
+  PlayerLock lock(playerMutex);
+  Announcement& item = announcements[announcementHead];
+  if (isPrepared && (announcementCount > 0) && (item.sequence == sequence))
+  {
+    item.preparedFileIndex = fileIndex;
+    preparedAnnouncementCount++;
+  }
+}
+
+void Player::nextAnnouncement()
+{
+  // end of file or speech (vs1053 callbacks) - or start of the queue
+  AudioLock lock(audioMutex, playerMutex);
+
+  if (announcementCount == 0)
+  {
+    playingSpeechFile = -1;
+    if (!resumeAfterFileOrSpeech())
+    {
+      // radio was off: the next announcement starts immediately
+      stop();
+    }
+    return;
+  }
+  Announcement item = announcements[announcementHead];
+  announcementHead = (announcementHead + 1) % announcementQueueLength;
+  announcementCount--;
+  playedAnnouncementCount++;
+
+  if (item.type == AnnouncementType::STATION)
+  {
+    // a stream does not end: the station becomes the one resumed after the rest of the queue
+    currentStationIndex = item.stationIndex;
+    lastStateBeforeFileOrSpeech = PlayerState::PLAYING;
+    nextAnnouncement();
+    return;
   }
+
   stop();
-  mp3.connecttospeech(text, "de");
+  char fileName[ttsFileNameLength];
+  playingSpeechFile = -1;
+  if (item.type == AnnouncementType::FILE)
+  {
+    mp3.connecttoFS(LITTLEFS, item.text);
+    state = PlayerState::PLAYING_FILE;
+  }
+  else if (item.preparedFileIndex >= 0)
+  {
+    // composed from clips while the previous item played (end is reported by vs1053_eof_mp3)
+    snprintf(fileName, sizeof(fileName), clipSpeechFileFormat, item.preparedFileIndex);
+    mp3.connecttoFS(LITTLEFS, fileName);
+    playingSpeechFile = item.preparedFileIndex;
+    state = PlayerState::PLAYING_SPEECH;
+  }
+  else if (ttsCache->getFile(item.text, speechLanguage, fileName, sizeof(fileName)))
+  {
+    // spoken before: local file, no round trip to the TTS service (end is reported by vs1053_eof_mp3)
+    DEB_PF("PLAYER: speech from cache %s\n", fileName);
+    mp3.connecttoFS(LITTLEFS, fileName);
+    state = PlayerState::PLAYING_SPEECH;
+  }
+  else
+  {
+    unpreparedSpeechCount++;
+    mp3.connecttospeech(item.text, speechLanguage);
+    ttsCache->requestDownload(item.text, speechLanguage);
+    state = PlayerState::PLAYING_SPEECH;
+  }
   mp3.setVolume(defaultVolume);
   currentVolume = defaultVolume;
-  state = PlayerState::PLAYING_SPEECH;
-  return true;
 }
 
 bool Player::resumeAfterFileOrSpeech()
 {
+  AudioLock lock(audioMutex, playerMutex);
+
   if (lastStateBeforeFileOrSpeech == PlayerState::PLAYING)
   {
+    // the library has only one client: the announcement has closed the stream and the station
+    // is connected again (cached stream URL) - the gap until audio is measured in updateStreamSession()
+    // TODO: keep the stream open (or buffered) during announcements and resume without a reconnect -
+    //       needs a second client in vs1053_ext, connecttoFS()/connecttospeech() close the stream
+    reconnectGapStartTime = millis();
     playStation(currentStationIndex);
+    currentVolume = volumeBeforeFileOrSpeech;   // unmuted with this volume when connected
     return true;
   }
   return false;
@@ -187,6 +459,7 @@ bool Player::resumeAfterFileOrSpeech()
 bool Player::playNextPrevious(bool next)
 {
   TRACE();
+  PlayerLock lock(playerMutex);
 
   if (!isPlaying())
   {
@@ -195,34 +468,60 @@ bool Player::playNextPrevious(bool next)
     return false;
   }
 
-  if (next)
+  nextStationIndex = getNeighbourIndex(currentStationIndex, next ? 1 : -1);
+  return play(nextStationIndex);
+}
+
+int32_t Player::getNeighbourIndex(int32_t index, int32_t steps)
+{
+  // station list is a ring
+  int32_t numberOfStations = stations.getNumberOfStations();
+  int32_t neighbour = (index + steps) % numberOfStations;
+  return neighbour < 0 ? neighbour + numberOfStations : neighbour;
+}
+
+int32_t Player::scrollStation(int32_t steps)
+{
+  // move the preview only: the connect waits until the encoder settles (see updateScroll())
+  TRACE();
+  PlayerLock lock(playerMutex);
+
+  if (!isPlaying() || (steps == 0))
   {
-    if (currentStationIndex < stations.getNumberOfStations() - 1)
-    {
-      nextStationIndex = currentStationIndex + 1;
-    }
-    else
-    {
-      nextStationIndex = 0;
-    }
+    return -1;
   }
-  else
+  scrollTargetIndex = getNeighbourIndex(scrollTargetIndex >= 0 ? scrollTargetIndex : currentStationIndex, steps);
+  lastScrollTime = millis();
+  scrollStepCount += abs(steps);
+  return scrollTargetIndex;
+}
+
+bool Player::updateScroll()
+{
+  PlayerLock lock(playerMutex);
+
+  if ((scrollTargetIndex < 0) || (millis() - lastScrollTime < stationScrollSettleTime))
   {
-    if (currentStationIndex == 0)
-    {
-      nextStationIndex = stations.getNumberOfStations() - 1;
-    }
-    else
-    {
-      nextStationIndex = currentStationIndex - 1;
-    }
+    return false;
   }
+  DEB_PF("PLAYER: scroll settled at %d '%s'\n", scrollTargetIndex, stations[scrollTargetIndex].getName());
+  int32_t targetIndex = scrollTargetIndex;
+  scrollTargetIndex = -1;
+  if (targetIndex == currentStationIndex)
+  {
+    // scrolled back: keep playing, but show the current station again
+    stationHasChanged = true;
+    return false;
+  }
+  scrollConnectCount++;
+  nextStationIndex = targetIndex;
   return play(nextStationIndex);
 }
 
 bool Player::stop()
 {
   TRACE();
+  AudioLock lock(audioMutex, playerMutex);
 
   if (!isPlaying())
   {
@@ -236,6 +535,9 @@ bool Player::stop()
     case PlayerState::PLAYING:
     case PlayerState::PLAYING_FILE:
     case PlayerState::PLAYING_SPEECH:
+      endStreamSession();
+      connectingStationIndex = -1;
+      reconnectGapStartTime = 0;
       mp3.setVolume(0);
       currentVolume = 0;
       mp3.stop_mp3client();
@@ -260,6 +562,8 @@ bool Player::stop()
 
 bool Player::hasStationChanged()
 {
+  PlayerLock lock(playerMutex);
+
   if (stationHasChanged)
   {
     stationHasChanged = false;
@@ -271,6 +575,24 @@ bool Player::hasStationChanged()
 
 void Player::run()
 {
+  // called by the feed task without a lock: the connect of a station switch runs without playerMutex
+  AudioLock audioLock(audioMutex, NULL);
+  int32_t switchIndex = -1;
+
+  {
+    PlayerLock lock(playerMutex);
+    runState(switchIndex);
+  }
+  if (switchIndex >= 0)
+  {
+    switchStation(switchIndex);
+  }
+}
+
+void Player::runState(int32_t& switchIndex)
+{
+  // switchIndex: set to the station run() has to connect to
+
   if (state != lastState)
   {
 #if defined(DEBUGGING)
@@ -305,31 +627,28 @@ void Player::run()
   switch (state)
   {
     case PlayerState::PLAYING:
+      mp3.loop();
+      checkUnderrun();
+      updateStreamSession();
+      break;
     case PlayerState::PLAYING_FILE:
     case PlayerState::PLAYING_SPEECH:
       mp3.loop();
+      checkUnderrun();
       break;
     case PlayerState::SWITCH:
+    {
       // mute
       mp3.setVolume(0);
       // switch station
-      DEB_PF("PLAYER: switch to station index %d '%s'\n", nextStationIndex, stations[nextStationIndex].getName());
+      switchIndex = nextStationIndex;
+      DEB_PF("PLAYER: switch to station index %d '%s'\n", switchIndex, stations[switchIndex].getName());
 
       memset(currentTitleText, 0, titleTextLength);
-      if (mp3.connecttohost(stations[nextStationIndex].getUrl()))
-      {
-        currentStationIndex = nextStationIndex;
-        stationHasChanged = true;
-      }
-      else
-      {
-        DEB_PF("PLAYER: warning: station switch failed, still playing %d '%s'", currentStationIndex, stations[currentStationIndex].getName());
-      }
-      // unmute
-      mp3.setVolume(currentVolume);
-      // play
-      state = PlayerState::PLAYING;
+      titleHasChanged = true;
+      endStreamSession();
       break;
+    }
 
     case PlayerState::NOT_INIT:
     case PlayerState::INIT:
@@ -338,13 +657,42 @@ void Player::run()
   }
 }
 
+void Player::switchStation(int32_t index)
+{
+  // called by run() with audioMutex only
+  bool isConnected = connectStation(index);
+  PlayerLock lock(playerMutex);
+
+  if (isConnected)
+  {
+    currentStationIndex = index;
+    stationHasChanged = true;
+    beginStreamSession();
+  }
+  else
+  {
+    DEB_PF("PLAYER: warning: station switch failed, still playing %d '%s'", currentStationIndex, stations[currentStationIndex].getName());
+    // unmute
+    mp3.setVolume(currentVolume);
+  }
+  // play - or switch again if another station was selected during the connect
+  if ((state == PlayerState::SWITCH) && (nextStationIndex == index))
+  {
+    state = PlayerState::PLAYING;
+  }
+}
+
 int32_t Player::getCurrentVolume()
 {
+  PlayerLock lock(playerMutex);
+
   return currentVolume;
 }
 
 void Player::changeVolume(bool increment)
 {
+  AudioLock lock(audioMutex, playerMutex);
+
   if (increment)
   {
     if (currentVolume < vs1053MaxVolume)
@@ -365,9 +713,621 @@ void Player::changeVolume(bool increment)
 void Player::setVolume(int32_t volume)
 {
   TRACE();
+  AudioLock lock(audioMutex, playerMutex);
 
   DEB_PF("PLAYER: current: %d   new: %d\n", currentVolume, volume);
   int32_t volumeToSet = volume < 0 ? 0 : (volume > vs1053MaxVolume ? vs1053MaxVolume : volume);
   mp3.setVolume(volumeToSet);
   currentVolume = volumeToSet;
 }
+
+void Player::checkUnderrun()
+{
+  // underrun: input buffer of the stream ran empty after it had been filled (not counted while connecting)
+  // the end of a file or speech empties the buffer as well: counted while PLAYING only
+  if (mp3.inBufferFilled() > 0)
+  {
+    inputBufferFilled = true;
+  }
+  else if (inputBufferFilled)
+  {
+    inputBufferFilled = false;
+    if (state == PlayerState::PLAYING)
+    {
+      underrunCount++;
+      stations[currentStationIndex].getStatistics().underrunCount++;
+      DEB_PF("PLAYER: underrun '%s'\n", stations[currentStationIndex].getName());
+    }
+  }
+}
+
+void Player::beginStreamSession()
+{
+  // stream connected: mp3.loop() feeds the decoder with whatever has arrived, there is no
+  // prebuffer to hold back - the library reads and decodes in the same call
+  StreamStatistics& statistics = stations[currentStationIndex].getStatistics();
+  statistics.connectCount++;
+  mp3.setVolume(currentVolume);
+  isWaitingForData = true;
+  inputBufferFilled = false;
+  connectTime = millis();
+  bitRate = 0;
+  rateWindowStartTime = connectTime;
+  rateWindowStartFill = 0;
+}
+
+void Player::updateStreamSession()
+{
+  StreamStatistics& statistics = stations[currentStationIndex].getStatistics();
+  unsigned long currentTime = millis();
+  uint32_t filled = mp3.inBufferFilled();
+
+  if (isWaitingForData && (filled > 0))
+  {
+    isWaitingForData = false;
+    statistics.lastTimeToFirstAudio = currentTime - connectTime;
+    statistics.averageTimeToFirstAudio = statistics.averageTimeToFirstAudio ?
+                                         (statistics.averageTimeToFirstAudio * 3 + statistics.lastTimeToFirstAudio) / 4 :
+                                         statistics.lastTimeToFirstAudio;
+    DEB_PF("PLAYER: first audio after %u ms\n", statistics.lastTimeToFirstAudio);
+    if (reconnectGapStartTime != 0)
+    {
+      // end of announcement to radio audio: time of the reconnect
+      lastReconnectGap = currentTime - reconnectGapStartTime;
+      reconnectGapSum += lastReconnectGap;
+      reconnectGapCount++;
+      if (lastReconnectGap > maxReconnectGap)
+        maxReconnectGap = lastReconnectGap;
+      reconnectGapStartTime = 0;
+      DEB_PF("PLAYER: radio audio %u ms after end of announcement (reconnect)\n", lastReconnectGap);
+    }
+  }
+
+  // received = change of buffer fill + consumed by the decoder (bit rate)
+  unsigned long elapsed = currentTime - rateWindowStartTime;
+  if (elapsed >= streamRateInterval)
+  {
+    int32_t received = (int32_t)filled - (int32_t)rateWindowStartFill + (int32_t)(bitRate * 125 * elapsed / 1000);
+    if ((received > 0) && bitRate)
+    {
+      uint32_t bytesPerSecond = received * 1000 / elapsed;
+      statistics.bytesPerSecond = statistics.bytesPerSecond ? (statistics.bytesPerSecond * 7 + bytesPerSecond) / 8 : bytesPerSecond;
+    }
+    rateWindowStartTime = currentTime;
+    rateWindowStartFill = filled;
+  }
+}
+
+void Player::endStreamSession()
+{
+  isWaitingForData = false;
+}
+
+bool Player::connectStation(int32_t index)
+{
+  // connect to the stream of a station (called by run() with audioMutex only)
+  // the cached resolved URL is tried first: saves loading the playlist and following redirects
+  // connecttohost() runs without playerMutex: loop() and the standby task are not blocked by it
+  RadioStation& station = stations[index];
+  StreamStatistics& statistics = station.getStatistics();
+  const char* stationUrl = station.getUrl();
+  char resolvedUrl[stationUrlLength];
+  unsigned long startTime = millis();
+  bool isConnected = false;
+  bool isCached;
+  bool isStandby;
+
+  {
+    PlayerLock lock(playerMutex);
+    isCached = station.getResolvedUrl() != NULL;
+    isStandby = standbyEnabled && (statistics.standbyTime != 0) && (startTime - statistics.standbyTime < standbyValidTime);
+    if (isCached)
+    {
+      // the standby task may replace it meanwhile
+      strncpy(resolvedUrl, station.getResolvedUrl(), sizeof(resolvedUrl) - 1);
+      resolvedUrl[sizeof(resolvedUrl) - 1] = 0;
+    }
+    connectingStationIndex = index;
+  }
+  // the lookup is answered from the lwIP table if the standby task has prefetched the host
+  uint32_t dnsTime = 0;
+  dnsPrefetch.prefetch(isCached ? resolvedUrl : stationUrl, &dnsTime);
+  if (isCached)
+  {
+    isConnected = mp3.connecttohost(resolvedUrl);
+    PlayerLock lock(playerMutex);
+    if (isConnected)
+    {
+      statistics.cacheHitCount++;
+    }
+    else
+    {
+      // stale: resolve again with the station URL (vs1053_lasthost will deliver the new one)
+      DEB_PF("PLAYER: cached URL of '%s' failed\n", station.getName());
+      station.clearResolvedUrl();
+      urlCacheChanged = true;
+      isCached = false;
+    }
+  }
+  if (!isConnected)
+  {
+    isConnected = mp3.connecttohost(stationUrl);
+  }
+
+  PlayerLock lock(playerMutex);
+  statistics.switchCount++;
+  statistics.lastSwitchTime = millis() - startTime;
+  statistics.lastDnsTime = dnsTime;
+  DEB_PF("PLAYER: connect '%s' %s after %u ms%s%s\n", station.getName(), isConnected ? "done" : "failed",
+         statistics.lastSwitchTime, isCached ? " (cached URL)" : "", isStandby ? " (standby)" : "");
+  if (isConnected)
+  {
+    // switch latency with and without standby preparation
+    if (isStandby)
+    {
+      standbySwitchCount++;
+      standbySwitchTimeSum += statistics.lastSwitchTime;
+    }
+    else
+    {
+      coldSwitchCount++;
+      coldSwitchTimeSum += statistics.lastSwitchTime;
+    }
+    requestStandby(index);
+  }
+  return isConnected;
+}
+
+void Player::setResolvedUrl(const char* url)
+{
+  // called by vs1053_lasthost: URL of the stream really connected
+  PlayerLock lock(playerMutex);
+
+  if ((connectingStationIndex < 0) || (url == NULL) || (url[0] == 0))
+  {
+    return;
+  }
+  RadioStation& station = stations[connectingStationIndex];
+  if (strcmp(url, station.getUrl()) == 0)
+  {
+    // no playlist, no redirect: nothing to cache
+    return;
+  }
+  const char* resolvedUrl = station.getResolvedUrl();
+  if ((resolvedUrl != NULL) && (strcmp(url, resolvedUrl) == 0))
+  {
+    // already known
+    return;
+  }
+  DEB_PF("PLAYER: resolved URL of '%s': %s\n", station.getName(), url);
+  station.setResolvedUrl(url, time(NULL));
+  urlCacheChanged = true;
+}
+
+bool Player::hasUrlCacheChanged()
+{
+  PlayerLock lock(playerMutex);
+
+  if (urlCacheChanged)
+  {
+    urlCacheChanged = false;
+    return true;
+  }
+  return false;
+}
+
+uint32_t Player::copyUrlCache(UrlCacheEntry* entries, uint32_t maxEntries)
+{
+  // snapshot for Storage::putUrlCache(): feed and standby task write the resolved URLs
+  PlayerLock lock(playerMutex);
+  uint32_t numberOfEntries = 0;
+
+  for (uint32_t index = 0; (index < stations.getNumberOfStations()) && (numberOfEntries < maxEntries); index++)
+  {
+    // unknown or expired: not written
+    const char* resolvedUrl = stations[index].getResolvedUrl();
+    if (resolvedUrl == NULL)
+    {
+      continue;
+    }
+    UrlCacheEntry& entry = entries[numberOfEntries++];
+    entry.stationIndex = index;
+    strncpy(entry.resolvedUrl, resolvedUrl, sizeof(entry.resolvedUrl) - 1);
+    entry.resolvedUrl[sizeof(entry.resolvedUrl) - 1] = 0;
+    entry.resolvedTime = stations[index].getResolvedTime();
+  }
+  return numberOfEntries;
+}
+
+void Player::setBitRate(uint32_t kBitPerSecond)
+{
+  PlayerLock lock(playerMutex);
+
+  bitRate = kBitPerSecond;
+}
+
+// ============================================================================================================================
+// audio feed task: calls run() (and by that mp3.loop()) independent of loop()
+
+void audioFeedTask(void* parameters);
+
+bool Player::beginFeedTask()
+{
+  TRACE();
+
+  BaseType_t retValue = xTaskCreatePinnedToCore(
+                          audioFeedTask,           /* Task function. */
+                          "AudioFeedTask",         /* String with name of task. */
+                          audioFeedTaskStackSize,  /* Stack size in bytes. */
+                          (void*)this,             /* Parameter passed as input of the task: This Player object*/
+                          audioFeedTaskPriority,   /* Priority of the task: above loop() */
+                          &feedTaskHandle,         /* Task handle. */
+                          audioFeedTaskCore);      /* Core */
+  if (retValue != pdPASS)
+  {
+    DEB_PL("PLAYER: creation of audio feed task failed");
+    feedTaskHandle = NULL;
+    return false;
+  }
+  DEB_PF("PLAYER: audio feed task created on core %d, priority %d\n", audioFeedTaskCore, audioFeedTaskPriority);
+  return true;
+}
+
+void Player::runFeedTask()
+{
+  unsigned long lastFeedTime = micros();
+
+  while (1)
+  {
+    bool isFeeding;
+    feedTaskLoad.begin();
+    run();
+    feedTaskLoad.end();
+    {
+      PlayerLock lock(playerMutex);
+      isFeeding = (state == PlayerState::PLAYING) || (state == PlayerState::PLAYING_FILE) || (state == PlayerState::PLAYING_SPEECH);
+    }
+
+    unsigned long currentTime = micros();
+    if (isFeeding)
+    {
+      feedIntervals.record(currentTime - lastFeedTime);
+    }
+    lastFeedTime = currentTime;
+    vTaskDelay(audioFeedInterval);
+  }
+}
+
+void Player::debugPrint()
+{
+  DEB_PL("Player:");
+  DEB_PF("    feed task          : %s\n", feedTaskHandle ? "running" : "not running - run() called by loop()");
+  feedTaskLoad.debugPrint("audio feed task");
+  DEB_PF("    feed interval      : min %u  avg %u  p99 %u  max %u us (%u feeds)\n", feedIntervals.getMin(), feedIntervals.getAverage(),
+         feedIntervals.getPercentile(99), feedIntervals.getMax(), feedIntervals.getCount());
+  DEB_PF("    buffer underruns   : %u\n", underrunCount);
+  DEB_PF("    input buffer       : %u bytes filled, %u free%s\n", mp3.inBufferFilled(), mp3.inBufferFree(), isWaitingForData ? " (connecting)" : "");
+  DEB_PF("    standby            : %s, %u prepared, %u failed, %u skipped (free heap < %u), %u not probed (https, cached)\n",
+         standbyEnabled ? "on" : "off", standbyPrepareCount, standbyFailCount, standbySkipCount, standbyMinFreeHeap, standbyNotProbedCount);
+  DEB_PF("    announcements      : %u played, %u waiting, %u speech prepared, %u spoken online\n", playedAnnouncementCount,
+         announcementCount, preparedAnnouncementCount, unpreparedSpeechCount);
+  DEB_PF("    reconnect after ann: last %u ms  avg %u ms  max %u ms (%u)\n", lastReconnectGap,
+         reconnectGapCount ? reconnectGapSum / reconnectGapCount : 0, maxReconnectGap, reconnectGapCount);
+  DEB_PF("    scrolling          : %u steps, %u connects\n", scrollStepCount, scrollConnectCount);
+  dnsPrefetch.debugPrint();
+  DEB_PF("    switch time        : standby %u ms avg (%u)  cold %u ms avg (%u)\n",
+         standbySwitchCount ? standbySwitchTimeSum / standbySwitchCount : 0, standbySwitchCount,
+         coldSwitchCount ? coldSwitchTimeSum / coldSwitchCount : 0, coldSwitchCount);
+  if (currentStationIndex >= 0)
+  {
+    DEB_PF("    station %3d        : ", currentStationIndex);
+    stations[currentStationIndex].debugPrint();
+  }
+}
+
+// ==================================================================================
+void audioFeedTask(void* parameters)
+{
+  TRACE();
+  Player* player = (Player*)parameters;
+
+  DEB_P("audioFeedTask() running on core ");
+  DEB_PL(xPortGetCoreID());
+
+  player->runFeedTask();
+
+  // emergency case:
+  vTaskDelete(NULL);
+}
+
+// ============================================================================================================================
+// warm standby: the stations most likely played next are resolved while the current one plays
+// (the library has a single stream client, so the standby work is everything connecttohost()
+// would do before the audio data: playlist, redirects - the result goes to the URL cache)
+
+void standbyTask(void* parameters);
+
+bool Player::beginStandbyTask()
+{
+  TRACE();
+
+  BaseType_t retValue = xTaskCreatePinnedToCore(
+                          standbyTask,             /* Task function. */
+                          "StandbyTask",           /* String with name of task. */
+                          standbyTaskStackSize,    /* Stack size in bytes. */
+                          (void*)this,             /* Parameter passed as input of the task: This Player object*/
+                          standbyTaskPriority,     /* Priority of the task. */
+                          &standbyTaskHandle,      /* Task handle. */
+                          standbyTaskCore);        /* Core */
+  if (retValue != pdPASS)
+  {
+    DEB_PL("PLAYER: creation of standby task failed");
+    standbyTaskHandle = NULL;
+    return false;
+  }
+  return true;
+}
+
+void Player::setStandby(bool isEnabled)
+{
+  PlayerLock lock(playerMutex);
+
+  DEB_PF("PLAYER: standby %s\n", isEnabled ? "on" : "off");
+  standbyEnabled = isEnabled;
+  if (isEnabled && (currentStationIndex >= 0))
+  {
+    requestStandby(currentStationIndex);
+  }
+}
+
+bool Player::isStandbyEnabled()
+{
+  PlayerLock lock(playerMutex);
+
+  return standbyEnabled;
+}
+
+void Player::requestStandby(int32_t index)
+{
+  standbyCenterIndex = index;
+  if (standbyEnabled && (standbyTaskHandle != NULL))
+  {
+    xTaskNotifyGive(standbyTaskHandle);
+  }
+}
+
+void Player::runStandbyTask()
+{
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    // still zapping: wait until the station stays selected - its own stream needs the bandwidth now
+    while (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(standbyDelay)) > 0)
+    {
+    }
+
+    int32_t candidates[standbyMaxStations];
+    uint32_t numberOfCandidates = 0;
+    {
+      PlayerLock lock(playerMutex);
+      int32_t numberOfStations = stations.getNumberOfStations();
+      if (!standbyEnabled || (standbyCenterIndex < 0) || (numberOfStations < 2))
+      {
+        continue;
+      }
+      int32_t list[] = {(standbyCenterIndex + 1) % numberOfStations,
+                        lastKeyStationIndex,
+                        (standbyCenterIndex + numberOfStations - 1) % numberOfStations
+                       };
+      for (int32_t index : list)
+      {
+        bool isDuplicate = (index < 0) || (index >= numberOfStations) || (index == standbyCenterIndex);
+        for (uint32_t count = 0; count < numberOfCandidates; count++)
+        {
+          isDuplicate = isDuplicate || (candidates[count] == index);
+        }
+        if (!isDuplicate && (numberOfCandidates < standbyMaxStations))
+        {
+          candidates[numberOfCandidates++] = index;
+        }
+      }
+    }
+
+    for (uint32_t count = 0; count < numberOfCandidates; count++)
+    {
+      prepareStandby(candidates[count]);
+      // host of the URL the connect will use: lwIP keeps the answer until the switch
+      char url[stationUrlLength];
+      {
+        PlayerLock lock(playerMutex);
+        RadioStation& station = stations[candidates[count]];
+        const char* resolvedUrl = station.getResolvedUrl();
+        strncpy(url, resolvedUrl ? resolvedUrl : station.getUrl(), sizeof(url) - 1);
+        url[sizeof(url) - 1] = 0;
+      }
+      dnsPrefetch.prefetch(url);
+    }
+  }
+}
+
+bool Player::prepareStandby(int32_t index)
+{
+  // network work is done without lock: the audio feed task must not wait for it
+  char url[stationUrlLength];
+  char resolved[stationUrlLength];
+  const char* stationUrl;
+  {
+    PlayerLock lock(playerMutex);
+    RadioStation& station = stations[index];
+    StreamStatistics& statistics = station.getStatistics();
+    if ((statistics.standbyTime != 0) && (millis() - statistics.standbyTime < standbyValidTime))
+    {
+      // still warm
+      return true;
+    }
+    stationUrl = station.getUrl();
+    if (station.getResolvedUrl() != NULL)
+    {
+      // the connect uses the cached URL anyway - a probe would only load the server
+      standbyNotProbedCount++;
+      return false;
+    }
+    strncpy(url, stationUrl, sizeof(url) - 1);
+    url[sizeof(url) - 1] = 0;
+  }
+
+  if (ESP.getFreeHeap() < standbyMinFreeHeap)
+  {
+    standbySkipCount++;
+    return false;
+  }
+
+  unsigned long startTime = millis();
+  ResolveResult result = resolveStreamUrl(url, resolved, sizeof(resolved));
+
+  PlayerLock lock(playerMutex);
+  RadioStation& station = stations[index];
+  if (result == ResolveResult::FAILED)
+  {
+    standbyFailCount++;
+    DEB_PF("PLAYER: standby '%s' failed\n", station.getName());
+    return false;
+  }
+  // only the scheme added to the station URL: nothing to cache
+  bool isSchemeAdded = (strncmp(resolved, "http://", 7) == 0) && (strcmp(resolved + 7, stationUrl) == 0);
+  if ((strcmp(resolved, stationUrl) != 0) && !isSchemeAdded && (station.getResolvedUrl() == NULL))
+  {
+    // redirect or playlist followed (also up to an https URL)
+    station.setResolvedUrl(resolved, time(NULL));
+    urlCacheChanged = true;
+  }
+  if (result == ResolveResult::NOT_PROBED)
+  {
+    // https: not checked, so the station does not count as prepared
+    standbyNotProbedCount++;
+    DEB_PF("PLAYER: standby '%s' not probed (https)\n", station.getName());
+    return false;
+  }
+  StreamStatistics& statistics = station.getStatistics();
+  statistics.standbyTime = millis();
+  statistics.standbyCount++;
+  standbyPrepareCount++;
+  DEB_PF("PLAYER: standby '%s' ready after %lu ms\n", station.getName(), millis() - startTime);
+  return true;
+}
+
+Player::ResolveResult Player::resolveStreamUrl(const char* url, char* resolved, size_t size)
+{
+  // follow redirects and playlists (m3u, pls) until the server answers with audio data
+  // resolved: last URL reached, also for NOT_PROBED
+  const char* headerKeys[] = {"Location", "Content-Type"};
+
+  if (strstr(url, "://") == NULL)
+  {
+    // no scheme: http, like the library connects it
+    snprintf(resolved, size, "http://%s", url);
+  }
+  else
+  {
+    strncpy(resolved, url, size - 1);
+    resolved[size - 1] = 0;
+  }
+  for (uint32_t step = 0; step <= standbyMaxRedirects; step++)
+  {
+    if (strncmp(resolved, "http://", 7) != 0)
+    {
+      // https: the certificate is checked by the library when connecting - not probed here
+      return (strncmp(resolved, "https://", 8) == 0) ? ResolveResult::NOT_PROBED : ResolveResult::FAILED;
+    }
+
+    HTTPClient http;
+    http.setConnectTimeout(standbyHttpTimeout);
+    http.setTimeout(standbyHttpTimeout);
+    http.useHTTP10(true);     // server closes after a playlist: no chunks, no keep-alive
+    if (!http.begin(resolved))
+    {
+      return ResolveResult::FAILED;
+    }
+    http.collectHeaders(headerKeys, 2);
+    int httpCode = http.GET();
+    if ((httpCode == 301) || (httpCode == 302) || (httpCode == 303) || (httpCode == 307) || (httpCode == 308))
+    {
+      String location = http.header("Location");
+      http.end();
+      if ((location.length() == 0) || (location.length() >= size))
+      {
+        return ResolveResult::FAILED;
+      }
+      strcpy(resolved, location.c_str());
+      continue;
+    }
+    if (httpCode != HTTP_CODE_OK)
+    {
+      http.end();
+      return ResolveResult::FAILED;
+    }
+
+    String contentType = http.header("Content-Type");
+    bool isPlaylist = (contentType.indexOf("mpegurl") >= 0) || (contentType.indexOf("scpls") >= 0) ||
+                      (strstr(resolved, ".m3u") != NULL) || (strstr(resolved, ".pls") != NULL);
+    if (!isPlaylist)
+    {
+      // audio data: that's the stream - closed right after the header, before any audio is read
+      // (the library opens its own connection to it)
+      http.end();
+      return ResolveResult::RESOLVED;
+    }
+    if (http.getSize() > standbyPlaylistLength)
+    {
+      http.end();
+      return ResolveResult::FAILED;
+    }
+    String playlist = http.getString();
+    http.end();
+
+    // first entry: "http://..." (m3u) or "File1=http://..." (pls)
+    bool isFound = false;
+    int lineStart = 0;
+    while (!isFound && (lineStart < (int)playlist.length()))
+    {
+      int lineEnd = playlist.indexOf('\n', lineStart);
+      if (lineEnd < 0)
+      {
+        lineEnd = playlist.length();
+      }
+      String line = playlist.substring(lineStart, lineEnd);
+      line.trim();
+      int urlStart = line.indexOf("http");
+      if ((urlStart == 0) || (line.startsWith("File") && (urlStart > 0) && (line.charAt(urlStart - 1) == '=')))
+      {
+        if (line.length() - urlStart >= size)
+        {
+          return ResolveResult::FAILED;
+        }
+        strcpy(resolved, line.c_str() + urlStart);
+        isFound = true;
+      }
+      lineStart = lineEnd + 1;
+    }
+    if (!isFound)
+    {
+      return ResolveResult::FAILED;
+    }
+  }
+  return ResolveResult::FAILED;
+}
+
+// ==================================================================================
+void standbyTask(void* parameters)
+{
+  TRACE();
+  Player* player = (Player*)parameters;
+
+  DEB_P("standbyTask() running on core ");
+  DEB_PL(xPortGetCoreID());
+
+  player->runStandbyTask();
+
+  // emergency case:
+  vTaskDelete(NULL);
+}
@@ -9,35 +9,59 @@
 #include "vs1053_ext.h"
 #include "storage.h"
 #include "station.h"
+#include "monitor.h"
+#include "profiler.h"
+#include "ttscache.h"
+#include "clipspeech.h"
+#include "dnsprefetch.h"
 
 class Player
 {
   public:
     Player();
 
-    void begin(RadioStations& stationList, RadioStationKeys& keyList);
+    void begin(RadioStations& stationList, RadioStationKeys& keyList, TtsCache& speechCache, ClipSpeech& clips);
+    bool beginFeedTask();
+    bool beginStandbyTask();
+    void setStandby(bool isEnabled);
+    bool isStandbyEnabled();
     bool isPlaying();
     bool play(int32_t stationToPlay = -1);
     bool playKey(int32_t stationKey);
     bool playStation(int32_t stationIndex);
     bool playFile(const char* fileName = "gong.mp3");
     bool playSpeech(const char* text);
-    void setSpeechPending(const bool isPending);
-    bool getSpeechPending();
-    bool resumeAfterFileOrSpeech();
+    // announcements are played back to back, then the station is connected again
+    bool queueFile(const char* fileName);
+    bool queueSpeech(const char* text);
+    bool queueStation(int32_t stationIndex);
+    bool startAnnouncements();
+    void prepareAnnouncement();   // called by loop()
+    void nextAnnouncement();      // called at end of file or speech
     bool playNextPrevious(bool next);
+    int32_t scrollStation(int32_t steps);
+    bool updateScroll();
     void run();
     bool stop();
     bool setCurrentStationIndex(int32_t index, int32_t maxIndex = 0);
     int32_t getCurrentStationIndex();
     bool hasStationChanged();
     void setTitleText(const char* newTitleText);
+    void setBitRate(uint32_t kBitPerSecond);
+    void setResolvedUrl(const char* url);
+    bool hasUrlCacheChanged();
+    uint32_t copyUrlCache(UrlCacheEntry* entries, uint32_t maxEntries);
+    bool hasTitleChanged();
     char* getTitleText();
 
     int32_t getCurrentVolume();
     void setVolume(int32_t volume);
     void changeVolume(bool increment);
 
+    void runFeedTask();   // called by audio feed task only
+    void runStandbyTask();   // called by standby task only
+    void debugPrint();
+
   private:
     enum class PlayerState { NOT_INIT, INIT, PLAYING, PLAYING_FILE, PLAYING_SPEECH, SWITCH, STOP };
 
@@ -46,11 +70,94 @@ class Player
     int32_t nextStationIndex;
     RadioStations stations;
     RadioStationKeys keys;
+    TtsCache* ttsCache = NULL;
+    ClipSpeech* clipSpeech = NULL;
     uint8_t currentVolume = 0;
     PlayerState state = PlayerState::NOT_INIT;
     PlayerState nextState = PlayerState::STOP;
     PlayerState lastState = PlayerState::NOT_INIT;
     PlayerState lastStateBeforeFileOrSpeech = PlayerState::NOT_INIT;
+    uint8_t volumeBeforeFileOrSpeech = defaultVolume;
     char currentTitleText[titleTextLength+1];
-    bool isSpeechPending = false;
+    char titleTextCopy[titleTextLength+1];
+    bool titleHasChanged = false;
+
+    // audio feed task
+    SemaphoreHandle_t playerMutex = NULL;     // recursive: vs1053 callbacks run inside run() and call Player again
+    SemaphoreHandle_t audioMutex = NULL;      // vs1053 library; taken before playerMutex (see player.cpp)
+    TaskHandle_t feedTaskHandle = NULL;
+    TaskLoad feedTaskLoad;
+    ProfileHistogram feedIntervals;           // microseconds between two calls of mp3.loop()
+    uint32_t underrunCount = 0;
+    bool inputBufferFilled = false;
+    void checkUnderrun();
+
+    // stream statistics
+    bool isWaitingForData = false;            // connected, nothing received yet
+    unsigned long connectTime = 0;
+    uint32_t bitRate = 0;                     // kBit/s as reported by the stream
+    unsigned long rateWindowStartTime = 0;
+    uint32_t rateWindowStartFill = 0;
+    // gap measurement only: the station is reconnected after every announcement
+    unsigned long reconnectGapStartTime = 0;  // end of announcement, 0: no reconnect pending
+    uint32_t lastReconnectGap = 0;
+    uint32_t maxReconnectGap = 0;
+    uint32_t reconnectGapSum = 0;
+    uint32_t reconnectGapCount = 0;
+    int32_t connectingStationIndex = -1;      // station the resolved URL (vs1053_lasthost) belongs to
+    bool urlCacheChanged = false;
+    void runState(int32_t& switchIndex);
+    void switchStation(int32_t index);
+    bool connectStation(int32_t index);
+    void beginStreamSession();
+    void updateStreamSession();
+    void endStreamSession();
+
+    // warm standby of neighbouring stations
+    bool standbyEnabled = standbyDefault;
+    TaskHandle_t standbyTaskHandle = NULL;
+    int32_t standbyCenterIndex = -1;          // station the neighbours belong to
+    int32_t lastKeyStationIndex = -1;
+    uint32_t standbyPrepareCount = 0;
+    uint32_t standbyFailCount = 0;
+    uint32_t standbySkipCount = 0;            // skipped due to memory budget
+    uint32_t standbyNotProbedCount = 0;       // https or already in the URL cache: not marked as standby
+    uint32_t standbySwitchCount = 0;
+    uint32_t standbySwitchTimeSum = 0;
+    uint32_t coldSwitchCount = 0;
+    uint32_t coldSwitchTimeSum = 0;
+    DnsPrefetch dnsPrefetch;                  // feed task: before a connect, standby task: neighbours
+    // announcement queue
+    enum class AnnouncementType { FILE, SPEECH, STATION };
+    struct Announcement
+    {
+      AnnouncementType type;
+      char text[alarmTextLength];             // file name or text to speak
+      int32_t stationIndex;
+      uint32_t sequence;
+      int8_t preparedFileIndex;               // composed from clips into clipSpeechFileFormat, -1: not prepared
+    };
+    Announcement announcements[announcementQueueLength];
+    uint32_t announcementHead = 0;
+    uint32_t announcementCount = 0;
+    uint32_t announcementSequence = 0;
+    uint32_t preparedSequence = 0;            // last item prepareAnnouncement() worked on
+    int8_t playingSpeechFile = -1;            // composed file currently playing
+    uint32_t playedAnnouncementCount = 0;
+    uint32_t preparedAnnouncementCount = 0;
+    uint32_t unpreparedSpeechCount = 0;
+    bool queueAnnouncement(AnnouncementType type, const char* text, int32_t stationIndex);
+    bool isAnnouncing();
+    bool beginAnnouncements();
+    bool resumeAfterFileOrSpeech();
+
+    int32_t scrollTargetIndex = -1;           // previewed station, connected when the encoder settles
+    unsigned long lastScrollTime = 0;
+    uint32_t scrollStepCount = 0;
+    uint32_t scrollConnectCount = 0;
+    int32_t getNeighbourIndex(int32_t index, int32_t steps);
+    void requestStandby(int32_t index);
+    bool prepareStandby(int32_t index);
+    enum class ResolveResult { RESOLVED, NOT_PROBED, FAILED };
+    ResolveResult resolveStreamUrl(const char* url, char* resolved, size_t size);
 };
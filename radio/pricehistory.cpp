@@ -0,0 +1,371 @@
+#include "pricehistory.h"
+
+PriceHistory::PriceHistory() {}
+
+void PriceHistory::getSegmentName(uint32_t segment, char* fileName, size_t size)
+{
+  snprintf(fileName, size, "%s/%08u.bin", historyDirectory, segment);
+}
+
+bool PriceHistory::begin()
+{
+  TRACE();
+
+  if (!LITTLEFS.exists(historyDirectory) && !LITTLEFS.mkdir(historyDirectory))
+  {
+    DEB_PL("HISTORY: cannot create directory");
+    return false;
+  }
+  // find oldest and newest segment
+  File directory = LITTLEFS.open(historyDirectory);
+  File file = directory.openNextFile();
+  while (file)
+  {
+    const char* name = strrchr(file.name(), '/');
+    name = name ? name + 1 : file.name();
+    char* end;
+    uint32_t segment = strtoul(name, &end, 10);
+    if (strcmp(end, ".bin") == 0)
+    {
+      if ((segmentCount == 0) || (segment < firstSegment))
+        firstSegment = segment;
+      if ((segmentCount == 0) || (segment > lastSegment))
+        lastSegment = segment;
+      segmentCount++;
+    }
+    file.close();
+    file = directory.openNextFile();
+  }
+  directory.close();
+
+  if (segmentCount && !restoreState())
+  {
+    // damaged: continue in a new segment
+    segmentFill = historySegmentSize;
+  }
+  DEB_PF("HISTORY: %u segments (%u..%u), current %u bytes\n", segmentCount, firstSegment, lastSegment, segmentFill);
+  return true;
+}
+
+bool PriceHistory::restoreState()
+{
+  // prices of the current segment are needed for the next deltas: decode it once
+  char fileName[32];
+  SegmentHeader header;
+
+  memset(hasLastPrices, 0, sizeof(hasLastPrices));
+  getSegmentName(lastSegment, fileName, sizeof(fileName));
+  File file = LITTLEFS.open(fileName);
+  if (!file || (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) || (header.magic != magic))
+  {
+    return false;
+  }
+  segmentStartTime = header.startTime;
+  segmentFill = file.size();
+  file.close();
+
+  PriceHistoryReader reader(*this);
+  PriceSample sample;
+  reader.begin(segmentStartTime, INT32_MAX);
+  while (reader.next(sample))
+  {
+    if (sample.station < historyMaxStations)
+    {
+      lastPrices[sample.station][0] = sample.diesel;
+      lastPrices[sample.station][1] = sample.e5;
+      lastPrices[sample.station][2] = sample.e10;
+      hasLastPrices[sample.station] = true;
+    }
+  }
+  return true;
+}
+
+bool PriceHistory::startSegment(time_t time)
+{
+  char fileName[32];
+  SegmentHeader header = {magic, (uint32_t)time, sizeof(PriceRecord), 0, 0};
+
+  uint32_t segment = segmentCount ? lastSegment + 1 : 0;
+  getSegmentName(segment, fileName, sizeof(fileName));
+  File file = LITTLEFS.open(fileName, "w");
+  if (!file)
+  {
+    DEB_PF("HISTORY: cannot create %s\n", fileName);
+    return false;
+  }
+  file.write((uint8_t*)&header, sizeof(header));
+  file.close();
+
+  lastSegment = segment;
+  if (segmentCount == 0)
+    firstSegment = segment;
+  segmentCount++;
+  segmentStartTime = time;
+  segmentFill = sizeof(header);
+  memset(hasLastPrices, 0, sizeof(hasLastPrices));
+
+  // rotate: size budget of all segments
+  while (segmentCount > historyMaxSegments)
+  {
+    getSegmentName(firstSegment, fileName, sizeof(fileName));
+    LITTLEFS.remove(fileName);
+    firstSegment++;
+    segmentCount--;
+  }
+  DEB_PF("HISTORY: segment %u started\n", segment);
+  return true;
+}
+
+bool PriceHistory::add(FuelStations& stations, time_t time)
+{
+  TRACE();
+  // worst case: every station needs an absolute record (two slots)
+  uint32_t numberOfStations = min(stations.getNumberOfStations(), historyMaxStations);
+  PriceRecord batch[historyMaxStations * 2];
+  uint32_t slots = 0;
+
+  if (time < urlCacheValidTime)
+  {
+    // clock not set
+    return false;
+  }
+  uint32_t batchSize = numberOfStations * 2 * sizeof(PriceRecord);
+  if ((segmentCount == 0) || (segmentFill + batchSize > historySegmentSize) || ((time - segmentStartTime) / 60 > UINT16_MAX))
+  {
+    if (!startSegment(time))
+    {
+      return false;
+    }
+  }
+
+  uint16_t minutes = (time - segmentStartTime) / 60;
+  for (uint32_t index = 0; index < numberOfStations; index++)
+  {
+    FuelStation& station = stations[index];
+    PriceRecord& record = batch[slots++];
+    record.minutes = minutes;
+    record.station = index;
+    record.flags = station.isOpen() ? flagOpen : 0;
+    record.reserved = 0;
+
+    int16_t prices[3];
+    if (station.isOpen())
+    {
+      prices[0] = stations.getPriceTenthCent(index, FuelType::DIESEL);
+      prices[1] = stations.getPriceTenthCent(index, FuelType::SUPER);
+      prices[2] = stations.getPriceTenthCent(index, FuelType::SUPER_E10);
+    }
+    else
+    {
+      // closed: no prices - keep the last ones (delta 0)
+      memcpy(prices, lastPrices[index], sizeof(prices));
+      if (!hasLastPrices[index])
+        memset(prices, 0, sizeof(prices));
+    }
+
+    bool isAbsolute = !hasLastPrices[index];
+    for (uint32_t fuel = 0; fuel < 3; fuel++)
+    {
+      int32_t delta = prices[fuel] - lastPrices[index][fuel];
+      isAbsolute = isAbsolute || (delta < INT8_MIN) || (delta > INT8_MAX);
+      record.delta[fuel] = isAbsolute ? 0 : delta;
+    }
+    if (isAbsolute)
+    {
+      record.flags |= flagAbsolute;
+      memset(record.delta, 0, sizeof(record.delta));
+      AbsoluteRecord* absolute = (AbsoluteRecord*)&batch[slots++];
+      memcpy(absolute->price, prices, sizeof(prices));
+      absolute->reserved = 0;
+    }
+    memcpy(lastPrices[index], prices, sizeof(prices));
+    hasLastPrices[index] = true;
+  }
+
+  // one flash write per update cycle
+  unsigned long startTime = millis();
+  char fileName[32];
+  getSegmentName(lastSegment, fileName, sizeof(fileName));
+  File file = LITTLEFS.open(fileName, "a");
+  if (!file)
+  {
+    return false;
+  }
+  size_t written = file.write((uint8_t*)batch, slots * sizeof(PriceRecord));
+  file.close();
+  segmentFill += written;
+  lastWriteTime = millis() - startTime;
+  lastBatchSize = written;
+  recordCount += numberOfStations;
+  writeCount++;
+  return written == slots * sizeof(PriceRecord);
+}
+
+uint32_t PriceHistory::getFirstSegment()
+{
+  return firstSegment;
+}
+
+uint32_t PriceHistory::getLastSegment()
+{
+  return segmentCount ? lastSegment : 0;
+}
+
+void PriceHistory::debugPrint()
+{
+  DEB_PL("Price history:");
+  DEB_PF("    segments           : %u (%u..%u), current %u of %u bytes\n", segmentCount, firstSegment, lastSegment, segmentFill, historySegmentSize);
+  DEB_PF("    written            : %u records in %u writes (last %u bytes in %lu ms)\n", recordCount, writeCount, lastBatchSize, lastWriteTime);
+}
+
+// ============================================================================================================================
+
+PriceHistoryReader::PriceHistoryReader(PriceHistory& priceHistory) : history(priceHistory) {}
+
+PriceHistoryReader::~PriceHistoryReader()
+{
+  end();
+}
+
+bool PriceHistoryReader::begin(time_t from, time_t to)
+{
+  end();
+  fromTime = from;
+  toTime = to;
+  if (history.segmentCount == 0)
+  {
+    return false;
+  }
+  // skip segments that end before the window: the next segment starts before it
+  segment = history.getFirstSegment();
+  while (segment < history.getLastSegment())
+  {
+    char fileName[32];
+    PriceHistory::SegmentHeader header;
+    PriceHistory::getSegmentName(segment + 1, fileName, sizeof(fileName));
+    File next = LITTLEFS.open(fileName);
+    bool isBefore = next && (next.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) && ((time_t)header.startTime <= from);
+    next.close();
+    if (!isBefore)
+    {
+      break;
+    }
+    segment++;
+  }
+  return openSegment();
+}
+
+void PriceHistoryReader::end()
+{
+  if (file)
+  {
+    file.close();
+  }
+}
+
+bool PriceHistoryReader::openSegment()
+{
+  char fileName[32];
+  PriceHistory::SegmentHeader header;
+
+  end();
+  while (segment <= history.getLastSegment())
+  {
+    PriceHistory::getSegmentName(segment, fileName, sizeof(fileName));
+    file = LITTLEFS.open(fileName);
+    if (file && (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) && (header.magic == PriceHistory::magic))
+    {
+      if ((time_t)header.startTime > toTime)
+      {
+        // behind the window
+        end();
+        return false;
+      }
+      segmentStartTime = header.startTime;
+      bufferLength = 0;
+      bufferPosition = 0;
+      memset(lastPrices, 0, sizeof(lastPrices));
+      return true;
+    }
+    end();
+    segment++;
+  }
+  return false;
+}
+
+bool PriceHistoryReader::readSlot(void* slot)
+{
+  if (bufferPosition >= bufferLength)
+  {
+    bufferLength = file.read(buffer, sizeof(buffer));
+    bufferPosition = 0;
+    if (bufferLength < sizeof(PriceHistory::PriceRecord))
+    {
+      return false;
+    }
+  }
+  memcpy(slot, buffer + bufferPosition, sizeof(PriceHistory::PriceRecord));
+  bufferPosition += sizeof(PriceHistory::PriceRecord);
+  return true;
+}
+
+bool PriceHistoryReader::nextRecord(PriceSample& sample)
+{
+  PriceHistory::PriceRecord record;
+
+  if (!readSlot(&record) || (record.station >= historyMaxStations))
+  {
+    return false;
+  }
+  int16_t* prices = lastPrices[record.station];
+  if (record.flags & PriceHistory::flagAbsolute)
+  {
+    PriceHistory::AbsoluteRecord absolute;
+    if (!readSlot(&absolute))
+    {
+      return false;
+    }
+    memcpy(prices, absolute.price, sizeof(absolute.price));
+  }
+  else
+  {
+    for (uint32_t fuel = 0; fuel < 3; fuel++)
+    {
+      prices[fuel] += record.delta[fuel];
+    }
+  }
+  sample.time = segmentStartTime + record.minutes * 60;
+  sample.station = record.station;
+  sample.isOpen = record.flags & PriceHistory::flagOpen;
+  sample.diesel = prices[0];
+  sample.e5 = prices[1];
+  sample.e10 = prices[2];
+  return true;
+}
+
+bool PriceHistoryReader::next(PriceSample& sample)
+{
+  while (file)
+  {
+    if (!nextRecord(sample))
+    {
+      // end of segment
+      segment++;
+      if (!openSegment())
+      {
+        return false;
+      }
+      continue;
+    }
+    if (sample.time > toTime)
+    {
+      end();
+      return false;
+    }
+    if (sample.time >= fromTime)
+    {
+      return true;
+    }
+  }
+  return false;
+}
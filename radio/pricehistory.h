@@ -0,0 +1,126 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+#include <LITTLEFS.h>
+
+#include "trace.h"
+#include "config.h"
+#include "fuel.h"
+
+/*
+   Price history: append-only log in LITTLEFS, split into segments of historySegmentSize bytes
+
+   segment  : header + records; the file name is the sequence number ("/history/00000012.bin")
+   record   : 8 bytes - minutes since the segment start, station index, open flag and the price
+              changes (tenth cent) of Diesel, E5 and E10 since the last record of this station
+              in the same segment. If a change does not fit into 8 bits (or it is the first record
+              of the station in the segment) the record is flagged absolute and followed by a
+              second 8 byte slot with the full prices.
+   closed   : stations are logged with unchanged prices and without open flag
+
+   All records of one update cycle are collected in RAM and written with a single append.
+*/
+
+// one price sample as returned by PriceHistoryReader
+struct PriceSample
+{
+  time_t time;
+  uint8_t station;
+  bool isOpen;
+  int16_t diesel;     // tenth cent
+  int16_t e5;
+  int16_t e10;
+};
+
+class PriceHistory
+{
+  public:
+    PriceHistory();
+
+    bool begin();
+    bool add(FuelStations& stations, time_t time);    // one update cycle
+
+    // used by PriceHistoryReader
+    uint32_t getFirstSegment();
+    uint32_t getLastSegment();
+    static void getSegmentName(uint32_t segment, char* fileName, size_t size);
+
+    void debugPrint();
+
+  private:
+    struct SegmentHeader
+    {
+      uint32_t magic;
+      uint32_t startTime;     // time_t of minute 0
+      uint16_t recordSize;
+      uint16_t reserved;
+      uint32_t reserved2;
+    };
+    struct PriceRecord
+    {
+      uint16_t minutes;
+      uint8_t station;
+      uint8_t flags;
+      int8_t delta[3];        // Diesel, E5, E10
+      uint8_t reserved;
+    };
+    struct AbsoluteRecord
+    {
+      int16_t price[3];
+      uint16_t reserved;
+    };
+    static constexpr uint32_t magic = 0x31485046;   // "FPH1"
+    static constexpr uint8_t flagOpen = 0x01;
+    static constexpr uint8_t flagAbsolute = 0x02;
+    friend class PriceHistoryReader;
+
+    uint32_t firstSegment = 0;
+    uint32_t lastSegment = 0;
+    uint32_t segmentCount = 0;
+    uint32_t segmentStartTime = 0;
+    uint32_t segmentFill = 0;                       // bytes
+    int16_t lastPrices[historyMaxStations][3];      // decoder state of the current segment
+    bool hasLastPrices[historyMaxStations];
+
+    uint32_t writeCount = 0;
+    uint32_t recordCount = 0;
+    uint32_t lastBatchSize = 0;
+    unsigned long lastWriteTime = 0;
+
+    bool startSegment(time_t time);
+    bool restoreState();
+};
+
+class PriceHistoryReader
+{
+    /*
+       Sequential scan of a time window - only historyReadBufferSize bytes in RAM
+
+          PriceHistoryReader reader(history);
+          reader.begin(from, to);
+          while (reader.next(sample)) { ... }
+    */
+  public:
+    PriceHistoryReader(PriceHistory& priceHistory);
+    ~PriceHistoryReader();
+
+    bool begin(time_t from, time_t to);
+    bool next(PriceSample& sample);
+    void end();
+
+  private:
+    PriceHistory& history;
+    time_t fromTime = 0;
+    time_t toTime = 0;
+    uint32_t segment = 0;
+    File file;
+    uint32_t segmentStartTime = 0;
+    uint8_t buffer[historyReadBufferSize];
+    size_t bufferLength = 0;
+    size_t bufferPosition = 0;
+    int16_t lastPrices[historyMaxStations][3];
+
+    bool openSegment();
+    bool readSlot(void* slot);
+    bool nextRecord(PriceSample& sample);
+};
@@ -0,0 +1,234 @@
+#include "pricestatistics.h"
+
+PriceStatistics::PriceStatistics() {}
+
+bool PriceStatistics::begin(uint32_t stations)
+{
+  TRACE();
+
+  // buckets for the stations of tanken.json, as many as fit into the budget
+  uint32_t maxStations = statisticsBudget / (numberOfFuelTypes * statisticsSlots * sizeof(Bucket));
+  numberOfStations = min(stations, maxStations);
+  if (numberOfStations == 0)
+  {
+    DEB_PL("PRICE STATISTICS: no fuel stations");
+    return false;
+  }
+  if (stations > maxStations)
+  {
+    DEB_PF("PRICE STATISTICS: only the first %u of %u stations are evaluated (statisticsBudget)\n", numberOfStations, stations);
+  }
+  size_t size = numberOfStations * numberOfFuelTypes * statisticsSlots * sizeof(Bucket);
+  buckets = new Bucket[numberOfStations * numberOfFuelTypes * statisticsSlots];
+  if (buckets == NULL)
+  {
+    DEB_PF("PRICE STATISTICS: %zu bytes not available\n", size);
+    numberOfStations = 0;
+    return false;
+  }
+  memset(buckets, 0, size);
+  if (!load())
+  {
+    DEB_PL("PRICE STATISTICS: start empty");
+  }
+  return true;
+}
+
+int32_t PriceStatistics::getSlot(int weekday, int hour)
+{
+  // -1 outside of the scan window
+  if ((hour < fuelScanStartHour) || (hour >= fuelScanEndHour))
+  {
+    return -1;
+  }
+  return weekday * statisticsHoursPerDay + hour - fuelScanStartHour;
+}
+
+PriceStatistics::Bucket& PriceStatistics::getBucket(uint32_t station, uint32_t fuel, uint32_t slot)
+{
+  return buckets[(station * numberOfFuelTypes + fuel) * statisticsSlots + slot];
+}
+
+void PriceStatistics::add(FuelStations& fuelStations, time_t time)
+{
+  struct tm timeInfo;
+
+  if ((buckets == NULL) || (time < urlCacheValidTime))
+  {
+    return;
+  }
+  localtime_r(&time, &timeInfo);
+  int32_t slot = getSlot(timeInfo.tm_wday, timeInfo.tm_hour);
+  if (slot < 0)
+  {
+    // end of the scan window: save the last hour
+    if (lastSlot >= 0)
+    {
+      save();
+      lastSlot = -1;
+    }
+    return;
+  }
+  uint32_t stations = min(numberOfStations, fuelStations.getNumberOfStations());
+  for (uint32_t station = 0; station < stations; station++)
+  {
+    if (!fuelStations.isStationOpen(station))
+    {
+      continue;
+    }
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      int16_t price = fuelStations.getPriceTenthCent(station, static_cast<FuelType>(fuel));
+      if (price <= 0)
+      {
+        continue;
+      }
+      Bucket& bucket = getBucket(station, fuel, slot);
+      if ((bucket.count == 0) || (price < bucket.minimum))
+      {
+        bucket.minimum = price;
+      }
+      if (bucket.count < statisticsMaxCount)
+      {
+        bucket.count++;
+      }
+      // running mean, rounded
+      int32_t difference = price - bucket.mean;
+      bucket.mean += (difference + (difference >= 0 ? bucket.count / 2 : -(int32_t)bucket.count / 2)) / (int32_t)bucket.count;
+      sampleCount++;
+    }
+  }
+
+  // flash is written once per hour
+  if ((lastSlot >= 0) && (slot != lastSlot))
+  {
+    save();
+  }
+  lastSlot = slot;
+}
+
+bool PriceStatistics::getCheapestHour(uint32_t station, FuelType fuelType, time_t time, uint8_t& hour, int16_t& price)
+{
+  // lowest mean from the current hour to the end of the scan time today
+  uint32_t fuel = static_cast<uint32_t>(fuelType);
+  struct tm timeInfo;
+  bool isFound = false;
+
+  if ((buckets == NULL) || (station >= numberOfStations) || (time < urlCacheValidTime))
+  {
+    return false;
+  }
+  localtime_r(&time, &timeInfo);
+  for (int32_t hourOfDay = max(timeInfo.tm_hour, (int)fuelScanStartHour); hourOfDay < fuelScanEndHour; hourOfDay++)
+  {
+    Bucket& bucket = getBucket(station, fuel, getSlot(timeInfo.tm_wday, hourOfDay));
+    if ((bucket.count >= statisticsMinCount) && (!isFound || (bucket.mean < price)))
+    {
+      hour = hourOfDay;
+      price = bucket.mean;
+      isFound = true;
+    }
+  }
+  return isFound;
+}
+
+char* PriceStatistics::getCheapestText(uint32_t station, time_t time)
+{
+  // "Super 19h 1.689  Diesel 20h 1.559"
+  uint8_t hourSuper;
+  uint8_t hourDiesel;
+  int16_t priceSuper;
+  int16_t priceDiesel;
+  bool isSuper = getCheapestHour(station, FuelType::SUPER, time, hourSuper, priceSuper);
+  bool isDiesel = getCheapestHour(station, FuelType::DIESEL, time, hourDiesel, priceDiesel);
+
+  cheapestText[0] = 0;
+  if ((buckets != NULL) && (station >= numberOfStations))
+  {
+    // beyond the budget: no statistics for this station
+    snprintf(cheapestText, cheapestTextLength, "keine Prognose");
+    return cheapestText;
+  }
+  if (isSuper)
+  {
+    snprintf(cheapestText, cheapestTextLength, "Super %uh %d.%03d", hourSuper, priceSuper / 1000, priceSuper % 1000);
+  }
+  if (isDiesel)
+  {
+    size_t length = strlen(cheapestText);
+    snprintf(cheapestText + length, cheapestTextLength - length, "%sDiesel %uh %d.%03d", length ? "  " : "",
+             hourDiesel, priceDiesel / 1000, priceDiesel % 1000);
+  }
+  return cheapestText;
+}
+
+bool PriceStatistics::load()
+{
+  FileHeader header;
+
+  File file = LITTLEFS.open(priceStatisticsFile);
+  if (!file || file.isDirectory())
+  {
+    return false;
+  }
+  size_t size = numberOfStations * numberOfFuelTypes * statisticsSlots * sizeof(Bucket);
+  bool isValid = (file.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) && (header.magic == magic) &&
+                 (header.stations == numberOfStations) && (header.slots == statisticsSlots) &&
+                 (file.read((uint8_t*)buckets, size) == size);
+  file.close();
+  if (!isValid)
+  {
+    // other station list: the statistics don't fit
+    memset(buckets, 0, size);
+    return false;
+  }
+  DEB_PF("PRICE STATISTICS: %u stations loaded\n", numberOfStations);
+  return true;
+}
+
+bool PriceStatistics::save()
+{
+  TRACE();
+  FileHeader header = {magic, (uint16_t)numberOfStations, (uint16_t)statisticsSlots};
+
+  if (buckets == NULL)
+  {
+    return false;
+  }
+  unsigned long startTime = millis();
+  File file = LITTLEFS.open(priceStatisticsFile, "w");
+  if (!file)
+  {
+    DEB_PL("PRICE STATISTICS: open for write failed");
+    return false;
+  }
+  size_t size = numberOfStations * numberOfFuelTypes * statisticsSlots * sizeof(Bucket);
+  file.write((uint8_t*)&header, sizeof(header));
+  size_t written = file.write((uint8_t*)buckets, size);
+  file.close();
+  lastSaveTime = millis() - startTime;
+  return written == size;
+}
+
+void PriceStatistics::debugPrint(uint32_t station)
+{
+  DEB_PL("Price statistics:");
+  DEB_PF("    stations           : %u (%u bytes)\n", numberOfStations, numberOfStations * numberOfFuelTypes * statisticsSlots * sizeof(Bucket));
+  DEB_PF("    samples            : %u (last save %lu ms)\n", sampleCount, lastSaveTime);
+  if ((buckets == NULL) || (station >= numberOfStations))
+  {
+    return;
+  }
+  DEB_PF("    station %u Super (mean / min / count per hour, today):\n", station);
+  time_t now = time(NULL);
+  struct tm timeInfo;
+  localtime_r(&now, &timeInfo);
+  for (uint32_t hour = fuelScanStartHour; hour < fuelScanEndHour; hour++)
+  {
+    Bucket& bucket = getBucket(station, 1, getSlot(timeInfo.tm_wday, hour));
+    if (bucket.count)
+    {
+      DEB_PF("       %2uh  %4d  %4d  %u\n", hour, bucket.mean, bucket.minimum, bucket.count);
+    }
+  }
+}
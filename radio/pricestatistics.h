@@ -0,0 +1,59 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+#include <LITTLEFS.h>
+#include <time.h>
+
+#include "trace.h"
+#include "config.h"
+#include "fuel.h"
+
+
+class PriceStatistics
+{
+    /*
+       Prices per station, fuel type and hour of the week - only the hours of the fuel scan window
+       (7 * 16 slots, Sunday fuelScanStartHour is slot 0)
+
+       every bucket : minimum, mean and number of samples (tenth cent)
+       add()        : O(1) per station and fuel type - the mean is a running mean; above
+                      statisticsMaxCount samples it becomes a moving average (prices drift)
+       persistence  : raw bucket array in priceStatisticsFile, written when the hour changes
+    */
+  public:
+    PriceStatistics();
+
+    bool begin(uint32_t stations);
+    void add(FuelStations& fuelStations, time_t time);
+    bool getCheapestHour(uint32_t station, FuelType fuelType, time_t time, uint8_t& hour, int16_t& price);
+    char* getCheapestText(uint32_t station, time_t time);
+    bool save();
+
+    void debugPrint(uint32_t station);
+
+  private:
+    struct Bucket
+    {
+      int16_t minimum;
+      int16_t mean;
+      uint16_t count;
+    };
+    struct FileHeader
+    {
+      uint32_t magic;
+      uint16_t stations;
+      uint16_t slots;
+    };
+    static constexpr uint32_t magic = 0x31545346;   // "FST1"
+
+    Bucket* buckets = NULL;
+    uint32_t numberOfStations = 0;
+    int32_t lastSlot = -1;
+    uint32_t sampleCount = 0;
+    unsigned long lastSaveTime = 0;
+    char cheapestText[cheapestTextLength];
+
+    static int32_t getSlot(int weekday, int hour);
+    Bucket& getBucket(uint32_t station, uint32_t fuel, uint32_t slot);
+    bool load();
+};
@@ -0,0 +1,148 @@
+#include "profiler.h"
+#include "display.h"
+
+ProfileHistogram::ProfileHistogram() {}
+
+void ProfileHistogram::record(uint32_t duration)
+{
+  count++;
+  sumDuration += duration;
+  if (duration < minDuration)
+    minDuration = duration;
+  if (duration > maxDuration)
+    maxDuration = duration;
+
+  // bucket = number of significant bits
+  uint32_t bucket = duration ? 32 - __builtin_clz(duration) : 0;
+  if (bucket >= profilerHistogramBuckets)
+    bucket = profilerHistogramBuckets - 1;
+  buckets[bucket]++;
+}
+
+void ProfileHistogram::reset()
+{
+  count = 0;
+  minDuration = UINT32_MAX;
+  maxDuration = 0;
+  sumDuration = 0;
+  memset(buckets, 0, sizeof(buckets));
+}
+
+uint32_t ProfileHistogram::getCount()
+{
+  return count;
+}
+
+uint32_t ProfileHistogram::getMin()
+{
+  return count ? minDuration : 0;
+}
+
+uint32_t ProfileHistogram::getAverage()
+{
+  return count ? (uint32_t)(sumDuration / count) : 0;
+}
+
+uint32_t ProfileHistogram::getMax()
+{
+  return maxDuration;
+}
+
+uint32_t ProfileHistogram::getPercentile(uint32_t percent)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  uint64_t threshold = ((uint64_t)count * percent + 99) / 100;
+  uint64_t sum = 0;
+  for (uint32_t bucket = 0; bucket < profilerHistogramBuckets; bucket++)
+  {
+    sum += buckets[bucket];
+    if (sum >= threshold)
+    {
+      // all durations in this bucket are below 2^bucket; never report more than the maximum seen
+      uint32_t upperBound = 1UL << bucket;
+      return (upperBound < maxDuration) ? upperBound : maxDuration;
+    }
+  }
+  return maxDuration;
+}
+
+// ============================================================================================================================
+
+Profiler::Profiler() {}
+
+void Profiler::begin()
+{
+  cyclesPerMicrosecond = ESP.getCpuFreqMHz();
+  DEB_PF("PROFILER: %u cycles per microsecond\n", cyclesPerMicrosecond);
+}
+
+void Profiler::record(const ProfileSection section, uint32_t cycles)
+{
+  histograms[(uint32_t)section].record(cycles / cyclesPerMicrosecond);
+}
+
+void Profiler::reset()
+{
+  for (uint32_t section = 0; section < numberOfProfileSections; section++)
+  {
+    histograms[section].reset();
+  }
+}
+
+const char* Profiler::getSectionName(const ProfileSection section)
+{
+  switch (section)
+  {
+    case ProfileSection::NETWORK:
+      return "network";
+    case ProfileSection::OTA:
+      return "ota";
+    case ProfileSection::PLAYER:
+      return "player";
+    case ProfileSection::ENCODER:
+      return "encoder";
+    case ProfileSection::BUTTONS:
+      return "buttons";
+    case ProfileSection::CLOCK:
+      return "clock";
+    case ProfileSection::FUEL:
+      return "fuel";
+    case ProfileSection::TEST_INPUT:
+      return "input";
+    case ProfileSection::FLUSH:
+      return "flush";
+    case ProfileSection::NUMBER_OF_SECTIONS:
+      break;
+  }
+  return "?";
+}
+
+void Profiler::debugPrint()
+{
+  DEB_PL("Profiler (loop sections, microseconds):");
+  DEB_PL("    section        count      min      avg      p99      max");
+  for (uint32_t section = 0; section < numberOfProfileSections; section++)
+  {
+    ProfileHistogram& histogram = histograms[section];
+    DEB_PF("    %-8s  %10u %8u %8u %8u %8u\n", getSectionName((ProfileSection)section), histogram.getCount(),
+           histogram.getMin(), histogram.getAverage(), histogram.getPercentile(99), histogram.getMax());
+  }
+}
+
+void Profiler::debugDisplay(Display& screen)
+{
+  // one line per section on the DEBUG page: "<name> <avg>/<p99>/<max>" in microseconds
+  char line[40];
+
+  screen.debug("loop us: avg/p99/max");
+  for (uint32_t section = 0; section < numberOfProfileSections; section++)
+  {
+    ProfileHistogram& histogram = histograms[section];
+    snprintf(line, sizeof(line), "%-7s %u/%u/%u", getSectionName((ProfileSection)section),
+             histogram.getAverage(), histogram.getPercentile(99), histogram.getMax());
+    screen.debug(line);
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+
+#include "trace.h"
+#include "config.h"
+
+class Display;
+
+// sections of loop() measured by the profiler
+enum class ProfileSection { NETWORK, OTA, PLAYER, ENCODER, BUTTONS, CLOCK, FUEL, TEST_INPUT, FLUSH, NUMBER_OF_SECTIONS };
+constexpr uint32_t numberOfProfileSections = (uint32_t)ProfileSection::NUMBER_OF_SECTIONS;
+
+class ProfileHistogram
+{
+    /*
+       Duration statistics of one section
+       bucket n counts durations of less than 2^n microseconds (bucket 0: < 1us)
+    */
+  public:
+    ProfileHistogram();
+
+    void record(uint32_t duration);   // in microseconds
+    void reset();
+    uint32_t getCount();
+    uint32_t getMin();
+    uint32_t getAverage();
+    uint32_t getMax();
+    uint32_t getPercentile(uint32_t percent);   // upper bound of the bucket
+
+  private:
+    uint32_t count = 0;
+    uint32_t minDuration = UINT32_MAX;
+    uint32_t maxDuration = 0;
+    uint64_t sumDuration = 0;
+    uint32_t buckets[profilerHistogramBuckets] = {};
+};
+
+// ============================================================================================================================
+class Profiler
+{
+    /*
+       loop() latency per section, measured with the CPU cycle counter
+       (only valid for sections shorter than 2^32 cycles: ~17s at 240MHz)
+    */
+  public:
+    Profiler();
+
+    void begin();
+    void record(const ProfileSection section, uint32_t cycles);
+    void reset();
+    const char* getSectionName(const ProfileSection section);
+
+    void debugPrint();
+    void debugDisplay(Display& screen);
+
+  private:
+    uint32_t cyclesPerMicrosecond = 240;
+    ProfileHistogram histograms[numberOfProfileSections];
+};
+
+// ============================================================================================================================
+class ProfileScope
+{
+    /*
+       Measures the time from construction (or the last call of next()) to the next call of next()
+       or the destruction and records it for the current section:
+
+         ProfileScope profile(profiler, ProfileSection::NETWORK);
+         ...                                  // counts for NETWORK
+         profile.next(ProfileSection::OTA);
+         ...                                  // counts for OTA until end of scope
+    */
+  public:
+    ProfileScope(Profiler& profiler, const ProfileSection section)
+      : profiler(profiler), section(section), startCycles(ESP.getCycleCount()) {}
+    ~ProfileScope()
+    {
+      profiler.record(section, ESP.getCycleCount() - startCycles);
+    }
+    void next(const ProfileSection nextSection)
+    {
+      uint32_t currentCycles = ESP.getCycleCount();
+      profiler.record(section, currentCycles - startCycles);
+      section = nextSection;
+      startCycles = currentCycles;
+    }
+
+  private:
+    Profiler& profiler;
+    ProfileSection section;
+    uint32_t startCycles;
+};
@@ -13,6 +13,12 @@ const char* radioVersion = "0.99.0";
 #include "display.h"
 #include "clock.h"
 #include "encoder.h"
+#include "monitor.h"
+#include "profiler.h"
+#include "ttscache.h"
+#include "clipspeech.h"
+#include "pricehistory.h"
+#include "pricestatistics.h"
 
 
 Storage storage;
@@ -24,13 +30,19 @@ Display screen;
 Clock theClock;
 Encoder encoder;
 FuelStations fuels;
+Monitor monitor;
+Profiler profiler;
+TtsCache ttsCache;
+ClipSpeech clipSpeech;
+PriceHistory priceHistory;
+PriceStatistics priceStatistics;
 
 bool isConnected = false;
 bool isOn = true;
 int32_t offBrightness;
 Pages lastPageBeforeFuelAlarm = startPage;
 bool fuelAlarm = false;
-bool lastFuelAlarm = false;
+bool lastFuelAlarm = false;              // alarm has been announced and shown
 bool wakeUpByFuelAlarm = false;
 
 
@@ -42,6 +54,7 @@ void setup()
   TRACE();
 
   screen.begin();
+  profiler.begin();
   screen.debug("ESP32 radio ");
   screen.debug(radioVersion, true);
   DEB_P("setup() running on core ");
@@ -79,8 +92,13 @@ void setup()
   // get data and connect to network
   screen.debug("get data");
   storage.getStationList(stations, keys);
+  storage.getUrlCache(stations);
+  storage.getTtsCache(ttsCache);
+  ttsCache.begin();
+  clipSpeech.begin();
+  priceHistory.begin();
   screen.debug("  stations: ");
-  screen.debug(stations.getNumberOfStations(), true);
+  screen.debug((int32_t)stations.getNumberOfStations(), true);
   int32_t currentStationIndex = storage.getCurrentStationIndex(stations);
   player.setCurrentStationIndex(currentStationIndex, stations.getNumberOfStations());   // save station (needed if not starting with Player screen)
   screen.debug("  current : ");
@@ -89,12 +107,17 @@ void setup()
   screen.debug("  display brightness : ");
   screen.debug(currentBrightness, true);
   storage.getStationList(fuels);
+  fuels.beginUpdateTask();
   storage.getCurrentFuelPriceLimit(FuelType::DIESEL, fuels);
   storage.getCurrentFuelPriceLimit(FuelType::SUPER, fuels);
   screen.setFuelLimits(fuels.getLimit(FuelType::DIESEL), fuels.getLimit(FuelType::SUPER));
 
   screen.debug("  fuel stations: ");
-  screen.debug(fuels.getNumberOfStations(), true);
+  screen.debug((int32_t)fuels.getNumberOfStations(), true);
+  if (!priceStatistics.begin(fuels.getNumberOfStations()))
+  {
+    screen.debug("  no price statistics");
+  }
 
   storage.getNetworkList(networks);
   networks.createAvailableNetworkList();
@@ -132,7 +155,9 @@ void setup()
   encoder.begin(screen);
   // VS 1053 modules
   screen.debug(", player", true);
-  player.begin(stations, keys);
+  player.begin(stations, keys, ttsCache, clipSpeech);
+  player.beginFeedTask();
+  player.beginStandbyTask();
 
   screen.debug("Initialisation complete");
   delay(2000);
@@ -195,15 +220,34 @@ void loop()
     executedOnce = true;
   }
 
+  monitor.loopBegin();
+  // all display commands of one loop() pass are sent with a single write
+  screen.beginBatch();
 
+  ProfileScope profile(profiler, ProfileSection::NETWORK);
   isConnected = networks.checkNetwork();
 
   if (isConnected)
   {
+    profile.next(ProfileSection::OTA);
     ArduinoOTA.handle();
-    player.run();
-
     // handle player updates
+    // (the stream itself is fed by the audio feed task)
+    profile.next(ProfileSection::PLAYER);
+    if (player.hasTitleChanged())
+    {
+      screen.setTitle(player.getTitleText());
+    }
+    if (player.hasUrlCacheChanged())
+    {
+      writeUrlCache();
+    }
+    if (ttsCache.hasIndexChanged())
+    {
+      storage.putTtsCache(ttsCache);
+    }
+    player.updateScroll();
+    player.prepareAnnouncement();
     if (screen.getCurrentPage() == Pages::PLAYER)
     {
       if (player.hasStationChanged())
@@ -229,6 +273,7 @@ void loop()
     }
 
     // handle encoder and buttons from display
+    profile.next(ProfileSection::ENCODER);
     switch (encoder.eventStatus())
     {
       case EncoderEvent::CLICK:
@@ -300,18 +345,30 @@ void loop()
         //        }
         break;
       case EncoderEvent::TURN_LEFT:
-        DEB_PF("EncoderEvent::TURN_LEFT by %d ticks\n", encoder.getTicks());
-        screen.setButtonEvent(ButtonEvent::PREVIOUS);
-        break;
       case EncoderEvent::TURN_RIGHT:
-        DEB_PF("EncoderEvent::TURN_RIGHT by %d ticks\n", encoder.getTicks());
-        screen.setButtonEvent(ButtonEvent::NEXT);
+        if (screen.getCurrentPage() == Pages::PLAYER)
+        {
+          // scroll: show the target station at once, connect when the encoder settles
+          int32_t targetStation = player.scrollStation(encoder.getTicks());
+          if (targetStation >= 0)
+          {
+            screen.setStation(stations[targetStation].getName());
+            updateStationKeys(targetStation);
+          }
+        }
+        else
+        {
+          int16_t ticks = encoder.getTicks();
+          DEB_PF("EncoderEvent::TURN by %d ticks\n", ticks);
+          screen.setButtonEvent(ticks < 0 ? ButtonEvent::PREVIOUS : ButtonEvent::NEXT);
+        }
         break;
       case EncoderEvent::NONE:
         break;
     }
 
     // handle buttons from display
+    profile.next(ProfileSection::BUTTONS);
     switch (screen.buttonEventStatus())
     {
       case ButtonEvent::KEY:
@@ -426,6 +483,11 @@ void loop()
           limitDiesel = screen.getReceivedValue();
           screen.requestValue(ValueType::LIMIT_SUPER);
           limitSuper = screen.getReceivedValue();
+          if ((limitDiesel < 0) || (limitSuper < 0))
+          {
+            // display did not answer - keep the current limits
+            break;
+          }
 
           fuels.setLimit(FuelType::DIESEL, limitDiesel);
           fuels.setLimit(FuelType::SUPER, limitSuper);
@@ -434,6 +496,8 @@ void loop()
           screen.setFuelLimits(limitDiesel, limitSuper);
 
           fuels.checkLimits();
+          // the HMI has returned to the FUEL page by itself: all components show their defaults
+          screen.clearShadow();
           initFuelPage(true);
         }
         break;
@@ -443,44 +507,72 @@ void loop()
     }
 
     // handle clock
-    if (theClock.secondEventStatus())
+    profile.next(ProfileSection::CLOCK);
+    // drain all queued events - seconds missed during a long loop() pass are caught up
+    static bool fuelEventPending = false;
+    ClockEvent clockEvent;
+    while ((clockEvent = theClock.eventStatus()) != ClockEvent::NONE)
     {
-      screen.incrementClockSecond();
-    }
-
-    if (theClock.ntpEventStatus())
-    {
-      theClock.forceUpdate();
-      if (screen.getCurrentPage() == Pages::CLOCK)
+      switch (clockEvent)
       {
-        screen.setClockTime(theClock.getHour(), theClock.getMinute(), theClock.getSecond(), theClock.getDate(), theClock.getWeekday());
+        case ClockEvent::SECOND:
+          screen.incrementClockSecond();
+          break;
+        case ClockEvent::NTP:
+          theClock.forceUpdate();
+          if (screen.getCurrentPage() == Pages::CLOCK)
+          {
+            screen.setClockTime(theClock.getHour(), theClock.getMinute(), theClock.getSecond(), theClock.getDate(), theClock.getWeekday());
+          }
+          break;
+        case ClockEvent::FUEL:
+          fuelEventPending = true;
+          break;
+        case ClockEvent::NONE:
+          break;
       }
     }
 
+    profile.next(ProfileSection::FUEL);
     if (isOn || enableFuelPriceScanWhileOff)
     {
-      if (theClock.fuelEventStatus())
+      bool fuelPricesUpdated = false;
+      if (fuelEventPending)
       {
+        fuelEventPending = false;
         uint8_t currentHour = theClock.getHour();
         DEB_PF("[%2.2d:%2.2d:%2.2d] ", currentHour, theClock.getMinute(), theClock.getSecond());
         if ( (currentHour >= fuelScanStartHour) && (currentHour < fuelScanEndHour))
         {
-          // get data from Tankerkoenig
-          fuels.updatePrices();
+          // get data from Tankerkoenig - done by the fuel task, result is picked up by updateStatus()
+          fuels.requestUpdate();
         }
         else
         {
           // virtually close all stations if outside of scan time
           fuels.updatePrices(true);
+          fuelPricesUpdated = true;
+          priceStatistics.add(fuels, time(NULL));   // saves the last hour of the scan window
         }
+      }
+      if (fuels.updateStatus())
+      {
+        DEB_PF("FUEL : prices received after %lu ms (loop gap max %lu us)\n", fuels.getLastFetchDuration(), monitor.getMaxLoopGap());
+        fuelPricesUpdated = true;
+        priceHistory.add(fuels, time(NULL));
+        priceStatistics.add(fuels, time(NULL));
+      }
 
-        // checkLimits might change the current station
+      if (fuelPricesUpdated)
+      {
+        // checkLimits might change the current station (first new alarm)
         fuelAlarm = fuels.checkLimits();
-        if (fuelAlarm != lastFuelAlarm)
+        uint32_t newAlarms = fuels.getNumberOfNewAlarms();
+        if (newAlarms)
         {
-          if (fuelAlarm)
+          if (!lastFuelAlarm)
           {
-            // alarm occured
+            // first alarm occured
             // change page and show
             lastPageBeforeFuelAlarm = screen.getCurrentPage();
             screen.selectPage(Pages::FUEL);
@@ -491,111 +583,171 @@ void loop()
               isOn = true;
               wakeUpByFuelAlarm = true;
             }
-            // announce by gong and speech
-            player.playFile();
-            if (enableSpeechOutput)
-            {
-              player.setSpeechPending(true);
-            }
           }
-          else
+          // announce by gong and speech - only the alarms of this cycle, also while other alarms are active
+          player.queueFile(gongFile);
+          if (enableSpeechOutput)
           {
-            // alarm has gone
-            switch (lastPageBeforeFuelAlarm)
-            {
-              case Pages::DEBUG:
-                screen.selectPage(Pages::DEBUG);
-                break;
-              case Pages::PLAYER:
-                screen.selectPage(Pages::PLAYER);
-                initPlayerPage();
-                break;
-              case Pages::FUEL:
-                screen.selectPage(Pages::FUEL);
-                initFuelPage(true);
-                break;
-              case Pages::CLOCK:
-                if (wakeUpByFuelAlarm)  // has been switched on by alarm function
-                {
-                  // do nothing - switch to clock scree will be done by switching off again
-                }
-                else
-                {
-                  screen.selectPage(Pages::CLOCK);
-                  initClockPage();
-                }
-                break;
-              case Pages::DOWNLOAD:
-                break;
-            }
-            if (wakeUpByFuelAlarm)  // has been switched on by alarm function
+            for (uint32_t count = 0; count < newAlarms; count++)
             {
-              // switch off again
-              wakeUpByFuelAlarm = false;
-              encoder.setEncoderEvent(EncoderEvent::CLICK);
+              FuelAlarmChange change = fuels.getNewAlarm(count);
+              player.queueSpeech(fuels[change.station].createAlarmText(change.fuelType));
             }
           }
-          lastFuelAlarm = fuelAlarm;
+          player.startAnnouncements();
+          lastFuelAlarm = true;
         }
-        // need to re-write station name in case of alarm also if FUEL page is active - it might have changed
-        initFuelPage(fuelAlarm || (!(screen.getCurrentPage() == Pages::FUEL)));
+        if (!fuelAlarm && lastFuelAlarm)
+        {
+          // alarm has gone
+          switch (lastPageBeforeFuelAlarm)
+          {
+            case Pages::DEBUG:
+              screen.selectPage(Pages::DEBUG);
+              break;
+            case Pages::PLAYER:
+              screen.selectPage(Pages::PLAYER);
+              initPlayerPage();
+              break;
+            case Pages::FUEL:
+              screen.selectPage(Pages::FUEL);
+              initFuelPage(true);
+              break;
+            case Pages::CLOCK:
+              if (wakeUpByFuelAlarm)  // has been switched on by alarm function
+              {
+                // do nothing - switch to clock scree will be done by switching off again
+              }
+              else
+              {
+                screen.selectPage(Pages::CLOCK);
+                initClockPage();
+              }
+              break;
+            case Pages::DOWNLOAD:
+              break;
+          }
+          if (wakeUpByFuelAlarm)  // has been switched on by alarm function
+          {
+            // switch off again
+            wakeUpByFuelAlarm = false;
+            encoder.setEncoderEvent(EncoderEvent::CLICK);
+          }
+          lastFuelAlarm = false;
+        }
+        // need to re-write station name in case of a new alarm also if FUEL page is active - it might have changed
+        initFuelPage(newAlarms || (!(screen.getCurrentPage() == Pages::FUEL)));
       }
     }
 
 
     // TEST - simulate input devices
+    profile.next(ProfileSection::TEST_INPUT);
     if (Serial.available())
     {
-      byte value = Serial.read();
-      switch (value)
-      {
-        case '1':
-        case '2':
-        case '3':
-        case '4':
-        case '5':
-          player.playKey(value - '0');
-          break;
-        case '<':
-          player.playNextPrevious(false);
-          break;
-        case '>':
-          player.playNextPrevious(true);
-          break;
-        case '+':
-          player.changeVolume(true);
-          break;
-        case '-':
-          player.changeVolume(false);
-          break;
-        case 'd':
-          storage.putCurrentBrightness(screen.adjustBrightness(false));
-          break;
-        case 'b':
-          storage.putCurrentBrightness(screen.adjustBrightness(true));
-          break;
-        case 'o':
-          encoder.setEncoderEvent(EncoderEvent::CLICK);
-          break;
-        case 'f':
-          theClock.setFuelEvent();
-          break;
-        case 'g':
-          player.playFile(gongFile);
-          break;
-        case 's':
-          player.playSpeech("Diesel in Holle jetzt 1 Euro 48 9");
-          break;
-        case 'u':
-          if (nextionUpdate())
-            ESP.restart();
-          break;
-        default:
-          // ignore
-          break;
-      }
+      simulateInput(Serial.read());
+    }
+    int scriptCommand = monitor.nextScriptCommand();
+    if (scriptCommand >= 0)
+    {
+      simulateInput(scriptCommand);
     }
   }
+
+  profile.next(ProfileSection::FLUSH);
+  screen.endBatch();
+  monitor.loopEnd();
+}
+
+// TEST - simulated input devices: serial input and event script use the same commands
+void simulateInput(int value)
+{
+  switch (value)
+  {
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+      player.playKey(value - '0');
+      break;
+    case '<':
+      player.playNextPrevious(false);
+      break;
+    case '>':
+      player.playNextPrevious(true);
+      break;
+    case '+':
+      player.changeVolume(true);
+      break;
+    case '-':
+      player.changeVolume(false);
+      break;
+    case 'd':
+      storage.putCurrentBrightness(screen.adjustBrightness(false));
+      break;
+    case 'b':
+      storage.putCurrentBrightness(screen.adjustBrightness(true));
+      break;
+    case 'o':
+      encoder.setEncoderEvent(EncoderEvent::CLICK);
+      break;
+    case 'l':
+      encoder.setEncoderEvent(EncoderEvent::TURN_LEFT);
+      break;
+    case 'r':
+      encoder.setEncoderEvent(EncoderEvent::TURN_RIGHT);
+      break;
+    case 'f':
+      theClock.simulateFuelEvent();
+      break;
+    case 'w':
+      player.setStandby(!player.isStandbyEnabled());
+      break;
+    case 'g':
+      player.playFile(gongFile);
+      break;
+    case 's':
+      player.playSpeech("Diesel in Holle jetzt 1 Euro 48 9");
+      break;
+    case 'm':
+      monitor.debugPrint();
+      screen.debugPrint();
+      theClock.debugPrint();
+      encoder.debugPrint();
+      player.debugPrint();
+      ttsCache.debugPrint();
+      clipSpeech.debugPrint();
+      priceHistory.debugPrint();
+      priceStatistics.debugPrint(fuels.getCurrentStationIndex());
+      break;
+    case 'M':
+      monitor.reset();
+      break;
+    case 'p':
+      profiler.debugPrint();
+      profiler.debugDisplay(screen);
+      break;
+    case 'P':
+      profiler.reset();
+      break;
+    case 'h':
+      printPriceHistory(3600);
+      break;
+    case 'x':
+      if (monitor.isScriptRunning())
+        monitor.stopScript();
+      else
+        monitor.startScript();
+      break;
+    case 'u':
+      if (nextionUpdate())
+        ESP.restart();
+      break;
+    default:
+      // ignore
+      break;
+  }
 }
 
 // Streamtitle is special: may change during playing.
@@ -604,56 +756,20 @@ void vs1053_showstreamtitle(const char *info)       // called from vs1053
 {
   DEB_P("stream title:  ");
   DEB_PL(info);                           // Show title
-  player.setTitleText(info);
-  screen.setTitle(info);
+  player.setTitleText(info);     // display is updated by loop()
 }
 
-// Playing MP3 needs attention for end of title
+// end of an announcement: Player continues with the next one or resumes the radio
 void vs1053_eof_mp3(const char *info)               // called from vs1053
 {
   DEB_P("mp3 end of file: ");
   DEB_PL(info);                           // Show info
-  if (player.getSpeechPending())
-  {
-    bool super = fuels[fuels.getCurrentStationIndex()].getAlarm(FuelType::SUPER);
-    bool diesel = fuels[fuels.getCurrentStationIndex()].getAlarm(FuelType::DIESEL);
-    player.setSpeechPending(false);
-    if (super)
-    {
-      player.playSpeech(fuels.getAlarmText(FuelType::SUPER));
-      if (diesel)
-      {
-        // there will be a second speech
-        player.setSpeechPending(true);
-      }
-    }
-    else if (diesel)
-    {
-      player.playSpeech(fuels.getAlarmText(FuelType::DIESEL));
-    }
-  }
-  else
-  {
-    player.resumeAfterFileOrSpeech();
-  }
+  player.nextAnnouncement();
 }
 
 void vs1053_eof_speech(const char *info)            // called from vs1053
 {
   DEB_P("end of speech: ");
   DEB_PL(info);
-
-  if (player.getSpeechPending())
-  {
-    player.setSpeechPending(false);
-    // is DIESEL still below limit?
-    if (fuels[fuels.getCurrentStationIndex()].getAlarm(FuelType::DIESEL))
-    {
-      player.playSpeech(fuels.getAlarmText(FuelType::DIESEL));    // Super
-    }
-  }
-  else
-  {
-    player.resumeAfterFileOrSpeech();
-  }
+  player.nextAnnouncement();
 }
@@ -52,10 +52,60 @@ const char* RadioStation::getUrl()
 {
   return url;
 }
+StreamStatistics& RadioStation::getStatistics()
+{
+  return statistics;
+}
+
+void RadioStation::setResolvedUrl(const char* resolved, time_t resolvedTime)
+{
+  strncpy(resolvedUrl, resolved, stationUrlLength - 1);
+  resolvedUrl[stationUrlLength - 1] = 0;
+  resolvedUrlTime = resolvedTime;
+}
+const char* RadioStation::getResolvedUrl()
+{
+  if (resolvedUrl[0] == 0)
+  {
+    return NULL;
+  }
+  time_t now = time(NULL);
+  if ((now >= urlCacheValidTime) && (resolvedUrlTime >= urlCacheValidTime) && (now - resolvedUrlTime > urlCacheTtl))
+  {
+    // expired: resolve again
+    return NULL;
+  }
+  return resolvedUrl;
+}
+time_t RadioStation::getResolvedTime()
+{
+  return resolvedUrlTime;
+}
+void RadioStation::clearResolvedUrl()
+{
+  resolvedUrl[0] = 0;
+  resolvedUrlTime = 0;
+}
 
 void RadioStation::debugPrint()
 {
   DEB_PF("%s | %s | %d | %s\n", uiName, uiKeyName, uiKey, url);
+  if (statistics.connectCount)
+  {
+    DEB_PF("              connects %u | underruns %u | first audio %u ms (avg %u ms) | %u bytes/s\n",
+           statistics.connectCount, statistics.underrunCount, statistics.lastTimeToFirstAudio, statistics.averageTimeToFirstAudio,
+           statistics.bytesPerSecond);
+    DEB_PF("              switches %u (%u from cache) | last switch %u ms (DNS %u ms)\n", statistics.switchCount, statistics.cacheHitCount,
+           statistics.lastSwitchTime, statistics.lastDnsTime);
+  }
+  if (statistics.standbyCount)
+  {
+    DEB_PF("              standby prepared %u times\n", statistics.standbyCount);
+  }
+  if (resolvedUrl[0])
+  {
+    DEB_PF("              resolved: %s\n", resolvedUrl);
+  }
 }
 
 // ============================================================================================================================
@@ -6,6 +6,30 @@
 #include "config.h"
 
 
+// learned while playing a station (shown by 'm')
+struct StreamStatistics
+{
+  uint32_t connectCount = 0;
+  uint32_t underrunCount = 0;
+  uint32_t lastTimeToFirstAudio = 0;                  // ms from connect to the first stream data
+  uint32_t averageTimeToFirstAudio = 0;               // ms, moving average
+  uint32_t bytesPerSecond = 0;                        // received data rate (estimate), moving average
+  uint32_t switchCount = 0;
+  uint32_t cacheHitCount = 0;
+  uint32_t lastSwitchTime = 0;                        // ms for connecttohost()
+  uint32_t lastDnsTime = 0;                           // ms for the host lookup before connecttohost()
+  unsigned long standbyTime = 0;                      // millis() of the last standby preparation, 0: never
+  uint32_t standbyCount = 0;
+};
+
+// resolved URL of a station, copied under the player lock for /urlcache.json
+struct UrlCacheEntry
+{
+  uint32_t stationIndex;
+  char resolvedUrl[stationUrlLength];
+  time_t resolvedTime;
+};
+
 class RadioStation
 {
     /*
@@ -47,6 +71,15 @@ class RadioStation
     const char* getKeyName();
     uint32_t    getKey();
     const char* getUrl();
+    StreamStatistics& getStatistics();
+
+    /*
+       resolved stream URL (target of playlist or redirect) - cached to skip resolving
+    */
+    void setResolvedUrl(const char* resolved, time_t resolvedTime);
+    const char* getResolvedUrl();     // NULL: not known or expired
+    time_t getResolvedTime();
+    void clearResolvedUrl();
 
     /*
        print this object to debug
@@ -58,6 +91,9 @@ class RadioStation
     const char* uiKeyName;    // short name for station keys (depends on UI)
     uint32_t    uiKey;        // station key number
     const char* url;          // stream URL
+    StreamStatistics statistics;
+    char resolvedUrl[stationUrlLength] = "";
+    time_t resolvedUrlTime = 0;
 
 };
 
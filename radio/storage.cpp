@@ -104,6 +104,135 @@ bool Storage::getStationList(RadioStations& stationList, RadioStationKeys& keyLi
   return true;
 }
 
+bool Storage::getUrlCache(RadioStations& stationList)
+{
+  // resolved stream URLs of playlist/redirect stations: {"UrlCache":[{"url":..., "resolved":..., "time":...}, ...]}
+  TRACE();
+
+  File cache = LITTLEFS.open(urlCacheFile);
+  if (!cache || cache.isDirectory())
+  {
+    DEB_PL("URL cache file not found");
+    return false;
+  }
+  DynamicJsonDocument doc(jsonUrlCacheDocSize);
+  DeserializationError error = deserializeJson(doc, cache);
+  cache.close();
+  if (error)
+  {
+    DEB_P("deserializeJson() failed: ");
+    DEB_PL(error.c_str());
+    return false;
+  }
+
+  uint32_t found = 0;
+  JsonArray cacheArray = doc["UrlCache"].as<JsonArray>();
+  for (JsonObject UrlCache_item : cacheArray)
+  {
+    const char* url = UrlCache_item["url"];
+    const char* resolved = UrlCache_item["resolved"];
+    if ((url == NULL) || (resolved == NULL))
+    {
+      continue;
+    }
+    for (uint32_t count = 0; count < stationList.getNumberOfStations(); count++)
+    {
+      if (strcmp(stationList[count].getUrl(), url) == 0)
+      {
+        stationList[count].setResolvedUrl(resolved, UrlCache_item["time"]);
+        found++;
+        break;
+      }
+    }
+  }
+  DEB_PF("URL cache: %u resolved URLs\n", found);
+  return true;
+}
+
+bool Storage::putUrlCache(RadioStations& stationList, const UrlCacheEntry* entries, uint32_t numberOfEntries)
+{
+  // entries: copy of the known resolved URLs (Player::copyUrlCache) - the tasks of Player change them
+  TRACE();
+
+  DynamicJsonDocument doc(jsonUrlCacheDocSize);
+  JsonArray cacheArray = doc.createNestedArray("UrlCache");
+  for (uint32_t count = 0; count < numberOfEntries; count++)
+  {
+    JsonObject entry = cacheArray.createNestedObject();
+    entry["url"] = stationList[entries[count].stationIndex].getUrl();
+    entry["resolved"] = entries[count].resolvedUrl;
+    entry["time"] = entries[count].resolvedTime;
+  }
+
+  File cache = LITTLEFS.open(urlCacheFile, "w");
+  if (!cache)
+  {
+    DEB_PL("URL cache file open for write failed");
+    return false;
+  }
+  size_t written = serializeJson(doc, cache);
+  cache.close();
+  DEB_PF("URL cache: %zu bytes written\n", written);
+  return true;
+}
+
+bool Storage::getTtsCache(TtsCache& cache)
+{
+  // index of cached speech files: {"TtsCache":[{"hash":..., "size":..., "used":...}, ...]}
+  TRACE();
+
+  File index = LITTLEFS.open(ttsCacheIndexFile);
+  if (!index || index.isDirectory())
+  {
+    DEB_PL("TTS cache index not found");
+    return false;
+  }
+  DynamicJsonDocument doc(jsonTtsCacheDocSize);
+  DeserializationError error = deserializeJson(doc, index);
+  index.close();
+  if (error)
+  {
+    DEB_P("deserializeJson() failed: ");
+    DEB_PL(error.c_str());
+    return false;
+  }
+
+  JsonArray cacheArray = doc["TtsCache"].as<JsonArray>();
+  for (JsonObject TtsCache_item : cacheArray)
+  {
+    cache.addEntry(TtsCache_item["hash"], TtsCache_item["size"], TtsCache_item["used"]);
+  }
+  return true;
+}
+
+bool Storage::putTtsCache(TtsCache& cache)
+{
+  TRACE();
+
+  DynamicJsonDocument doc(jsonTtsCacheDocSize);
+  JsonArray cacheArray = doc.createNestedArray("TtsCache");
+  uint32_t hash;
+  uint32_t size;
+  uint32_t lastUsed;
+  for (uint32_t count = 0; cache.getEntry(count, hash, size, lastUsed); count++)
+  {
+    JsonObject entry = cacheArray.createNestedObject();
+    entry["hash"] = hash;
+    entry["size"] = size;
+    entry["used"] = lastUsed;
+  }
+
+  File index = LITTLEFS.open(ttsCacheIndexFile, "w");
+  if (!index)
+  {
+    DEB_PL("TTS cache index open for write failed");
+    return false;
+  }
+  serializeJson(doc, index);
+  index.close();
+  return true;
+}
+
 int32_t Storage::getCurrentStationIndex(RadioStations& stationList)
 {
   TRACE();
@@ -490,6 +619,34 @@ void Storage::saveLastFuelPriceLimit(const FuelType fuelType, const int32_t valu
   }
 }
 
+const char* Storage::loadCertificate(const char* fileName)
+{
+  // root certificate (PEM) for a different Tankerkoenig server, e.g. a local stand-in for tests
+  if (fileName == NULL)
+  {
+    return NULL;
+  }
+  File certFile = LITTLEFS.open(fileName);
+  if (!certFile || certFile.isDirectory())
+  {
+    DEB_PF("certificate file %s not found\n", fileName);
+    return NULL;
+  }
+  size_t  siz = certFile.size();
+  // ATTENTION:
+  // do never delete this buffer.
+  // WiFiClientSecure uses it by just setting a pointer
+  char* buf = new char[siz + 1];
+  if (buf)
+  {
+    certFile.readBytes(buf, siz);
+    buf[siz] = 0;
+    DEB_PF("certificate file %s: %zu bytes read\n", fileName, siz);
+  }
+  certFile.close();
+  return buf;
+}
+
 bool Storage::getStationList(FuelStations& stationList)
 {
   TRACE();
@@ -509,7 +666,8 @@ bool Storage::getStationList(FuelStations& stationList)
       DEB_PF("  %zu bytes read\n", siz);
       DEB_PL("fuel stations list file closed");
 
-      StaticJsonDocument<jsonFuelStationListDocSize> doc;
+      // sized from the file: any number of stations and rules; the strings stay in buf
+      DynamicJsonDocument doc(siz * jsonFuelStationListDocFactor);
       DeserializationError error = deserializeJson(doc, buf, siz);
       if (error)
       {
@@ -517,8 +675,10 @@ bool Storage::getStationList(FuelStations& stationList)
         DEB_PL(error.c_str());
         return false;
       }
+      DEB_PF("  json document: %zu of %zu bytes used\n", doc.memoryUsage(), doc.capacity());
 
       stationList.setAPIKey(doc["APIkey"]);
+      stationList.setAPIServer(doc["APIurl"], loadCertificate(doc["APIcert"]));
       JsonArray stationListArray = doc["StationList"].as<JsonArray>();
       stationList.createStationList(stationListArray.size());
 
@@ -534,6 +694,20 @@ bool Storage::getStationList(FuelStations& stationList)
         stationList.setStation(count, current);
         count++;
       }
+      stationList.buildRequests();
+
+      // optional alarm rules - compiled into the rule table of the station list
+      JsonArray rulesArray = doc["Rules"].as<JsonArray>();
+      count = 0;
+      for (JsonObject rule : rulesArray)
+      {
+        if (!stationList.addRule(rule["station"], rule["fuel"], rule["days"], rule["hours"],
+                                 rule["below"] | 0.0, rule["belowAverage"] | 0.0, rule["cheapest"] | false))
+        {
+          DEB_PF("fuel rule %d not used\n", count);
+        }
+        count++;
+      }
     }
     else
     {
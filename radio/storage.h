@@ -11,6 +11,7 @@
 #include "station.h"
 #include "network.h"
 #include "fuel.h"
+#include "ttscache.h"
 
 
 class Storage
@@ -24,6 +25,10 @@ class Storage
     bool putCurrentStationIndex(int32_t index);
     int32_t getCurrentBrightness();
     bool putCurrentBrightness(int32_t value);
+    bool getUrlCache(RadioStations& stationList);
+    bool putUrlCache(RadioStations& stationList, const UrlCacheEntry* entries, uint32_t numberOfEntries);
+    bool getTtsCache(TtsCache& cache);
+    bool putTtsCache(TtsCache& cache);
 
     // network related
     bool getNetworkList(Networks& networkList);
@@ -47,6 +52,7 @@ class Storage
     int32_t lastSuperLimit;
     int32_t lastSuperE10Limit;
     void saveLastFuelPriceLimit(const FuelType fuelType, const int32_t value);
+    const char* loadCertificate(const char* fileName);
 
     
     File tftFile;
@@ -0,0 +1,388 @@
+#include "ttscache.h"
+
+#include <HTTPClient.h>
+#include <WiFiClientSecure.h>
+
+TtsCache::TtsCache() {}
+
+void ttsTask(void* parameters);
+
+bool TtsCache::begin()
+{
+  // call after Storage::getTtsCache(): files not in the index are removed
+  TRACE();
+
+  cacheMutex = xSemaphoreCreateMutex();
+  if (!LITTLEFS.exists(ttsCacheDirectory) && !LITTLEFS.mkdir(ttsCacheDirectory))
+  {
+    DEB_PL("TTS: cannot create cache directory");
+    return false;
+  }
+  removeOrphans();
+
+  BaseType_t retValue = xTaskCreatePinnedToCore(
+                          ttsTask,                 /* Task function. */
+                          "TtsTask",               /* String with name of task. */
+                          ttsTaskStackSize,        /* Stack size in bytes. */
+                          (void*)this,             /* Parameter passed as input of the task: This TtsCache object*/
+                          ttsTaskPriority,         /* Priority of the task. */
+                          &ttsTaskHandle,          /* Task handle. */
+                          ttsTaskCore);            /* Core */
+  if (retValue != pdPASS)
+  {
+    DEB_PL("TTS: creation of TTS task failed");
+    ttsTaskHandle = NULL;
+    return false;
+  }
+  DEB_PF("TTS: %u cached texts, %u bytes\n", numberOfEntries, totalSize);
+  return true;
+}
+
+uint32_t TtsCache::getHash(const char* text, const char* language)
+{
+  // FNV-1a over language and text
+  uint32_t hash = 2166136261UL;
+  for (const char* character = language; *character; character++)
+  {
+    hash = (hash ^ (uint8_t)*character) * 16777619UL;
+  }
+  hash = (hash ^ '|') * 16777619UL;
+  for (const char* character = text; *character; character++)
+  {
+    hash = (hash ^ (uint8_t)*character) * 16777619UL;
+  }
+  return hash;
+}
+
+void TtsCache::getFileName(uint32_t hash, char* fileName, size_t size)
+{
+  snprintf(fileName, size, "%s/%08x.mp3", ttsCacheDirectory, hash);
+}
+
+int32_t TtsCache::findEntry(uint32_t hash)
+{
+  for (uint32_t index = 0; index < numberOfEntries; index++)
+  {
+    if (entries[index].hash == hash)
+    {
+      return index;
+    }
+  }
+  return -1;
+}
+
+bool TtsCache::getFile(const char* text, const char* language, char* fileName, size_t size)
+{
+  // RAM only: called from the audio feed task (end of file callbacks)
+  uint32_t hash = getHash(text, language);
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  int32_t index = findEntry(hash);
+  if (index < 0)
+  {
+    missCount++;
+    xSemaphoreGive(cacheMutex);
+    return false;
+  }
+  hitCount++;
+  bytesSaved += entries[index].size;
+  entries[index].lastUsed = ++useCounter;
+  indexChanged = true;
+  xSemaphoreGive(cacheMutex);
+
+  getFileName(hash, fileName, size);
+  return true;
+}
+
+bool TtsCache::isCached(const char* text, const char* language)
+{
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  bool isFound = findEntry(getHash(text, language)) >= 0;
+  xSemaphoreGive(cacheMutex);
+  return isFound;
+}
+
+bool TtsCache::requestDownload(const char* text, const char* language)
+{
+  if ((ttsTaskHandle == NULL) || (text == NULL) || (text[0] == 0))
+  {
+    return false;
+  }
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  if (downloadCount >= ttsDownloadQueueLength)
+  {
+    xSemaphoreGive(cacheMutex);
+    DEB_PL("TTS: download queue full");
+    return false;
+  }
+  TtsDownload& request = downloads[(downloadHead + downloadCount) % ttsDownloadQueueLength];
+  strncpy(request.text, text, alarmTextLength - 1);
+  request.text[alarmTextLength - 1] = 0;
+  strncpy(request.language, language, ttsLanguageLength - 1);
+  request.language[ttsLanguageLength - 1] = 0;
+  downloadCount++;
+  xSemaphoreGive(cacheMutex);
+  xTaskNotifyGive(ttsTaskHandle);
+  return true;
+}
+
+bool TtsCache::hasIndexChanged()
+{
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  bool isChanged = indexChanged;
+  indexChanged = false;
+  xSemaphoreGive(cacheMutex);
+  return isChanged;
+}
+
+uint32_t TtsCache::getNumberOfEntries()
+{
+  return numberOfEntries;
+}
+
+bool TtsCache::getEntry(uint32_t index, uint32_t& hash, uint32_t& size, uint32_t& lastUsed)
+{
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  bool isValid = index < numberOfEntries;
+  if (isValid)
+  {
+    hash = entries[index].hash;
+    size = entries[index].size;
+    lastUsed = entries[index].lastUsed;
+  }
+  xSemaphoreGive(cacheMutex);
+  return isValid;
+}
+
+bool TtsCache::addEntry(uint32_t hash, uint32_t size, uint32_t lastUsed)
+{
+  // used while loading the index (before begin())
+  char fileName[ttsFileNameLength];
+
+  getFileName(hash, fileName, sizeof(fileName));
+  if ((numberOfEntries >= ttsCacheEntries) || (findEntry(hash) >= 0) || !LITTLEFS.exists(fileName))
+  {
+    return false;
+  }
+  entries[numberOfEntries].hash = hash;
+  entries[numberOfEntries].size = size;
+  entries[numberOfEntries].lastUsed = lastUsed;
+  numberOfEntries++;
+  totalSize += size;
+  if (lastUsed > useCounter)
+    useCounter = lastUsed;
+  return true;
+}
+
+void TtsCache::removeOrphans()
+{
+  // files of a lost index or of an interrupted download
+  File directory = LITTLEFS.open(ttsCacheDirectory);
+  if (!directory || !directory.isDirectory())
+  {
+    return;
+  }
+  char orphans[ttsCacheEntries][ttsFileNameLength];
+  uint32_t numberOfOrphans = 0;
+  File file = directory.openNextFile();
+  while (file && (numberOfOrphans < ttsCacheEntries))
+  {
+    const char* name = strrchr(file.name(), '/');
+    name = name ? name + 1 : file.name();
+    char* end;
+    uint32_t hash = strtoul(name, &end, 16);
+    if ((strcmp(end, ".mp3") == 0) && (findEntry(hash) < 0))
+    {
+      getFileName(hash, orphans[numberOfOrphans++], ttsFileNameLength);
+    }
+    file.close();
+    file = directory.openNextFile();
+  }
+  directory.close();
+  for (uint32_t count = 0; count < numberOfOrphans; count++)
+  {
+    DEB_PF("TTS: remove orphan %s\n", orphans[count]);
+    LITTLEFS.remove(orphans[count]);
+  }
+}
+
+bool TtsCache::makeRoom(uint32_t size)
+{
+  // remove least recently used files until the new one fits into budget and entry table
+  if (size > ttsCacheBudget)
+  {
+    return false;
+  }
+  while ((numberOfEntries > 0) && ((totalSize + size > ttsCacheBudget) || (numberOfEntries >= ttsCacheEntries)))
+  {
+    char fileName[ttsFileNameLength];
+    uint32_t oldest = 0;
+
+    xSemaphoreTake(cacheMutex, portMAX_DELAY);
+    for (uint32_t index = 1; index < numberOfEntries; index++)
+    {
+      if (entries[index].lastUsed < entries[oldest].lastUsed)
+        oldest = index;
+    }
+    getFileName(entries[oldest].hash, fileName, sizeof(fileName));
+    totalSize -= entries[oldest].size;
+    entries[oldest] = entries[--numberOfEntries];
+    evictionCount++;
+    indexChanged = true;
+    xSemaphoreGive(cacheMutex);
+
+    LITTLEFS.remove(fileName);
+  }
+  return true;
+}
+
+size_t TtsCache::encodeUrl(const char* text, char* encoded, size_t size)
+{
+  // percent encoding of all but unreserved characters (UTF-8 bytes are encoded one by one)
+  static const char hexDigits[] = "0123456789ABCDEF";
+  size_t length = 0;
+
+  for (const char* character = text; *character; character++)
+  {
+    uint8_t value = *character;
+    if (isalnum(value) || (value == '-') || (value == '_') || (value == '.') || (value == '~'))
+    {
+      if (length + 1 >= size)
+        return 0;
+      encoded[length++] = value;
+    }
+    else
+    {
+      if (length + 3 >= size)
+        return 0;
+      encoded[length++] = '%';
+      encoded[length++] = hexDigits[value >> 4];
+      encoded[length++] = hexDigits[value & 0x0F];
+    }
+  }
+  encoded[length] = 0;
+  return length;
+}
+
+bool TtsCache::download(const char* text, const char* language)
+{
+  uint32_t hash = getHash(text, language);
+  char fileName[ttsFileNameLength];
+  char encodedText[alarmTextLength * 3];
+  char url[ttsUrlLength];
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  bool isCached = findEntry(hash) >= 0;
+  xSemaphoreGive(cacheMutex);
+  if (isCached)
+  {
+    return true;
+  }
+  if (encodeUrl(text, encodedText, sizeof(encodedText)) == 0)
+  {
+    return false;
+  }
+  snprintf(url, sizeof(url), ttsUrl, language, encodedText);
+  getFileName(hash, fileName, sizeof(fileName));
+
+  unsigned long startTime = millis();
+  WiFiClientSecure client;      // no certificate: like the TTS connection of vs1053_ext
+  HTTPClient http;
+  http.setConnectTimeout(ttsHttpTimeout);
+  http.setTimeout(ttsHttpTimeout);
+  http.useHTTP10(true);
+  if (!http.begin(client, url))
+  {
+    return false;
+  }
+  int httpCode = http.GET();
+  int size = http.getSize();
+  if ((httpCode != HTTP_CODE_OK) || !makeRoom(size > 0 ? size : 0))
+  {
+    DEB_PF("TTS: download failed (%d, %d bytes)\n", httpCode, size);
+    http.end();
+    return false;
+  }
+  File file = LITTLEFS.open(fileName, "w");
+  if (!file)
+  {
+    http.end();
+    return false;
+  }
+  int written = http.writeToStream(&file);
+  file.close();
+  http.end();
+  if ((written <= 0) || ((size > 0) && (written != size)) || !makeRoom(written))
+  {
+    DEB_PF("TTS: download of %s incomplete (%d of %d bytes)\n", fileName, written, size);
+    LITTLEFS.remove(fileName);
+    return false;
+  }
+
+  xSemaphoreTake(cacheMutex, portMAX_DELAY);
+  entries[numberOfEntries].hash = hash;
+  entries[numberOfEntries].size = written;
+  entries[numberOfEntries].lastUsed = ++useCounter;
+  numberOfEntries++;
+  totalSize += written;
+  indexChanged = true;
+  xSemaphoreGive(cacheMutex);
+  lastDownloadTime = millis() - startTime;
+  DEB_PF("TTS: %s stored (%d bytes, %lu ms)\n", fileName, written, lastDownloadTime);
+  return true;
+}
+
+void TtsCache::runDownloadTask()
+{
+  TtsDownload request;
+
+  while (1)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (1)
+    {
+      xSemaphoreTake(cacheMutex, portMAX_DELAY);
+      bool isPending = downloadCount > 0;
+      if (isPending)
+      {
+        request = downloads[downloadHead];
+        downloadHead = (downloadHead + 1) % ttsDownloadQueueLength;
+        downloadCount--;
+      }
+      xSemaphoreGive(cacheMutex);
+      if (!isPending)
+      {
+        break;
+      }
+      if (download(request.text, request.language))
+        storedCount++;
+      else
+        failCount++;
+    }
+  }
+}
+
+void TtsCache::debugPrint()
+{
+  uint32_t requests = hitCount + missCount;
+  DEB_PL("TTS cache:");
+  DEB_PF("    entries            : %u (%u of %u bytes)\n", numberOfEntries, totalSize, ttsCacheBudget);
+  DEB_PF("    hits / misses      : %u / %u (hit rate %u%%)\n", hitCount, missCount, requests ? hitCount * 100 / requests : 0);
+  DEB_PF("    bytes saved        : %u\n", bytesSaved);
+  DEB_PF("    downloads          : %u stored, %u failed, %u evicted (last %lu ms)\n", storedCount, failCount, evictionCount, lastDownloadTime);
+}
+
+// ==================================================================================
+void ttsTask(void* parameters)
+{
+  TRACE();
+  TtsCache* cache = (TtsCache*)parameters;
+
+  DEB_P("ttsTask() running on core ");
+  DEB_PL(xPortGetCoreID());
+
+  cache->runDownloadTask();
+
+  // emergency case:
+  vTaskDelete(NULL);
+}
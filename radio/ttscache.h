@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include "FS.h"
+#include <LITTLEFS.h>
+
+#include "trace.h"
+#include "config.h"
+
+
+class TtsCache
+{
+    /*
+       MP3 of spoken texts (fuel alarms) in LITTLEFS: /tts/<hash>.mp3
+
+       getFile()           cached file for text and language - played locally by Player
+       requestDownload()   a text just spoken online is fetched once more by the TTS task and stored;
+                           the least recently used files are removed to stay inside ttsCacheBudget
+
+       The index (hash, size, last use) is kept in RAM and written by Storage (ttsCacheIndexFile).
+    */
+  public:
+    TtsCache();
+
+    bool begin();
+    bool getFile(const char* text, const char* language, char* fileName, size_t size);
+    bool isCached(const char* text, const char* language);   // no effect on statistics
+    bool requestDownload(const char* text, const char* language);
+    bool hasIndexChanged();
+
+    // index access for Storage
+    uint32_t getNumberOfEntries();
+    bool getEntry(uint32_t index, uint32_t& hash, uint32_t& size, uint32_t& lastUsed);
+    bool addEntry(uint32_t hash, uint32_t size, uint32_t lastUsed);
+
+    void runDownloadTask();   // called by TTS task only
+    void debugPrint();
+
+  private:
+    struct TtsEntry
+    {
+      uint32_t hash;
+      uint32_t size;
+      uint32_t lastUsed;      // value of useCounter: higher is more recent
+    };
+    TtsEntry entries[ttsCacheEntries];
+    uint32_t numberOfEntries = 0;
+    uint32_t totalSize = 0;
+    uint32_t useCounter = 0;
+    bool indexChanged = false;
+    SemaphoreHandle_t cacheMutex = NULL;
+
+    struct TtsDownload
+    {
+      char text[alarmTextLength];
+      char language[ttsLanguageLength];
+    };
+    TtsDownload downloads[ttsDownloadQueueLength];
+    uint32_t downloadHead = 0;
+    uint32_t downloadCount = 0;
+    TaskHandle_t ttsTaskHandle = NULL;
+
+    uint32_t hitCount = 0;
+    uint32_t missCount = 0;
+    uint32_t storedCount = 0;
+    uint32_t failCount = 0;
+    uint32_t evictionCount = 0;
+    uint32_t bytesSaved = 0;
+    unsigned long lastDownloadTime = 0;
+
+    static uint32_t getHash(const char* text, const char* language);
+    static void getFileName(uint32_t hash, char* fileName, size_t size);
+    static size_t encodeUrl(const char* text, char* encoded, size_t size);
+    int32_t findEntry(uint32_t hash);
+    bool makeRoom(uint32_t size);
+    bool download(const char* text, const char* language);
+    void removeOrphans();
+};
@@ -30,6 +30,8 @@ void setArduinoOTACallbacks()
       type = "filesystem";
       screen.setType("Daten");
     }
+    // upload blocks loop() - display commands must not wait for the end of the loop() batch
+    screen.flush();
     // stop filesystem - also in case of Sketch upload.
     LITTLEFS.end();
     DEB_PL("Start updating " + type);
@@ -42,6 +44,7 @@ void setArduinoOTACallbacks()
   {
     byte percent = progress / (total / 100);
     screen.setProgress((byte)(percent > 100 ? 100 : percent));
+    screen.flush();
 
     DEB_PF("Progress: %u%%\r", percent);
   })
@@ -73,6 +76,7 @@ void setArduinoOTACallbacks()
       screen.setType("End Failed");
       DEB_PL("End Failed");      // omitting braces causes compiler waring if DEBUGGING is not defined
     }
+    screen.flush();
   });
 }
 
@@ -118,13 +122,14 @@ void vs1053_eof_mp3(const char *info)               // called from vs1053
 }
 #endif
 
-#if defined(VS1053_VERBOSE)
 void vs1053_bitrate(const char *br)                 // called from vs1053
 {
+#if defined(VS1053_VERBOSE)
   DEB_P("BITRATE:      ");
   DEB_PL(String(br) + "kBit/s");          // bitrate of current stream
-}
 #endif
+  player.setBitRate(atoi(br));            // used for the data rate estimate
+}
 
 #if defined(VS1053_VERBOSE)
 void vs1053_commercial(const char *info)            // called from vs1053
@@ -150,13 +155,14 @@ void vs1053_eof_speech(const char *info)            // called from vs1053
 }
 #endif
 
-#if defined(VS1053_VERBOSE)
 void vs1053_lasthost(const char *info)              // really connected URL
 {
+#if defined(VS1053_VERBOSE)
   DEB_P("lastURL:      ");
   DEB_PL(info);
-}
 #endif
+  player.setResolvedUrl(info);            // cached for the next connect
+}
 
 
 bool nextionUpdate()
@@ -300,6 +306,21 @@ errorEnd:
 }
 
 
+void writeUrlCache()
+{
+  // resolved URLs are copied under the player lock, the file is written from the copy
+  uint32_t numberOfStations = stations.getNumberOfStations();
+  UrlCacheEntry* entries = new UrlCacheEntry[numberOfStations];
+  if (entries == NULL)
+  {
+    DEB_PL("URL cache: out of memory");
+    return;
+  }
+  uint32_t numberOfEntries = player.copyUrlCache(entries, numberOfStations);
+  storage.putUrlCache(stations, entries, numberOfEntries);
+  delete[] entries;
+}
+
 void populateStationKeys()
 {
   for (uint8_t count = 1; count < numberOfStationKeys; count++)
@@ -328,10 +349,12 @@ void initPlayerPage()
   if (screen.getCurrentPage() == Pages::PLAYER)
   {
     int32_t currentStationIndex = player.getCurrentStationIndex();
+    screen.beginBatch();
     populateStationKeys();
     screen.setStation(stations[currentStationIndex].getName());
     updateStationKeys(currentStationIndex);
     screen.setTitle(player.getTitleText());
+    screen.endBatch();
   }
 }
 
@@ -349,6 +372,7 @@ void initFuelPage(bool setName)
   if (screen.getCurrentPage() == Pages::FUEL)
   {
     FuelStation station = fuels[fuels.getCurrentStationIndex()];
+    screen.beginBatch();
     if (setName)
       screen.setFuelData(station.getUiName(), station.getPrice(FuelType::DIESEL), station.getPrice(FuelType::SUPER), station.isOpen());
     else
@@ -356,5 +380,26 @@ void initFuelPage(bool setName)
 
     screen.setFuelAlarmDiesel(station.getAlarm(FuelType::DIESEL));
     screen.setFuelAlarmSuper(station.getAlarm(FuelType::SUPER));
+    screen.setFuelCheapest(priceStatistics.getCheapestText(fuels.getCurrentStationIndex(), time(NULL)));
+    screen.endBatch();
+  }
+}
+
+void printPriceHistory(time_t seconds)
+{
+  // TEST: samples of the last seconds
+  PriceHistoryReader reader(priceHistory);
+  PriceSample sample;
+  time_t now = time(NULL);
+  uint32_t count = 0;
+
+  DEB_PF("price history of the last %ld s:\n", (long)seconds);
+  reader.begin(now - seconds, now);
+  while (reader.next(sample))
+  {
+    DEB_PF("    %10ld  [%2u] %s  Diesel %4d  E5 %4d  E10 %4d\n", (long)sample.time, sample.station, sample.isOpen ? "open  " : "closed",
+           sample.diesel, sample.e5, sample.e10);
+    count++;
   }
+  DEB_PF("    %u samples\n", count);
 }
@@ -0,0 +1,138 @@
+/*
+   Limit check of the former station objects (floats, bools, switch per fuel type) against
+   the int16 columns and belowLimitMask() of FuelStations
+
+     benchmark_limits [stations [rounds]]      default: 512 stations, 1000 rounds
+
+   Both layouts get the same prices; the alarm counts must be equal (exit code 1 otherwise).
+   The times are host times - they show the ratio, not the ESP32 numbers.
+*/
+#include <chrono>
+#include "fuel.h"
+
+struct ObjectStation
+{
+  bool isOpen;
+  float priceE5;
+  float priceE10;
+  float priceDiesel;
+  bool alarmE5;
+  bool alarmE10;
+  bool alarmDiesel;
+  char alarmText[alarmTextLength];
+
+  float getPrice(const FuelType fuelType)
+  {
+    if (isOpen)
+    {
+      switch (fuelType)
+      {
+        case FuelType::DIESEL:
+          return priceDiesel;
+        case FuelType::SUPER:
+          return priceE5;
+        case FuelType::SUPER_E10:
+          return priceE10;
+      }
+    }
+    return 0.0;
+  }
+  void activateAlarm(const FuelType fuelType, const bool activate)
+  {
+    if (isOpen)
+    {
+      switch (fuelType)
+      {
+        case FuelType::DIESEL:
+          alarmDiesel = activate;
+          break;
+        case FuelType::SUPER:
+          alarmE5 = activate;
+          break;
+        case FuelType::SUPER_E10:
+          alarmE10 = activate;
+          break;
+      }
+    }
+  }
+};
+
+static long elapsedMicroseconds(std::chrono::steady_clock::time_point startTime)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+int main(int argc, char* argv[])
+{
+  static const FuelType fuelTypes[numberOfFuelTypes] = {FuelType::DIESEL, FuelType::SUPER, FuelType::SUPER_E10};
+  const float floatLimits[numberOfFuelTypes] = {1.80, 1.90, 1.87};
+  const int32_t tenthCentLimits[numberOfFuelTypes] = {1800, 1900, 1870};
+  uint32_t stations = (argc > 1) ? strtoul(argv[1], NULL, 10) : 512;
+  uint32_t rounds = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000;
+  uint32_t words = (stations + 31) / 32;
+
+  ObjectStation* objects = new ObjectStation[stations]();
+  int16_t* columns = new int16_t[numberOfFuelTypes * words * 32]();
+  uint32_t* masks = new uint32_t[(numberOfFuelTypes + 1) * words]();
+  uint32_t* open = masks + numberOfFuelTypes * words;
+  // same prices in both layouts: 1.700 .. 1.999, every 7th station closed
+  for (uint32_t station = 0; station < stations; station++)
+  {
+    bool isOpen = (station % 7) != 0;
+    objects[station].isOpen = isOpen;
+    open[station / 32] |= isOpen ? (1UL << (station % 32)) : 0;
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      int16_t price = 1700 + (station * 37 + fuel * 101) % 300;
+      columns[fuel * words * 32 + station] = price;
+    }
+    objects[station].priceDiesel = columns[station] / 1000.0;
+    objects[station].priceE5 = columns[words * 32 + station] / 1000.0;
+    objects[station].priceE10 = columns[2 * words * 32 + station] / 1000.0;
+  }
+
+  uint32_t objectAlarms = 0;
+  auto startTime = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < rounds; round++)
+  {
+    objectAlarms = 0;
+    for (uint32_t station = 0; station < stations; station++)
+    {
+      for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+      {
+        bool isBelow = objects[station].isOpen && (objects[station].getPrice(fuelTypes[fuel]) < floatLimits[fuel]);
+        objects[station].activateAlarm(fuelTypes[fuel], isBelow);
+        objectAlarms += isBelow;
+      }
+    }
+  }
+  long objectTime = elapsedMicroseconds(startTime);
+
+  uint32_t columnAlarms = 0;
+  uint32_t changes = 0;
+  startTime = std::chrono::steady_clock::now();
+  for (uint32_t round = 0; round < rounds; round++)
+  {
+    columnAlarms = 0;
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      for (uint32_t word = 0; word < words; word++)
+      {
+        uint32_t active = belowLimitMask(columns + fuel * words * 32 + word * 32, tenthCentLimits[fuel]) & open[word];
+        changes += __builtin_popcount(active ^ masks[fuel * words + word]);
+        masks[fuel * words + word] = active;
+        columnAlarms += __builtin_popcount(active);
+      }
+    }
+  }
+  long columnTime = elapsedMicroseconds(startTime);
+
+  printf("limit check of %u stations, %u rounds:\n", stations, rounds);
+  printf("    objects : %8ld us  %6zu bytes  %u alarms\n", objectTime, stations * sizeof(ObjectStation), objectAlarms);
+  printf("    columns : %8ld us  %6zu bytes  %u alarms (%u changes)\n", columnTime,
+         numberOfFuelTypes * words * 32 * sizeof(int16_t) + (numberOfFuelTypes + 1) * words * sizeof(uint32_t), columnAlarms, changes);
+  delete[] objects;
+  delete[] columns;
+  delete[] masks;
+  return (objectAlarms == columnAlarms) ? 0 : 1;
+}
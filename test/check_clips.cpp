@@ -0,0 +1,95 @@
+/*
+   Clip library check: is there a clip for every word of the fuel alarms of tanken.json?
+
+     check_clips <tanken.json> <clip directory>      exit code 0: complete, 1: clips missing, 2: error
+
+   Checks the alarm text of every station and fuel type and all numbers of a price ("1 Euro 48 9")
+   with ClipSpeech::check() of the sketch. The clip directory is linked as clipDirectory into the
+   file system stand-in.
+   tanken.json is read with the ArduinoJson stand-in, sized like Storage::getStationList().
+*/
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <ArduinoJson.h>
+#include "fuel.h"
+#include "clipspeech.h"
+
+static bool readFile(const char* path, std::string& content)
+{
+  FILE* file = fopen(path, "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  char buffer[1024];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+  {
+    content.append(buffer, length);
+  }
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string json;
+
+  if (argc != 3)
+  {
+    fprintf(stderr, "usage: %s <tanken.json> <clip directory>\n", argv[0]);
+    return 2;
+  }
+  if (!readFile(argv[1], json))
+  {
+    fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[1]);
+    return 2;
+  }
+  DynamicJsonDocument doc(json.size() * jsonFuelStationListDocFactor);
+  DeserializationError error = deserializeJson(doc, &json[0], json.size());
+  std::vector<std::string> names;
+  std::vector<std::string> cities;
+  for (JsonObject item : doc["StationList"].as<JsonArray>())
+  {
+    names.push_back(item["spname"] | "");
+    cities.push_back(item["spcity"] | "");
+  }
+  if (error || names.empty())
+  {
+    fprintf(stderr, "%s: no stations in %s (%s)\n", argv[0], argv[1], error.c_str());
+    return 2;
+  }
+
+  // the missing clips are printed by ClipSpeech::check()
+  setenv("RADIO_TEST_VERBOSE", "1", 0);
+  char clipPath[PATH_MAX];
+  if ((realpath(argv[2], clipPath) == NULL) ||
+      (symlink(clipPath, (std::string(mockFileSystemRoot()) + clipDirectory).c_str()) != 0))
+  {
+    fprintf(stderr, "%s: no clip directory %s\n", argv[0], argv[2]);
+    return 2;
+  }
+  ClipSpeech clipSpeech;
+  clipSpeech.begin();
+
+  uint32_t missing = 0;
+  for (size_t count = 0; count < names.size(); count++)
+  {
+    FuelStation station;
+    station.setSpeechName(names[count].c_str());
+    station.setSpeechCity(cities[count].c_str());
+    for (uint32_t fuel = 0; fuel < numberOfFuelTypes; fuel++)
+    {
+      missing += clipSpeech.check(station.formatAlarmText(static_cast<FuelType>(fuel), 1.234));
+    }
+  }
+  for (int number = 0; number < 100; number++)
+  {
+    char text[4];
+    snprintf(text, sizeof(text), "%d", number);
+    missing += clipSpeech.check(text);
+  }
+  printf("%zu stations, %u fuel types: %u clips missing\n", names.size(), numberOfFuelTypes, missing);
+  return missing ? 1 : 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "fuel.h"
+
+// access to the private price input of FuelStations (friend): prices enter like a fetch result
+class FuelStationsTest
+{
+  public:
+    // stations "S0".."S<n-1>" with key "id<n>"
+    static void createStations(FuelStations& fuelStations, uint32_t number)
+    {
+      static char names[256][8];
+      static char ids[256][8];
+      fuelStations.createStationList(number);
+      for (uint32_t index = 0; index < number; index++)
+      {
+        FuelStation station;
+        snprintf(names[index], sizeof(names[index]), "S%u", index);
+        snprintf(ids[index], sizeof(ids[index]), "id%u", index);
+        station.setUiName(names[index]);
+        station.setSpeechName(names[index]);
+        station.setSpeechCity("Test");
+        station.setId(ids[index]);
+        fuelStations.setStation(index, station);
+      }
+    }
+
+    static void setResult(FuelStations& fuelStations, uint32_t station, FuelPriceResult::Status status,
+                          float diesel = 0.0, float e5 = 0.0, float e10 = 0.0)
+    {
+      FuelPriceResult& result = fuelStations.resultList[station];
+      result.status = status;
+      result.priceDiesel = diesel;
+      result.priceE5 = e5;
+      result.priceE10 = e10;
+    }
+
+    static void applyPrices(FuelStations& fuelStations)
+    {
+      fuelStations.applyPrices();
+    }
+
+    static int16_t* const* getPriceColumns(FuelStations& fuelStations)
+    {
+      return fuelStations.prices;
+    }
+};
@@ -0,0 +1,294 @@
+#pragma once
+/*
+   Host stand-in for the parts of the ESP32 Arduino core used by the sketch
+
+   millis() and micros() return a simulated time. Without the scheduler (unit tests) it only moves
+   with delay() and mockAdvanceMillis(), so tests with hysteresis or re-announce intervals are
+   deterministic. With mockStartScheduler() (host simulation, see scheduler.cpp) the FreeRTOS tasks
+   of the sketch run one at a time and the clock moves when all of them wait.
+   Serial output is discarded unless the environment variable RADIO_TEST_VERBOSE is set or
+   mockSetSerialOutput() is called. Serial2 is connected to a Nextion stand-in (see mock.cpp).
+*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define F(text) text
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define INPUT_PULLUP 0x05
+#define CHANGE 3
+#define SERIAL_8N1 0x800001c
+
+// time
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(uint32_t us);
+void mockAdvanceMillis(unsigned long ms);
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2 = NULL, const char* server3 = NULL);
+
+// GPIO: the encoder pins stay released (pull-up)
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+
+class String
+{
+  public:
+    String() {}
+    String(const char* text) : text(text ? text : "") {}
+    String(const std::string& text) : text(text) {}
+    explicit String(int value) : text(std::to_string(value)) {}
+    const char* c_str() const
+    {
+      return text.c_str();
+    }
+    unsigned int length() const
+    {
+      return text.length();
+    }
+    char charAt(unsigned int index) const
+    {
+      return index < text.length() ? text[index] : 0;
+    }
+    char operator[](unsigned int index) const
+    {
+      return charAt(index);
+    }
+    int indexOf(char value, unsigned int from = 0) const
+    {
+      size_t position = text.find(value, from);
+      return position == std::string::npos ? -1 : position;
+    }
+    int indexOf(const char* value, unsigned int from = 0) const
+    {
+      size_t position = text.find(value, from);
+      return position == std::string::npos ? -1 : position;
+    }
+    int lastIndexOf(char value) const
+    {
+      size_t position = text.rfind(value);
+      return position == std::string::npos ? -1 : position;
+    }
+    String substring(unsigned int from) const
+    {
+      return from < text.length() ? String(text.substr(from)) : String();
+    }
+    String substring(unsigned int from, unsigned int to) const
+    {
+      return (from < to) && (from < text.length()) ? String(text.substr(from, to - from)) : String();
+    }
+    bool startsWith(const char* prefix) const
+    {
+      return text.compare(0, strlen(prefix), prefix) == 0;
+    }
+    void trim()
+    {
+      size_t first = text.find_first_not_of(" \t\r\n");
+      size_t last = text.find_last_not_of(" \t\r\n");
+      text = (first == std::string::npos) ? std::string() : text.substr(first, last - first + 1);
+    }
+    long toInt() const
+    {
+      return atol(text.c_str());
+    }
+    bool operator==(const char* other) const
+    {
+      return text == other;
+    }
+    String& operator+=(const String& other)
+    {
+      text += other.text;
+      return *this;
+    }
+    String& operator+=(const char* other)
+    {
+      text += other;
+      return *this;
+    }
+    String& operator+=(char other)
+    {
+      text += other;
+      return *this;
+    }
+    friend String operator+(const String& left, const String& right)
+    {
+      return String(left.text + right.text);
+    }
+    friend String operator+(const char* left, const String& right)
+    {
+      return String(left + right.text);
+    }
+    friend String operator+(const String& left, const char* right)
+    {
+      return String(left.text + right);
+    }
+
+  private:
+    std::string text;
+};
+
+// serial output
+class Print;
+
+class Printable
+{
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& output) const = 0;
+};
+
+class Print
+{
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t value) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* text)
+    {
+      return write((const uint8_t*)text, strlen(text));
+    }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const char* text);
+    size_t print(const String& text);
+    size_t print(const Printable& value);
+    size_t print(char value);
+    size_t print(int value);
+    size_t print(unsigned int value);
+    size_t print(long value);
+    size_t print(unsigned long value);
+    size_t print(double value);
+    size_t println();
+    template <typename T> size_t println(const T& value)
+    {
+      return print(value) + println();
+    }
+};
+
+class Stream : public Print
+{
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    void setTimeout(unsigned long timeout) {}
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length)
+    {
+      return readBytes((char*)buffer, length);
+    }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+};
+
+class HardwareSerial : public Stream
+{
+  public:
+    explicit HardwareSerial(int uartNumber) : uartNumber(uartNumber) {}
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+  private:
+    int uartNumber;
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+struct MockUartStatistics
+{
+  uint32_t bytesWritten;            // by the sketch
+  uint32_t writeCalls;
+  uint32_t bytesRead;               // by the sketch
+  unsigned long blockedTime;        // milliseconds write() waited for space in the transmit FIFO
+  unsigned long maxBlockedTime;     // longest single write()
+};
+void mockSetSerialOutput(bool isEnabled);
+void mockSerialInput(const char* text);
+MockUartStatistics mockUartStatistics(int uartNumber);
+void mockNextionValue(const char* name, int32_t value);
+
+// heap: operator new of the host is counted (see mock.cpp)
+class EspClass
+{
+  public:
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getCpuFreqMHz();
+    uint32_t getCycleCount();
+    void restart();
+};
+extern EspClass ESP;
+
+struct MockHeapUntracked
+{
+  // allocations of the stand-ins themselves, which have no counterpart on the ESP32
+  MockHeapUntracked();
+  ~MockHeapUntracked();
+};
+size_t mockHeapUsed();
+size_t mockHeapPeak();
+
+// FreeRTOS: tasks are only started with mockStartScheduler() (see scheduler.cpp)
+typedef void* TaskHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+
+BaseType_t xTaskCreate(void (*task)(void*), const char* name, uint32_t stackSize, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* handle);
+BaseType_t xTaskCreatePinnedToCore(void (*task)(void*), const char* name, uint32_t stackSize, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+void mockStartScheduler();
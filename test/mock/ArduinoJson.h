@@ -0,0 +1,342 @@
+#pragma once
+/*
+   Host stand-in for the part of ArduinoJson 6 used by the sketch: parse, filter, build and serialize.
+
+   The memory pool is modelled like the one of ArduinoJson on the ESP32: every member or element
+   takes one slot of 16 bytes, copied strings take their length + 1 (equal strings are stored once).
+   Strings of a writable char buffer are not copied (zero-copy), neither are const char* values and
+   keys assigned by the sketch. A document over its capacity fails with NoMemory like the original.
+   A DynamicJsonDocument allocates its capacity on the simulated heap; the nodes themselves are kept
+   outside of it.
+*/
+#include <Arduino.h>
+#include <FS.h>
+#include <type_traits>
+#include <vector>
+
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+#define JSON_ARRAY_SIZE(n) ((n) * 16)
+
+class JsonDocument;
+
+struct JsonNode
+{
+  enum class Type {NONE, BOOLEAN, INTEGER, REAL, STRING, ARRAY, OBJECT};
+  Type type = Type::NONE;
+  bool boolean = false;
+  int64_t integer = 0;
+  double real = 0.0;
+  const char* text = NULL;
+  std::vector<std::pair<const char*, JsonNode*>> members;     // array: key NULL
+};
+
+class JsonArray;
+class JsonObject;
+
+class JsonVariant
+{
+  public:
+    JsonVariant() {}
+    JsonVariant(JsonDocument* doc, JsonNode* node, JsonNode* parent = NULL, const char* key = NULL) :
+      doc(doc), node(node), parent(parent), key(key) {}
+
+    // member of an object (created by an assignment)
+    JsonVariant operator[](const char* key) const;
+    // element of an array
+    JsonVariant operator[](size_t index) const;
+    JsonVariant operator[](int index) const
+    {
+      return (*this)[(size_t)index];
+    }
+
+    JsonVariant& operator=(const JsonVariant& value) = delete;
+    JsonVariant& operator=(bool value);
+    JsonVariant& operator=(const char* value);
+    JsonVariant& operator=(char* value);
+    JsonVariant& operator=(const String& value);
+    JsonVariant& operator=(double value);
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0> JsonVariant& operator=(T value)
+    {
+      JsonNode* target = prepare(JsonNode::Type::INTEGER);
+      if (target)
+      {
+        target->integer = value;
+      }
+      return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0> operator T() const
+    {
+      if (node == NULL)
+      {
+        return T();
+      }
+      switch (node->type)
+      {
+        case JsonNode::Type::BOOLEAN:
+          return (T)node->boolean;
+        case JsonNode::Type::INTEGER:
+          return (T)node->integer;
+        case JsonNode::Type::REAL:
+          return (T)node->real;
+        default:
+          return T();
+      }
+    }
+    operator const char*() const
+    {
+      return (node && (node->type == JsonNode::Type::STRING)) ? node->text : NULL;
+    }
+    template <typename T> T as() const
+    {
+      return T(*this);
+    }
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0> T operator|(T defaultValue) const
+    {
+      return (node && ((node->type == JsonNode::Type::BOOLEAN) == std::is_same<T, bool>::value) &&
+              ((node->type == JsonNode::Type::BOOLEAN) || (node->type == JsonNode::Type::INTEGER) ||
+               (node->type == JsonNode::Type::REAL))) ? T(*this) : defaultValue;
+    }
+    const char* operator|(const char* defaultValue) const
+    {
+      const char* text = *this;
+      return text ? text : defaultValue;
+    }
+    bool operator==(const char* text) const
+    {
+      const char* value = *this;
+      return value && text && (strcmp(value, text) == 0);
+    }
+    bool operator!=(const char* text) const
+    {
+      return !(*this == text);
+    }
+    bool isNull() const
+    {
+      return (node == NULL) || (node->type == JsonNode::Type::NONE);
+    }
+    size_t size() const
+    {
+      return (node && ((node->type == JsonNode::Type::ARRAY) || (node->type == JsonNode::Type::OBJECT))) ?
+             node->members.size() : 0;
+    }
+
+    JsonArray createNestedArray(const char* key) const;
+    JsonObject createNestedObject(const char* key) const;
+    // element appended to an array
+    JsonArray createNestedArray() const;
+    JsonObject createNestedObject() const;
+
+    JsonNode* getNode() const
+    {
+      return node;
+    }
+
+  protected:
+    // node of an assignment: created in the parent if missing; NULL: no memory or no container
+    JsonNode* prepare(JsonNode::Type type);
+    JsonNode* addMember(const char* key, JsonNode::Type type) const;
+
+    JsonDocument* doc = NULL;
+    JsonNode* node = NULL;
+    JsonNode* parent = NULL;
+    const char* key = NULL;
+};
+
+class JsonArray : public JsonVariant
+{
+  public:
+    JsonArray() {}
+    JsonArray(const JsonVariant& variant);
+
+    class iterator
+    {
+      public:
+        iterator(JsonDocument* doc, JsonNode* array, size_t index) : doc(doc), array(array), index(index) {}
+        JsonVariant operator*() const
+        {
+          return JsonVariant(doc, array->members[index].second, array);
+        }
+        iterator& operator++()
+        {
+          index++;
+          return *this;
+        }
+        bool operator!=(const iterator& other) const
+        {
+          return index != other.index;
+        }
+
+      private:
+        JsonDocument* doc;
+        JsonNode* array;
+        size_t index;
+    };
+    iterator begin() const
+    {
+      return iterator(doc, node, 0);
+    }
+    iterator end() const
+    {
+      return iterator(doc, node, size());
+    }
+};
+
+class JsonObject : public JsonVariant
+{
+  public:
+    JsonObject() {}
+    JsonObject(const JsonVariant& variant);
+};
+
+class JsonDocument
+{
+  public:
+    JsonDocument(const JsonDocument&) = delete;
+    JsonDocument& operator=(const JsonDocument&) = delete;
+
+    JsonVariant operator[](const char* key)
+    {
+      return getRoot()[key];
+    }
+    JsonArray createNestedArray(const char* key)
+    {
+      return getRoot().createNestedArray(key);
+    }
+    JsonObject createNestedObject(const char* key)
+    {
+      return getRoot().createNestedObject(key);
+    }
+    template <typename T> T as()
+    {
+      return getRoot().as<T>();
+    }
+    bool isNull() const
+    {
+      return root.type == JsonNode::Type::NONE;
+    }
+    size_t memoryUsage() const
+    {
+      return used;
+    }
+    size_t capacity() const
+    {
+      return poolCapacity;
+    }
+    bool overflowed() const
+    {
+      return isOverflowed;
+    }
+    void clear();
+
+    JsonVariant getRoot()
+    {
+      return JsonVariant(this, &root, NULL, NULL);
+    }
+    // slot of a member or element; NULL: capacity exceeded
+    JsonNode* newNode(JsonNode::Type type);
+    // isCounted: the string takes pool memory (copied from the input)
+    const char* storeString(const char* text, size_t length, bool isCounted);
+
+  protected:
+    explicit JsonDocument(size_t capacity);
+    ~JsonDocument();
+
+  private:
+    struct JsonPool* pool;      // nodes and strings, outside of the simulated heap
+    JsonNode root;
+    size_t poolCapacity;
+    size_t used = 0;
+    bool isOverflowed = false;
+};
+
+class DynamicJsonDocument : public JsonDocument
+{
+  public:
+    explicit DynamicJsonDocument(size_t capacity) : JsonDocument(capacity), memory(new uint8_t[capacity]) {}
+    ~DynamicJsonDocument()
+    {
+      delete[] memory;
+    }
+
+  private:
+    uint8_t* memory;    // only allocated: the capacity is taken from the heap like on the ESP32
+};
+
+template <size_t documentCapacity> class StaticJsonDocument : public JsonDocument
+{
+  public:
+    StaticJsonDocument() : JsonDocument(documentCapacity) {}
+};
+
+class DeserializationError
+{
+  public:
+    enum Code {Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep};
+
+    DeserializationError(Code code = Ok) : code(code) {}
+    explicit operator bool() const
+    {
+      return code != Ok;
+    }
+    bool operator==(Code other) const
+    {
+      return code == other;
+    }
+    Code getCode() const
+    {
+      return code;
+    }
+    const char* c_str() const;
+    const char* f_str() const
+    {
+      return c_str();
+    }
+
+  private:
+    Code code;
+};
+
+namespace DeserializationOption
+{
+struct Filter
+{
+  explicit Filter(JsonDocument& filter) : node(filter.getRoot().getNode()) {}
+  JsonNode* node;
+};
+}
+
+// input: text with its length; isZeroCopy: strings stay in the (writable) input
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length, bool isZeroCopy, const JsonNode* filter);
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input, const JsonNode* filter);
+
+inline DeserializationError deserializeJson(JsonDocument& doc, char* input, size_t length)
+{
+  return deserializeJson(doc, input, length, true, NULL);
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input)
+{
+  return deserializeJson(doc, input, strlen(input), false, NULL);
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input, DeserializationOption::Filter filter)
+{
+  return deserializeJson(doc, input, strlen(input), false, filter.node);
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, Stream& input)
+{
+  return deserializeJson(doc, input, NULL);
+}
+inline DeserializationError deserializeJson(JsonDocument& doc, Stream& input, DeserializationOption::Filter filter)
+{
+  return deserializeJson(doc, input, filter.node);
+}
+
+size_t serializeJson(const JsonNode* node, Print& output);
+inline size_t serializeJson(JsonDocument& doc, Print& output)
+{
+  return serializeJson(doc.getRoot().getNode(), output);
+}
+inline size_t serializeJson(const JsonVariant& variant, Print& output)
+{
+  return serializeJson(variant.getNode(), output);
+}
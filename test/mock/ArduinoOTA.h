@@ -0,0 +1,56 @@
+#pragma once
+/*
+   Host stand-in for ArduinoOTA: no update is ever offered, the callbacks are only stored
+*/
+#include <Arduino.h>
+#include <functional>
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+typedef enum
+{
+  OTA_AUTH_ERROR,
+  OTA_BEGIN_ERROR,
+  OTA_CONNECT_ERROR,
+  OTA_RECEIVE_ERROR,
+  OTA_END_ERROR
+} ota_error_t;
+
+class ArduinoOTAClass
+{
+  public:
+    ArduinoOTAClass& onStart(std::function<void(void)> callback)
+    {
+      startCallback = callback;
+      return *this;
+    }
+    ArduinoOTAClass& onEnd(std::function<void(void)> callback)
+    {
+      endCallback = callback;
+      return *this;
+    }
+    ArduinoOTAClass& onProgress(std::function<void(unsigned int, unsigned int)> callback)
+    {
+      progressCallback = callback;
+      return *this;
+    }
+    ArduinoOTAClass& onError(std::function<void(ota_error_t)> callback)
+    {
+      errorCallback = callback;
+      return *this;
+    }
+    int getCommand()
+    {
+      return U_FLASH;
+    }
+    void begin() {}
+    void handle() {}
+
+  private:
+    std::function<void(void)> startCallback;
+    std::function<void(void)> endCallback;
+    std::function<void(unsigned int, unsigned int)> progressCallback;
+    std::function<void(ota_error_t)> errorCallback;
+};
+extern ArduinoOTAClass ArduinoOTA;
@@ -0,0 +1,62 @@
+#pragma once
+/*
+   Host stand-in for the Arduino FS: paths are mapped into the directory mockFileSystemRoot()
+   Like the ESP32 core, copies of a File share the open file.
+*/
+#include <Arduino.h>
+#include <stdio.h>
+#include <dirent.h>
+#include <memory>
+#include <string>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+const char* mockFileSystemRoot();
+
+class File : public Stream
+{
+  public:
+    File() {}
+    File(const char* path, const char* mode);
+
+    operator bool() const;
+    bool isDirectory();
+    const char* name();
+    size_t size();
+    size_t position();
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    bool seek(uint32_t position);
+    File openNextFile();
+    void close();
+
+  private:
+    struct Handle
+    {
+      FILE* file = NULL;
+      DIR* directory = NULL;
+      std::string path;
+      ~Handle();
+    };
+    std::shared_ptr<Handle> handle;
+};
+
+namespace fs
+{
+class FS
+{
+  public:
+    File open(const char* path, const char* mode = FILE_READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+    bool mkdir(const char* path);
+};
+}
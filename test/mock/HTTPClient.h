@@ -0,0 +1,57 @@
+#pragma once
+/*
+   Host stand-in for the ESP32 HTTPClient: answers with the responses registered by mockHttpResponse()
+   (longest matching URL prefix, the scheme is ignored). A host without any response cannot be
+   resolved, other paths of a known host get 404. A request takes the simulated time of name lookup,
+   connect, TLS handshake (https), server and transfer (see network.cpp).
+*/
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define HTTP_CODE_OK 200
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+
+struct MockHttpResponse
+{
+  int code;
+  std::string contentType;
+  std::string location;
+  std::string body;
+};
+
+void mockHttpResponse(const char* url, int code, const char* contentType, const std::string& body, const char* location = "");
+// finds the response and waits for server and transfer (not for the connect)
+const MockHttpResponse* mockHttpRequest(const char* url);
+// waits for name lookup, connect and handshake like WiFiClient::connect(); false: refused
+bool mockHttpConnect(const char* url);
+
+class HTTPClient
+{
+  public:
+    bool begin(const char* url);
+    bool begin(WiFiClient& client, const char* url);
+    void end();
+    void setConnectTimeout(int32_t timeout) {}
+    void setTimeout(uint16_t timeout) {}
+    void useHTTP10(bool isHTTP10) {}
+    void setReuse(bool reuse)
+    {
+      isReuse = reuse;
+    }
+    void collectHeaders(const char* headerKeys[], const size_t headerCount) {}
+    int GET();
+    int getSize();
+    String getString();
+    String header(const char* name);
+    WiFiClient& getStream();
+    WiFiClient* getStreamPtr();
+    int writeToStream(Stream* stream);
+
+  private:
+    WiFiClient plainClient;
+    WiFiClient* client = NULL;
+    std::string url;
+    const MockHttpResponse* response = NULL;
+    bool isReuse = true;
+};
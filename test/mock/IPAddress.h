@@ -0,0 +1,19 @@
+#pragma once
+#include <Arduino.h>
+
+class IPAddress : public Printable
+{
+  public:
+    IPAddress() {}
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) : address{first, second, third, fourth} {}
+    uint8_t operator[](int index) const
+    {
+      return address[index];
+    }
+    bool fromString(const char* text);
+    String toString() const;
+    size_t printTo(Print& output) const override;
+
+  private:
+    uint8_t address[4] = {};
+};
@@ -0,0 +1,15 @@
+#pragma once
+#include "FS.h"
+
+class LITTLEFSFS : public fs::FS
+{
+  public:
+    bool begin(bool formatOnFail = false)
+    {
+      return true;
+    }
+    void end() {}
+    size_t totalBytes();
+    size_t usedBytes();
+};
+extern LITTLEFSFS LITTLEFS;
@@ -0,0 +1,21 @@
+#pragma once
+/*
+   Host stand-in for the NVS: the values are kept in memory for the lifetime of the process
+*/
+#include <Arduino.h>
+
+class Preferences
+{
+  public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+    int32_t getInt(const char* key, int32_t defaultValue = 0);
+    size_t putInt(const char* key, int32_t value);
+    bool remove(const char* key);
+    bool clear();
+
+  private:
+    std::string space;
+    bool isOpen = false;
+    bool isReadOnly = false;
+};
@@ -0,0 +1,56 @@
+#pragma once
+/*
+   Host stand-in for the ESP32 WiFi: the networks of mockWiFiNetwork() are on air, and the hosts of
+   mockHttpResponse() (HTTPClient.h) can be reached. Name lookups go through a table like the one of
+   lwIP: a few entries, the oldest is replaced. Connecting takes simulated time (see network.cpp).
+*/
+#include <Arduino.h>
+#include "IPAddress.h"
+
+#define WL_IDLE_STATUS 0
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+class WiFiClass
+{
+  public:
+    int status();
+    bool mode(int mode);
+    void begin(const char* ssid, const char* password);
+    bool disconnect();
+    IPAddress localIP();
+    int16_t scanNetworks();
+    String SSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    String BSSIDstr(uint8_t index);
+    int hostByName(const char* host, IPAddress& address);
+};
+extern WiFiClass WiFi;
+
+// plain TCP connection; the received data is the body of the response to the last request
+class WiFiClient : public Stream
+{
+  public:
+    virtual ~WiFiClient() {}
+    virtual int connect(const char* host, uint16_t port);
+    uint8_t connected();
+    void stop();
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t value) override;
+    using Print::write;
+
+    // stand-in: data "received" by the next reads
+    void mockReceive(const std::string& data);
+
+  protected:
+    bool isConnected = false;
+    std::string received;
+    size_t receivedPosition = 0;
+};
+
+void mockWiFiNetwork(const char* ssid, int32_t rssi);
+// time of the lookup in milliseconds, false: unknown host
+bool mockLookupHost(const char* host, unsigned long* lookupTime);
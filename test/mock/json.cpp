@@ -0,0 +1,761 @@
+#include <ArduinoJson.h>
+#include <deque>
+#include <set>
+
+constexpr size_t jsonSlotSize = 16;
+constexpr int jsonNestingLimit = 10;
+
+struct JsonPool
+{
+  std::deque<JsonNode> nodes;
+  std::set<std::string> strings;
+};
+
+// ============================================================================================================================
+// document
+
+JsonDocument::JsonDocument(size_t capacity) : poolCapacity(capacity)
+{
+  MockHeapUntracked untracked;
+  pool = new JsonPool;
+}
+
+JsonDocument::~JsonDocument()
+{
+  MockHeapUntracked untracked;
+  root.members.clear();
+  root.members.shrink_to_fit();
+  delete pool;
+}
+
+void JsonDocument::clear()
+{
+  MockHeapUntracked untracked;
+  root = JsonNode();
+  pool->nodes.clear();
+  pool->strings.clear();
+  used = 0;
+  isOverflowed = false;
+}
+
+JsonNode* JsonDocument::newNode(JsonNode::Type type)
+{
+  if (used + jsonSlotSize > poolCapacity)
+  {
+    isOverflowed = true;
+    return NULL;
+  }
+  MockHeapUntracked untracked;
+  used += jsonSlotSize;
+  pool->nodes.emplace_back();
+  pool->nodes.back().type = type;
+  return &pool->nodes.back();
+}
+
+const char* JsonDocument::storeString(const char* text, size_t length, bool isCounted)
+{
+  MockHeapUntracked untracked;
+  std::string value(text, length);
+  auto found = pool->strings.find(value);
+  if (found != pool->strings.end())
+  {
+    return found->c_str();
+  }
+  if (isCounted)
+  {
+    if (used + length + 1 > poolCapacity)
+    {
+      isOverflowed = true;
+      return NULL;
+    }
+    used += length + 1;
+  }
+  return pool->strings.insert(value).first->c_str();
+}
+
+// ============================================================================================================================
+// variants
+
+JsonArray::JsonArray(const JsonVariant& variant) : JsonVariant(variant)
+{
+  if (node && (node->type != JsonNode::Type::ARRAY))
+  {
+    node = NULL;
+  }
+}
+
+JsonObject::JsonObject(const JsonVariant& variant) : JsonVariant(variant)
+{
+  if (node && (node->type != JsonNode::Type::OBJECT))
+  {
+    node = NULL;
+  }
+}
+
+JsonVariant JsonVariant::operator[](const char* key) const
+{
+  if (node && (node->type == JsonNode::Type::OBJECT))
+  {
+    for (auto& member : node->members)
+    {
+      if (strcmp(member.first, key) == 0)
+      {
+        return JsonVariant(doc, member.second, node, key);
+      }
+    }
+  }
+  return JsonVariant(doc, NULL, node, key);
+}
+
+JsonVariant JsonVariant::operator[](size_t index) const
+{
+  if (node && (node->type == JsonNode::Type::ARRAY) && (index < node->members.size()))
+  {
+    return JsonVariant(doc, node->members[index].second, node);
+  }
+  return JsonVariant();
+}
+
+JsonNode* JsonVariant::addMember(const char* key, JsonNode::Type type) const
+{
+  // key NULL: element of an array
+  JsonNode* container = key ? parent : node;
+  if ((doc == NULL) || (container == NULL))
+  {
+    return NULL;
+  }
+  JsonNode::Type containerType = key ? JsonNode::Type::OBJECT : JsonNode::Type::ARRAY;
+  if (container->type == JsonNode::Type::NONE)
+  {
+    container->type = containerType;
+  }
+  if (container->type != containerType)
+  {
+    return NULL;
+  }
+  const char* storedKey = key ? doc->storeString(key, strlen(key), false) : NULL;
+  JsonNode* member = doc->newNode(type);
+  if (member)
+  {
+    MockHeapUntracked untracked;
+    container->members.emplace_back(storedKey, member);
+  }
+  return member;
+}
+
+JsonNode* JsonVariant::prepare(JsonNode::Type type)
+{
+  if (node == NULL)
+  {
+    node = key ? addMember(key, type) : NULL;
+    if (node == NULL)
+    {
+      return NULL;
+    }
+  }
+  MockHeapUntracked untracked;
+  *node = JsonNode();
+  node->type = type;
+  return node;
+}
+
+JsonVariant& JsonVariant::operator=(bool value)
+{
+  JsonNode* target = prepare(JsonNode::Type::BOOLEAN);
+  if (target)
+  {
+    target->boolean = value;
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(const char* value)
+{
+  // stored as pointer by ArduinoJson: takes no pool memory
+  JsonNode* target = prepare(value ? JsonNode::Type::STRING : JsonNode::Type::NONE);
+  if (target && value)
+  {
+    target->text = doc->storeString(value, strlen(value), false);
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(char* value)
+{
+  JsonNode* target = prepare(value ? JsonNode::Type::STRING : JsonNode::Type::NONE);
+  if (target && value)
+  {
+    target->text = doc->storeString(value, strlen(value), true);
+    if (target->text == NULL)
+    {
+      target->type = JsonNode::Type::NONE;
+    }
+  }
+  return *this;
+}
+
+JsonVariant& JsonVariant::operator=(const String& value)
+{
+  return *this = (char*)value.c_str();
+}
+
+JsonVariant& JsonVariant::operator=(double value)
+{
+  JsonNode* target = prepare(JsonNode::Type::REAL);
+  if (target)
+  {
+    target->real = value;
+  }
+  return *this;
+}
+
+JsonArray JsonVariant::createNestedArray(const char* key) const
+{
+  JsonVariant member = (*this)[key];
+  return JsonArray(JsonVariant(doc, member.addMember(key, JsonNode::Type::ARRAY), member.parent, key));
+}
+
+JsonObject JsonVariant::createNestedObject(const char* key) const
+{
+  JsonVariant member = (*this)[key];
+  return JsonObject(JsonVariant(doc, member.addMember(key, JsonNode::Type::OBJECT), member.parent, key));
+}
+
+JsonArray JsonVariant::createNestedArray() const
+{
+  return JsonArray(JsonVariant(doc, addMember(NULL, JsonNode::Type::ARRAY), node));
+}
+
+JsonObject JsonVariant::createNestedObject() const
+{
+  return JsonObject(JsonVariant(doc, addMember(NULL, JsonNode::Type::OBJECT), node));
+}
+
+// ============================================================================================================================
+// parser
+
+const char* DeserializationError::c_str() const
+{
+  static const char* const texts[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+  return texts[code];
+}
+
+class JsonReader
+{
+  public:
+    JsonReader(JsonDocument& doc, bool isZeroCopy) : doc(doc), isZeroCopy(isZeroCopy) {}
+    virtual ~JsonReader() {}
+
+    DeserializationError parse(const JsonNode* filter)
+    {
+      MockHeapUntracked untracked;
+      skipSpace();
+      if (current() < 0)
+      {
+        return DeserializationError::EmptyInput;
+      }
+      JsonNode* root = doc.getRoot().getNode();
+      *root = JsonNode();
+      if (!parseValue(root, filter, 0))
+      {
+        *root = JsonNode();
+        return error;
+      }
+      return DeserializationError::Ok;
+    }
+
+  protected:
+    // current character (-1: end of input) and step to the next one
+    virtual int current() = 0;
+    virtual void next() = 0;
+    // zero-copy: the unescaped strings are written back into the input from here
+    virtual char* writePosition()
+    {
+      return NULL;
+    }
+
+  private:
+    bool fail(DeserializationError::Code code)
+    {
+      if (!error)
+      {
+        error = code;
+      }
+      return false;
+    }
+
+    void skipSpace()
+    {
+      while ((current() == ' ') || (current() == '\t') || (current() == '\r') || (current() == '\n'))
+      {
+        next();
+      }
+    }
+
+    static bool isAllowed(const JsonNode* filter)
+    {
+      // no filter: everything; true: the whole value; object/array: parts of it
+      return (filter == NULL) || (filter->type == JsonNode::Type::OBJECT) || (filter->type == JsonNode::Type::ARRAY) ||
+             ((filter->type == JsonNode::Type::BOOLEAN) && filter->boolean);
+    }
+
+    static const JsonNode* memberFilter(const JsonNode* filter, const char* key)
+    {
+      if ((filter == NULL) || (filter->type != JsonNode::Type::OBJECT))
+      {
+        return ((filter != NULL) && (filter->type == JsonNode::Type::BOOLEAN) && filter->boolean) ? NULL : filter;
+      }
+      const JsonNode* wildcard = NULL;
+      for (auto& member : filter->members)
+      {
+        if (strcmp(member.first, key) == 0)
+        {
+          return member.second;
+        }
+        if (strcmp(member.first, "*") == 0)
+        {
+          wildcard = member.second;
+        }
+      }
+      return wildcard ? wildcard : &rejected;
+    }
+
+    static const JsonNode* elementFilter(const JsonNode* filter)
+    {
+      if ((filter == NULL) || (filter->type != JsonNode::Type::ARRAY))
+      {
+        return ((filter != NULL) && (filter->type == JsonNode::Type::BOOLEAN) && filter->boolean) ? NULL : filter;
+      }
+      return filter->members.empty() ? &rejected : filter->members[0].second;
+    }
+
+    // value into target; target NULL: skipped by the filter
+    bool parseValue(JsonNode* target, const JsonNode* filter, int depth)
+    {
+      if (depth > jsonNestingLimit)
+      {
+        return fail(DeserializationError::TooDeep);
+      }
+      if (!isAllowed(filter))
+      {
+        target = NULL;
+      }
+      skipSpace();
+      switch (current())
+      {
+        case '{':
+          return parseObject(target, filter, depth);
+        case '[':
+          return parseArray(target, filter, depth);
+        case '"':
+        {
+          const char* text;
+          if (!parseString(&text, target != NULL))
+          {
+            return false;
+          }
+          if (target)
+          {
+            target->type = JsonNode::Type::STRING;
+            target->text = text;
+          }
+          return true;
+        }
+        case -1:
+          return fail(DeserializationError::IncompleteInput);
+        default:
+          return parseLiteral(target);
+      }
+    }
+
+    bool parseObject(JsonNode* target, const JsonNode* filter, int depth)
+    {
+      next();
+      if (target)
+      {
+        target->type = JsonNode::Type::OBJECT;
+      }
+      skipSpace();
+      if (current() == '}')
+      {
+        next();
+        return true;
+      }
+      while (true)
+      {
+        skipSpace();
+        if (current() != '"')
+        {
+          return fail(current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+        }
+        const char* key;
+        if (!parseString(&key, false))
+        {
+          return false;
+        }
+        skipSpace();
+        if (current() != ':')
+        {
+          return fail(current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+        }
+        next();
+        const JsonNode* childFilter = memberFilter(filter, key);
+        JsonNode* child = NULL;
+        if (target && isAllowed(childFilter))
+        {
+          // the key is kept only for a member of the document
+          key = isZeroCopy ? key : doc.storeString(key, strlen(key), true);
+          child = key ? doc.newNode(JsonNode::Type::NONE) : NULL;
+          if (child == NULL)
+          {
+            return fail(DeserializationError::NoMemory);
+          }
+          target->members.emplace_back(key, child);
+        }
+        if (!parseValue(child, childFilter, depth + 1))
+        {
+          return false;
+        }
+        skipSpace();
+        if (current() == ',')
+        {
+          next();
+          continue;
+        }
+        if (current() == '}')
+        {
+          next();
+          return true;
+        }
+        return fail(current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+      }
+    }
+
+    bool parseArray(JsonNode* target, const JsonNode* filter, int depth)
+    {
+      next();
+      if (target)
+      {
+        target->type = JsonNode::Type::ARRAY;
+      }
+      skipSpace();
+      if (current() == ']')
+      {
+        next();
+        return true;
+      }
+      const JsonNode* childFilter = elementFilter(filter);
+      while (true)
+      {
+        JsonNode* child = NULL;
+        if (target && isAllowed(childFilter))
+        {
+          child = doc.newNode(JsonNode::Type::NONE);
+          if (child == NULL)
+          {
+            return fail(DeserializationError::NoMemory);
+          }
+          target->members.emplace_back((const char*)NULL, child);
+        }
+        if (!parseValue(child, childFilter, depth + 1))
+        {
+          return false;
+        }
+        skipSpace();
+        if (current() == ',')
+        {
+          next();
+          continue;
+        }
+        if (current() == ']')
+        {
+          next();
+          return true;
+        }
+        return fail(current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+      }
+    }
+
+    bool parseString(const char** text, bool isStored)
+    {
+      // not stored: only read for the filter (keys, skipped values)
+      std::string value;
+      next();
+      char* output = writePosition();
+      char* outputStart = output;
+      while (current() != '"')
+      {
+        int character = current();
+        if (character < 0)
+        {
+          return fail(DeserializationError::IncompleteInput);
+        }
+        if (character == '\\')
+        {
+          next();
+          switch (current())
+          {
+            case 'n':
+              character = '\n';
+              break;
+            case 't':
+              character = '\t';
+              break;
+            case 'r':
+              character = '\r';
+              break;
+            case 'b':
+              character = '\b';
+              break;
+            case 'f':
+              character = '\f';
+              break;
+            case 'u':
+            {
+              // only the code points of one byte (no surrogates)
+              char digits[5] = {};
+              for (int count = 0; count < 4; count++)
+              {
+                next();
+                if (current() < 0)
+                {
+                  return fail(DeserializationError::IncompleteInput);
+                }
+                digits[count] = current();
+              }
+              character = strtol(digits, NULL, 16) & 0xFF;
+              break;
+            }
+            case -1:
+              return fail(DeserializationError::IncompleteInput);
+            default:
+              character = current();
+          }
+        }
+        value += (char)character;
+        if (output)
+        {
+          *output++ = character;
+        }
+        next();
+      }
+      next();
+      if (output)
+      {
+        // zero-copy: the string stays in the input buffer (written behind the read position)
+        *output = 0;
+        *text = outputStart;
+        return true;
+      }
+      if (!isStored)
+      {
+        lastKey = value;
+        *text = lastKey.c_str();
+        return true;
+      }
+      *text = doc.storeString(value.c_str(), value.length(), true);
+      return (*text != NULL) || fail(DeserializationError::NoMemory);
+    }
+
+    bool parseLiteral(JsonNode* target)
+    {
+      std::string token;
+      while ((current() >= 0) && (strchr(",]} \t\r\n", current()) == NULL))
+      {
+        token += (char)current();
+        next();
+      }
+      JsonNode value;
+      char* end;
+      if (token == "true" || token == "false")
+      {
+        value.type = JsonNode::Type::BOOLEAN;
+        value.boolean = (token == "true");
+      }
+      else if (token == "null")
+      {
+        value.type = JsonNode::Type::NONE;
+      }
+      else if (token.find_first_of(".eE") == std::string::npos)
+      {
+        value.type = JsonNode::Type::INTEGER;
+        value.integer = strtoll(token.c_str(), &end, 10);
+        if (token.empty() || *end)
+        {
+          return fail(current() < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput);
+        }
+      }
+      else
+      {
+        value.type = JsonNode::Type::REAL;
+        value.real = strtod(token.c_str(), &end);
+        if (*end)
+        {
+          return fail(DeserializationError::InvalidInput);
+        }
+      }
+      if (target)
+      {
+        *target = value;
+      }
+      return true;
+    }
+
+    static const JsonNode rejected;
+
+    JsonDocument& doc;
+    bool isZeroCopy;
+    DeserializationError error;
+    std::string lastKey;
+};
+
+const JsonNode JsonReader::rejected;
+
+class JsonBufferReader : public JsonReader
+{
+  public:
+    JsonBufferReader(JsonDocument& doc, const char* input, size_t length, bool isZeroCopy) :
+      JsonReader(doc, isZeroCopy), input(input), length(length), isZeroCopy(isZeroCopy) {}
+
+  protected:
+    int current() override
+    {
+      return (position < length) && input[position] ? (uint8_t)input[position] : -1;
+    }
+    void next() override
+    {
+      if (position < length)
+      {
+        position++;
+      }
+    }
+    char* writePosition() override
+    {
+      return isZeroCopy ? (char*)input + position : NULL;
+    }
+
+  private:
+    const char* input;
+    size_t length;
+    size_t position = 0;
+    bool isZeroCopy;
+};
+
+class JsonStreamReader : public JsonReader
+{
+  public:
+    JsonStreamReader(JsonDocument& doc, Stream& input) : JsonReader(doc, false), input(input) {}
+
+  protected:
+    int current() override
+    {
+      if (!isRead)
+      {
+        character = input.read();
+        isRead = true;
+      }
+      return character;
+    }
+    void next() override
+    {
+      current();
+      isRead = false;
+    }
+
+  private:
+    Stream& input;
+    int character = -1;
+    bool isRead = false;
+};
+
+DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length, bool isZeroCopy, const JsonNode* filter)
+{
+  doc.clear();
+  JsonBufferReader reader(doc, input, length, isZeroCopy);
+  return reader.parse(filter);
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input, const JsonNode* filter)
+{
+  doc.clear();
+  JsonStreamReader reader(doc, input);
+  return reader.parse(filter);
+}
+
+// ============================================================================================================================
+// serializer (compact like serializeJson())
+
+static size_t printString(const char* text, Print& output)
+{
+  size_t count = output.print('"');
+  for (const char* character = text; *character; character++)
+  {
+    switch (*character)
+    {
+      case '"':
+        count += output.print("\\\"");
+        break;
+      case '\\':
+        count += output.print("\\\\");
+        break;
+      case '\n':
+        count += output.print("\\n");
+        break;
+      case '\r':
+        count += output.print("\\r");
+        break;
+      case '\t':
+        count += output.print("\\t");
+        break;
+      default:
+        count += output.print(*character);
+    }
+  }
+  return count + output.print('"');
+}
+
+size_t serializeJson(const JsonNode* node, Print& output)
+{
+  if (node == NULL)
+  {
+    return output.print("null");
+  }
+  char number[32];
+  size_t count = 0;
+  switch (node->type)
+  {
+    case JsonNode::Type::NONE:
+      return output.print("null");
+    case JsonNode::Type::BOOLEAN:
+      return output.print(node->boolean ? "true" : "false");
+    case JsonNode::Type::INTEGER:
+      snprintf(number, sizeof(number), "%lld", (long long)node->integer);
+      return output.print(number);
+    case JsonNode::Type::REAL:
+      snprintf(number, sizeof(number), "%.9g", node->real);
+      return output.print(number);
+    case JsonNode::Type::STRING:
+      return printString(node->text, output);
+    case JsonNode::Type::ARRAY:
+    case JsonNode::Type::OBJECT:
+    {
+      bool isObject = node->type == JsonNode::Type::OBJECT;
+      count += output.print(isObject ? '{' : '[');
+      for (size_t index = 0; index < node->members.size(); index++)
+      {
+        if (index)
+        {
+          count += output.print(',');
+        }
+        if (isObject)
+        {
+          count += printString(node->members[index].first, output);
+          count += output.print(':');
+        }
+        count += serializeJson(node->members[index].second, output);
+      }
+      return count + output.print(isObject ? '}' : ']');
+    }
+  }
+  return count;
+}
@@ -0,0 +1,702 @@
+#include <Arduino.h>
+#include <FS.h>
+#include <LITTLEFS.h>
+#include <Preferences.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <new>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+EspClass ESP;
+LITTLEFSFS LITTLEFS;
+
+// ============================================================================================================================
+// serial output
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+  size_t count = 0;
+  while (size--)
+  {
+    count += write(*buffer++);
+  }
+  return count;
+}
+
+size_t Print::printf(const char* format, ...)
+{
+  char text[256];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(text, sizeof(text), format, arguments);
+  va_end(arguments);
+  return print(text);
+}
+
+size_t Print::print(const char* text)
+{
+  return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(const String& text)
+{
+  return print(text.c_str());
+}
+
+size_t Print::print(const Printable& value)
+{
+  return value.printTo(*this);
+}
+
+size_t Print::print(char value)
+{
+  return write(value);
+}
+
+size_t Print::print(int value)
+{
+  return printf("%d", value);
+}
+
+size_t Print::print(unsigned int value)
+{
+  return printf("%u", value);
+}
+
+size_t Print::print(long value)
+{
+  return printf("%ld", value);
+}
+
+size_t Print::print(unsigned long value)
+{
+  return printf("%lu", value);
+}
+
+size_t Print::print(double value)
+{
+  return printf("%.2f", value);
+}
+
+size_t Print::println()
+{
+  return write('\n');
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+  // no timeout on the host: everything that will arrive has arrived
+  size_t count = 0;
+  int value;
+  while ((count < length) && ((value = read()) >= 0))
+  {
+    buffer[count++] = value;
+  }
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length)
+{
+  size_t count = 0;
+  int value;
+  while ((count < length) && ((value = read()) >= 0) && (value != terminator))
+  {
+    buffer[count++] = value;
+  }
+  return count;
+}
+
+// ============================================================================================================================
+// UARTs
+//
+// Serial:  console; output goes to stdout if enabled, input comes from mockSerialInput()
+// Serial2: Nextion display; like the ESP32 core 1.0.x there is no transmit buffer in RAM: write() waits
+//          while the 128 byte hardware FIFO is full, which drains at baud / 10 bytes per second.
+//          The commands are answered like the display does: "get <variable>" with the value set by
+//          mockNextionValue() (0x71 frame, 4 bytes like the Nextion simulator), else "invalid variable".
+
+constexpr size_t uartFifoSize = 128;
+constexpr int uartCount = 3;
+
+struct Uart
+{
+  unsigned long baud = 115200;
+  std::deque<uint8_t> input;
+  double fifoLevel = 0.0;
+  unsigned long fifoTime = 0;       // microseconds
+  std::string command;
+  uint32_t ffCount = 0;
+  MockUartStatistics statistics = {};
+};
+
+static Uart uarts[uartCount];
+static std::map<std::string, int32_t> nextionValues;
+
+static bool serialOutput = getenv("RADIO_TEST_VERBOSE") != NULL;
+
+void mockSetSerialOutput(bool isEnabled)
+{
+  serialOutput = isEnabled;
+}
+
+void mockSerialInput(const char* text)
+{
+  while (*text)
+  {
+    uarts[0].input.push_back(*text++);
+  }
+}
+
+MockUartStatistics mockUartStatistics(int uartNumber)
+{
+  return uarts[uartNumber].statistics;
+}
+
+void mockNextionValue(const char* name, int32_t value)
+{
+  nextionValues[name] = value;
+}
+
+static void answerNextion(Uart& uart, const std::string& command)
+{
+  if (command.compare(0, 4, "get ") != 0)
+  {
+    return;
+  }
+  auto value = nextionValues.find(command.substr(4));
+  if (value == nextionValues.end())
+  {
+    // invalid variable name or invalid attribute
+    uart.input.insert(uart.input.end(), {0x1A, 0xFF, 0xFF, 0xFF});
+    return;
+  }
+  uint32_t number = value->second;
+  uart.input.insert(uart.input.end(), {0x71, (uint8_t)number, (uint8_t)(number >> 8), (uint8_t)(number >> 16), (uint8_t)(number >> 24),
+                                       0xFF, 0xFF, 0xFF});
+}
+
+static void receiveNextion(Uart& uart, uint8_t value)
+{
+  if (value != 0xFF)
+  {
+    uart.command.append(uart.ffCount, (char)0xFF);
+    uart.ffCount = 0;
+    uart.command += (char)value;
+    return;
+  }
+  if (++uart.ffCount == 3)
+  {
+    answerNextion(uart, uart.command);
+    uart.command.clear();
+    uart.ffCount = 0;
+  }
+}
+
+static void drainFifo(Uart& uart)
+{
+  unsigned long currentTime = micros();
+  uart.fifoLevel = max(0.0, uart.fifoLevel - (currentTime - uart.fifoTime) * (uart.baud / 10.0) / 1000000.0);
+  uart.fifoTime = currentTime;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin)
+{
+  uarts[uartNumber].baud = baud;
+  uarts[uartNumber].fifoTime = micros();
+}
+
+int HardwareSerial::available()
+{
+  return uarts[uartNumber].input.size();
+}
+
+int HardwareSerial::read()
+{
+  Uart& uart = uarts[uartNumber];
+  if (uart.input.empty())
+  {
+    return -1;
+  }
+  uint8_t value = uart.input.front();
+  uart.input.pop_front();
+  uart.statistics.bytesRead++;
+  return value;
+}
+
+int HardwareSerial::peek()
+{
+  return uarts[uartNumber].input.empty() ? -1 : uarts[uartNumber].input.front();
+}
+
+size_t HardwareSerial::write(uint8_t value)
+{
+  return write(&value, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+  Uart& uart = uarts[uartNumber];
+  uart.statistics.writeCalls++;
+  uart.statistics.bytesWritten += size;
+  if (uartNumber == 0)
+  {
+    if (serialOutput)
+    {
+      fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+  }
+
+  unsigned long blockedTime = 0;
+  for (size_t count = 0; count < size; count++)
+  {
+    drainFifo(uart);
+    if (uart.fifoLevel + 1.0 > uartFifoSize)
+    {
+      unsigned long waitTime = ceil((uart.fifoLevel + 1.0 - uartFifoSize) * 10000.0 / uart.baud);
+      delay(waitTime);
+      blockedTime += waitTime;
+      drainFifo(uart);
+    }
+    uart.fifoLevel += 1.0;
+    if (uartNumber == 2)
+    {
+      receiveNextion(uart, buffer[count]);
+    }
+  }
+  uart.statistics.blockedTime += blockedTime;
+  uart.statistics.maxBlockedTime = max(uart.statistics.maxBlockedTime, blockedTime);
+  return size;
+}
+
+// ============================================================================================================================
+// GPIO
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+int digitalRead(uint8_t pin)
+{
+  return HIGH;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}
+
+// ============================================================================================================================
+// heap: every operator new of the process is counted - the sketch allocates nothing with malloc()
+// Free heap at the start of setup() of an ESP32 with WiFi started, roughly. The sizes are those of
+// the host (64 bit pointers), so the figures are an upper bound of the ESP32 usage.
+
+constexpr size_t mockHeapSize = 240000;
+constexpr size_t allocationHeaderSize = 16;
+
+static std::atomic<size_t> heapUsed(0);
+static std::atomic<size_t> heapPeak(0);
+static thread_local int untrackedDepth = 0;
+
+MockHeapUntracked::MockHeapUntracked()
+{
+  untrackedDepth++;
+}
+
+MockHeapUntracked::~MockHeapUntracked()
+{
+  untrackedDepth--;
+}
+
+size_t mockHeapUsed()
+{
+  return heapUsed;
+}
+
+size_t mockHeapPeak()
+{
+  return heapPeak;
+}
+
+static void* allocate(size_t size)
+{
+  uint8_t* block = (uint8_t*)malloc(size + allocationHeaderSize);
+  if (block == NULL)
+  {
+    return NULL;
+  }
+  // size and "tracked" flag in front of the block
+  size_t* header = (size_t*)block;
+  header[0] = size;
+  header[1] = untrackedDepth == 0;
+  if (header[1])
+  {
+    size_t used = heapUsed += size;
+    size_t peak = heapPeak;
+    while ((used > peak) && !heapPeak.compare_exchange_weak(peak, used))
+    {
+    }
+  }
+  return block + allocationHeaderSize;
+}
+
+void* operator new(size_t size)
+{
+  void* block = allocate(size);
+  if (block == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return block;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+  return allocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+  if (pointer == NULL)
+  {
+    return;
+  }
+  size_t* header = (size_t*)((uint8_t*)pointer - allocationHeaderSize);
+  if (header[1])
+  {
+    heapUsed -= header[0];
+  }
+  free(header);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+  operator delete(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+  operator delete(pointer);
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+  return mockHeapSize > heapUsed ? mockHeapSize - heapUsed : 0;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+  return mockHeapSize > heapPeak ? mockHeapSize - heapPeak : 0;
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+  return getFreeHeap();
+}
+
+uint32_t EspClass::getCpuFreqMHz()
+{
+  return 240;
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  return micros() * getCpuFreqMHz();
+}
+
+void EspClass::restart()
+{
+  printf("ESP.restart()\n");
+  fflush(stdout);
+  _exit(0);
+}
+
+// ============================================================================================================================
+// NVS
+
+static std::map<std::string, int32_t> nvs;
+
+bool Preferences::begin(const char* name, bool readOnly)
+{
+  space = name;
+  isOpen = true;
+  isReadOnly = readOnly;
+  return true;
+}
+
+void Preferences::end()
+{
+  isOpen = false;
+}
+
+int32_t Preferences::getInt(const char* key, int32_t defaultValue)
+{
+  auto value = nvs.find(space + "/" + key);
+  return (!isOpen || (value == nvs.end())) ? defaultValue : value->second;
+}
+
+size_t Preferences::putInt(const char* key, int32_t value)
+{
+  if (!isOpen || isReadOnly)
+  {
+    return 0;
+  }
+  nvs[space + "/" + key] = value;
+  return sizeof(value);
+}
+
+bool Preferences::remove(const char* key)
+{
+  return isOpen && !isReadOnly && nvs.erase(space + "/" + key);
+}
+
+bool Preferences::clear()
+{
+  if (!isOpen || isReadOnly)
+  {
+    return false;
+  }
+  for (auto entry = nvs.begin(); entry != nvs.end();)
+  {
+    entry = (entry->first.compare(0, space.size() + 1, space + "/") == 0) ? nvs.erase(entry) : std::next(entry);
+  }
+  return true;
+}
+
+// ============================================================================================================================
+// file system: one directory per test process below the system temp directory, removed at exit
+
+constexpr size_t fileSystemSize = 0x160000;     // LittleFS partition of the default partition table
+
+static std::string fileSystemRoot;
+static size_t fileSystemUsed;
+
+static int removeEntry(const char* path, const struct stat* status, int type, struct FTW* position)
+{
+  return ::remove(path);
+}
+
+static void removeFileSystem()
+{
+  nftw(fileSystemRoot.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+const char* mockFileSystemRoot()
+{
+  if (fileSystemRoot.empty())
+  {
+    MockHeapUntracked untracked;
+    const char* temp = getenv("TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/radio-test-XXXXXX", temp ? temp : "/tmp");
+    if (mkdtemp(path) == NULL)
+    {
+      perror("mkdtemp");
+      exit(1);
+    }
+    fileSystemRoot = path;
+    atexit(removeFileSystem);
+  }
+  return fileSystemRoot.c_str();
+}
+
+static std::string hostPath(const char* path)
+{
+  MockHeapUntracked untracked;
+  return std::string(mockFileSystemRoot()) + path;
+}
+
+static int addEntrySize(const char* path, const struct stat* status, int type, struct FTW* position)
+{
+  if (type == FTW_F)
+  {
+    fileSystemUsed += status->st_size;
+  }
+  return 0;
+}
+
+size_t LITTLEFSFS::totalBytes()
+{
+  return fileSystemSize;
+}
+
+size_t LITTLEFSFS::usedBytes()
+{
+  fileSystemUsed = 0;
+  nftw(mockFileSystemRoot(), addEntrySize, 16, FTW_PHYS);
+  return fileSystemUsed;
+}
+
+File::Handle::~Handle()
+{
+  if (file)
+  {
+    fclose(file);
+  }
+  if (directory)
+  {
+    closedir(directory);
+  }
+}
+
+File::File(const char* path, const char* mode)
+{
+  // the handle stands for the file descriptor of the ESP32 VFS (a few hundred bytes there too)
+  struct stat status;
+  std::shared_ptr<Handle> opened = std::make_shared<Handle>();
+  opened->path = path;
+  if ((mode[0] == 'r') && (stat(hostPath(path).c_str(), &status) == 0) && S_ISDIR(status.st_mode))
+  {
+    opened->directory = opendir(hostPath(path).c_str());
+  }
+  else
+  {
+    opened->file = fopen(hostPath(path).c_str(), mode[0] == 'w' ? "wb" : (mode[0] == 'a' ? "ab" : "rb"));
+  }
+  if (opened->file || opened->directory)
+  {
+    handle = opened;
+  }
+}
+
+File::operator bool() const
+{
+  return handle && (handle->file || handle->directory);
+}
+
+bool File::isDirectory()
+{
+  return handle && handle->directory;
+}
+
+const char* File::name()
+{
+  return handle ? handle->path.c_str() : "";
+}
+
+size_t File::size()
+{
+  struct stat status;
+  if (!handle)
+  {
+    return 0;
+  }
+  if (handle->file)
+  {
+    fflush(handle->file);
+  }
+  return (stat(hostPath(handle->path.c_str()).c_str(), &status) == 0) ? status.st_size : 0;
+}
+
+size_t File::position()
+{
+  return (handle && handle->file) ? ftell(handle->file) : 0;
+}
+
+int File::available()
+{
+  return (handle && handle->file) ? size() - position() : 0;
+}
+
+int File::read()
+{
+  return (handle && handle->file) ? fgetc(handle->file) : -1;
+}
+
+int File::peek()
+{
+  if (!handle || !handle->file)
+  {
+    return -1;
+  }
+  int value = fgetc(handle->file);
+  if (value >= 0)
+  {
+    ungetc(value, handle->file);
+  }
+  return value;
+}
+
+size_t File::read(uint8_t* buffer, size_t size)
+{
+  return (handle && handle->file) ? fread(buffer, 1, size, handle->file) : 0;
+}
+
+size_t File::write(uint8_t value)
+{
+  return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size)
+{
+  return (handle && handle->file) ? fwrite(buffer, 1, size, handle->file) : 0;
+}
+
+bool File::seek(uint32_t position)
+{
+  return handle && handle->file && (fseek(handle->file, position, SEEK_SET) == 0);
+}
+
+File File::openNextFile()
+{
+  if (!handle || !handle->directory)
+  {
+    return File();
+  }
+  struct dirent* entry;
+  while ((entry = readdir(handle->directory)) != NULL)
+  {
+    if (entry->d_name[0] != '.')
+    {
+      std::string path = handle->path;
+      if (path.empty() || (path.back() != '/'))
+      {
+        path += "/";
+      }
+      return File((path + entry->d_name).c_str(), "r");
+    }
+  }
+  return File();
+}
+
+void File::close()
+{
+  // closes the file for all copies
+  if (handle && handle->file)
+  {
+    fclose(handle->file);
+    handle->file = NULL;
+  }
+  if (handle && handle->directory)
+  {
+    closedir(handle->directory);
+    handle->directory = NULL;
+  }
+  handle.reset();
+}
+
+File fs::FS::open(const char* path, const char* mode)
+{
+  return File(path, mode);
+}
+
+bool fs::FS::exists(const char* path)
+{
+  struct stat status;
+  return stat(hostPath(path).c_str(), &status) == 0;
+}
+
+bool fs::FS::remove(const char* path)
+{
+  return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool fs::FS::rename(const char* from, const char* to)
+{
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool fs::FS::mkdir(const char* path)
+{
+  return ::mkdir(hostPath(path).c_str(), 0777) == 0;
+}
@@ -0,0 +1,390 @@
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <SPI.h>
+#include <ArduinoOTA.h>
+#include <map>
+#include <vector>
+
+WiFiClass WiFi;
+SPIClass SPI;
+ArduinoOTAClass ArduinoOTA;
+
+// simulated network times (milliseconds) - typical values of a home network, not measured
+constexpr unsigned long wifiConnectTime = 1500;
+constexpr unsigned long dnsLookupTime = 40;
+constexpr unsigned long dnsEntryTime = 300000;    // TTL of the answers
+constexpr size_t dnsTableSize = 4;                // DNS_TABLE_SIZE of lwIP
+constexpr unsigned long tcpConnectTime = 40;
+constexpr unsigned long tlsHandshakeTime = 900;   // mbedTLS on the ESP32 (RSA 2048)
+constexpr unsigned long serverTime = 80;
+constexpr uint32_t transferRate = 200;            // bytes per millisecond
+
+struct AirNetwork
+{
+  std::string ssid;
+  int32_t rssi;
+};
+
+struct DnsEntry
+{
+  std::string host;
+  unsigned long time;
+};
+
+static std::vector<AirNetwork> airNetworks;
+static std::string connectingSsid;
+static unsigned long connectStartTime;
+static bool isWiFiStarted = false;
+static DnsEntry dnsTable[dnsTableSize];
+static std::map<std::string, MockHttpResponse> responses;     // key: URL without scheme
+
+static std::string withoutScheme(const char* url)
+{
+  const char* start = strstr(url, "://");
+  return start ? start + 3 : url;
+}
+
+static std::string hostOf(const char* url)
+{
+  std::string rest = withoutScheme(url);
+  return rest.substr(0, rest.find_first_of(":/?#"));
+}
+
+// ============================================================================================================================
+// IPAddress
+
+bool IPAddress::fromString(const char* text)
+{
+  unsigned int parts[4];
+  char end;
+  if (sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &end) != 4)
+  {
+    return false;
+  }
+  for (int count = 0; count < 4; count++)
+  {
+    if (parts[count] > 255)
+    {
+      return false;
+    }
+    address[count] = parts[count];
+  }
+  return true;
+}
+
+String IPAddress::toString() const
+{
+  char text[16];
+  snprintf(text, sizeof(text), "%u.%u.%u.%u", address[0], address[1], address[2], address[3]);
+  return String(text);
+}
+
+size_t IPAddress::printTo(Print& output) const
+{
+  return output.print(toString());
+}
+
+// ============================================================================================================================
+// WiFi
+
+void mockWiFiNetwork(const char* ssid, int32_t rssi)
+{
+  MockHeapUntracked untracked;
+  airNetworks.push_back({ssid, rssi});
+}
+
+int WiFiClass::status()
+{
+  return (isWiFiStarted && (millis() - connectStartTime >= wifiConnectTime)) ? WL_CONNECTED : WL_DISCONNECTED;
+}
+
+bool WiFiClass::mode(int mode)
+{
+  return true;
+}
+
+void WiFiClass::begin(const char* ssid, const char* password)
+{
+  isWiFiStarted = false;
+  for (const AirNetwork& network : airNetworks)
+  {
+    if (network.ssid == ssid)
+    {
+      isWiFiStarted = true;
+      connectStartTime = millis();
+    }
+  }
+}
+
+bool WiFiClass::disconnect()
+{
+  isWiFiStarted = false;
+  return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 42) : IPAddress();
+}
+
+int16_t WiFiClass::scanNetworks()
+{
+  // sorted by signal strength like the scan result
+  std::stable_sort(airNetworks.begin(), airNetworks.end(), [](const AirNetwork & left, const AirNetwork & right)
+  {
+    return left.rssi > right.rssi;
+  });
+  delay(2000);
+  return airNetworks.size();
+}
+
+String WiFiClass::SSID(uint8_t index)
+{
+  return index < airNetworks.size() ? String(airNetworks[index].ssid) : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t index)
+{
+  return index < airNetworks.size() ? airNetworks[index].rssi : 0;
+}
+
+String WiFiClass::BSSIDstr(uint8_t index)
+{
+  char text[18];
+  snprintf(text, sizeof(text), "02:00:00:00:00:%02X", index);
+  return String(text);
+}
+
+bool mockLookupHost(const char* host, unsigned long* lookupTime)
+{
+  IPAddress numeric;
+  *lookupTime = 0;
+  if (numeric.fromString(host))
+  {
+    return true;
+  }
+  bool isKnown = false;
+  for (const auto& response : responses)
+  {
+    isKnown = isKnown || (hostOf(response.first.c_str()) == host);
+  }
+
+  // lwIP table: answered at once while the entry is valid, else the oldest entry is replaced
+  DnsEntry* oldest = &dnsTable[0];
+  for (DnsEntry& entry : dnsTable)
+  {
+    if ((entry.host == host) && (millis() - entry.time < dnsEntryTime))
+    {
+      return true;
+    }
+    if (entry.time < oldest->time)
+    {
+      oldest = &entry;
+    }
+  }
+  delay(dnsLookupTime);
+  *lookupTime = dnsLookupTime;
+  if (isKnown)
+  {
+    MockHeapUntracked untracked;
+    oldest->host = host;
+    oldest->time = millis();
+  }
+  return isKnown;
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& address)
+{
+  unsigned long lookupTime;
+  if ((status() != WL_CONNECTED) || !mockLookupHost(host, &lookupTime))
+  {
+    return 0;
+  }
+  address = IPAddress(10, 0, 0, 1 + strlen(host) % 250);
+  return 1;
+}
+
+// ============================================================================================================================
+// clients
+
+int WiFiClient::connect(const char* host, uint16_t port)
+{
+  unsigned long lookupTime;
+  stop();
+  if ((WiFi.status() != WL_CONNECTED) || !mockLookupHost(host, &lookupTime))
+  {
+    return 0;
+  }
+  delay(tcpConnectTime);
+  isConnected = true;
+  return 1;
+}
+
+int WiFiClientSecure::connect(const char* host, uint16_t port)
+{
+  if (!WiFiClient::connect(host, port))
+  {
+    return 0;
+  }
+  delay(tlsHandshakeTime);
+  return 1;
+}
+
+uint8_t WiFiClient::connected()
+{
+  return isConnected;
+}
+
+void WiFiClient::stop()
+{
+  isConnected = false;
+  received.clear();
+  receivedPosition = 0;
+}
+
+int WiFiClient::available()
+{
+  return received.size() - receivedPosition;
+}
+
+int WiFiClient::read()
+{
+  return receivedPosition < received.size() ? (uint8_t)received[receivedPosition++] : -1;
+}
+
+int WiFiClient::peek()
+{
+  return receivedPosition < received.size() ? (uint8_t)received[receivedPosition] : -1;
+}
+
+size_t WiFiClient::write(uint8_t value)
+{
+  return isConnected ? 1 : 0;
+}
+
+void WiFiClient::mockReceive(const std::string& data)
+{
+  received = data;
+  receivedPosition = 0;
+}
+
+// ============================================================================================================================
+// HTTP
+
+void mockHttpResponse(const char* url, int code, const char* contentType, const std::string& body, const char* location)
+{
+  MockHeapUntracked untracked;
+  responses[withoutScheme(url)] = {code, contentType, location, body};
+}
+
+const MockHttpResponse* mockHttpRequest(const char* url)
+{
+  static const MockHttpResponse notFound = {404, "text/html", "", ""};
+  std::string key = withoutScheme(url);
+  const MockHttpResponse* found = NULL;
+  size_t foundLength = 0;
+  for (const auto& response : responses)
+  {
+    if ((key.compare(0, response.first.size(), response.first) == 0) && (response.first.size() >= foundLength))
+    {
+      found = &response.second;
+      foundLength = response.first.size();
+    }
+  }
+  if (found == NULL)
+  {
+    found = &notFound;
+  }
+  delay(serverTime + found->body.size() / transferRate);
+  return found;
+}
+
+bool mockHttpConnect(const char* url)
+{
+  std::string host = hostOf(url);
+  WiFiClientSecure secureClient;
+  WiFiClient plainClient;
+  return (strncmp(url, "https://", 8) == 0) ? secureClient.connect(host.c_str(), 443) : plainClient.connect(host.c_str(), 80);
+}
+
+bool HTTPClient::begin(const char* newUrl)
+{
+  plainClient.stop();
+  client = &plainClient;
+  url = newUrl;
+  return (strncmp(newUrl, "http://", 7) == 0) || (strncmp(newUrl, "https://", 8) == 0);
+}
+
+bool HTTPClient::begin(WiFiClient& newClient, const char* newUrl)
+{
+  client = &newClient;
+  url = newUrl;
+  return true;
+}
+
+int HTTPClient::GET()
+{
+  if (client == NULL)
+  {
+    return HTTPC_ERROR_NOT_CONNECTED;
+  }
+  if (!client->connected() && !mockHttpConnect(url.c_str()))
+  {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  response = mockHttpRequest(url.c_str());
+  client->mockReceive(response->body);
+  return response->code;
+}
+
+void HTTPClient::end()
+{
+  if (client && (!isReuse || (client == &plainClient)))
+  {
+    client->stop();
+  }
+  response = NULL;
+}
+
+int HTTPClient::getSize()
+{
+  return response ? (int)response->body.size() : -1;
+}
+
+String HTTPClient::getString()
+{
+  return response ? String(response->body) : String();
+}
+
+String HTTPClient::header(const char* name)
+{
+  if (response == NULL)
+  {
+    return String();
+  }
+  if (strcmp(name, "Location") == 0)
+  {
+    return String(response->location);
+  }
+  if (strcmp(name, "Content-Type") == 0)
+  {
+    return String(response->contentType);
+  }
+  return String();
+}
+
+WiFiClient& HTTPClient::getStream()
+{
+  return client ? *client : plainClient;
+}
+
+WiFiClient* HTTPClient::getStreamPtr()
+{
+  return client;
+}
+
+int HTTPClient::writeToStream(Stream* stream)
+{
+  return response ? stream->write((const uint8_t*)response->body.data(), response->body.size()) : HTTPC_ERROR_NOT_CONNECTED;
+}
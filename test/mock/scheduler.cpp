@@ -0,0 +1,416 @@
+#include <Arduino.h>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/*
+   Simulated time and FreeRTOS stand-ins
+
+   The tasks of the sketch are host threads, but like on a single core only one of them runs at a time.
+   A task switch happens only when the running task waits: delay(), vTaskDelay(), ulTaskNotifyTake(),
+   a queue or a taken mutex. The next task is the ready one with the highest priority (round robin
+   between equal priorities). When no task is ready, the clock jumps to the earliest timeout.
+
+   So the simulated time does not include any computing time: it measures waiting - lock contention,
+   network and UART waits - and it is the same for every run. loop() itself is the task of the thread
+   calling mockStartScheduler(), it must give the other tasks their turn with delay().
+
+   Without mockStartScheduler() (unit tests) tasks are not created, the sketch uses its synchronous
+   paths, and waits only move the clock.
+*/
+
+struct MockTask
+{
+  std::string name;
+  UBaseType_t priority;
+  std::condition_variable resume;
+  std::function<bool()> condition;      // waiting for; empty: only for the time
+  unsigned long wakeTime = 0;           // ULONG_MAX: no timeout
+  bool isDeleted = false;
+  uint32_t notifyCount = 0;
+};
+
+struct MockSemaphore
+{
+  MockTask* owner = NULL;
+  uint32_t depth = 0;
+};
+
+struct MockQueue
+{
+  UBaseType_t length;
+  UBaseType_t itemSize;
+  uint8_t* storage;                     // only allocated: the items are kept in the untracked deque
+  std::deque<std::vector<uint8_t>> items;
+};
+
+static unsigned long mockMillis = 1000;
+static bool isSchedulerRunning = false;
+static std::vector<MockTask*> tasks;
+static MockTask* runningTask = NULL;
+static thread_local MockTask* thisTask = NULL;
+
+static std::mutex& schedulerMutex()
+{
+  // never destroyed: the task threads still wait on it when the process exits
+  static std::mutex* mutex = new std::mutex;
+  return *mutex;
+}
+
+static MockTask* currentTask()
+{
+  if (thisTask == NULL)
+  {
+    // thread of main(): the loop task
+    MockHeapUntracked untracked;
+    thisTask = new MockTask;
+    thisTask->name = "loopTask";
+    thisTask->priority = 1;
+    tasks.push_back(thisTask);
+    runningTask = thisTask;
+  }
+  return thisTask;
+}
+
+static bool isReady(MockTask* task)
+{
+  return !task->isDeleted && ((task->condition && task->condition()) || (mockMillis >= task->wakeTime));
+}
+
+static MockTask* nextReadyTask(MockTask* self)
+{
+  // highest priority first; the tasks after the calling one first (round robin)
+  size_t selfIndex = std::find(tasks.begin(), tasks.end(), self) - tasks.begin();
+  MockTask* next = NULL;
+  for (size_t count = 1; count <= tasks.size(); count++)
+  {
+    MockTask* task = tasks[(selfIndex + count) % tasks.size()];
+    if (isReady(task) && ((next == NULL) || (task->priority > next->priority)))
+    {
+      next = task;
+    }
+  }
+  return next;
+}
+
+static void switchTask(std::unique_lock<std::mutex>& lock)
+{
+  // called by the running task after setting what it waits for
+  MockTask* self = currentTask();
+  MockTask* next;
+  while ((next = nextReadyTask(self)) == NULL)
+  {
+    unsigned long wakeTime = ULONG_MAX;
+    for (MockTask* task : tasks)
+    {
+      if (!task->isDeleted)
+      {
+        wakeTime = min(wakeTime, task->wakeTime);
+      }
+    }
+    if (wakeTime == ULONG_MAX)
+    {
+      fprintf(stderr, "SCHEDULER: all tasks wait forever (deadlock) at %lu ms\n", mockMillis);
+      fflush(stdout);
+      _exit(3);
+    }
+    mockMillis = wakeTime;
+  }
+  if (next != self)
+  {
+    runningTask = next;
+    next->resume.notify_one();
+    self->resume.wait(lock, [self] { return runningTask == self; });
+  }
+}
+
+static bool waitFor(std::function<bool()> condition, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> lock(schedulerMutex());
+  MockTask* self = currentTask();
+  if (condition && condition())
+  {
+    return true;
+  }
+  if (condition && (ticks == 0))
+  {
+    return false;
+  }
+  {
+    MockHeapUntracked untracked;
+    self->condition = condition;
+  }
+  self->wakeTime = (ticks == portMAX_DELAY) ? ULONG_MAX : mockMillis + ticks;
+  switchTask(lock);
+  bool isMet = !condition || condition();
+  self->condition = nullptr;
+  return isMet;
+}
+
+void mockStartScheduler()
+{
+  std::lock_guard<std::mutex> lock(schedulerMutex());
+  currentTask();
+  isSchedulerRunning = true;
+}
+
+// ============================================================================================================================
+// time
+
+unsigned long millis()
+{
+  return mockMillis;
+}
+
+unsigned long micros()
+{
+  return mockMillis * 1000;
+}
+
+void delay(unsigned long ms)
+{
+  waitFor(nullptr, ms);
+}
+
+void delayMicroseconds(uint32_t us) {}
+
+void mockAdvanceMillis(unsigned long ms)
+{
+  delay(ms);
+}
+
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2, const char* server3) {}
+
+// ============================================================================================================================
+// tasks
+
+BaseType_t xTaskCreatePinnedToCore(void (*function)(void*), const char* name, uint32_t stackSize, void* parameters,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core)
+{
+  std::lock_guard<std::mutex> lock(schedulerMutex());
+  if (!isSchedulerRunning)
+  {
+    // tasks would run forever: the tested code falls back to its synchronous path
+    return pdFALSE;
+  }
+  MockTask* task;
+  {
+    MockHeapUntracked untracked;
+    task = new MockTask;
+    task->name = name;
+    task->priority = priority;
+    task->wakeTime = mockMillis;
+    tasks.push_back(task);
+    // starts when the creating task waits the next time
+    std::thread([task, function, parameters]
+    {
+      {
+        std::unique_lock<std::mutex> lock(schedulerMutex());
+        thisTask = task;
+        task->resume.wait(lock, [task] { return runningTask == task; });
+      }
+      function(parameters);
+      vTaskDelete(NULL);
+    }).detach();
+  }
+  if (handle)
+  {
+    *handle = task;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(void (*function)(void*), const char* name, uint32_t stackSize, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* handle)
+{
+  return xTaskCreatePinnedToCore(function, name, stackSize, parameters, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+  std::unique_lock<std::mutex> lock(schedulerMutex());
+  MockTask* task = handle ? (MockTask*)handle : currentTask();
+  task->isDeleted = true;
+  if (task == currentTask())
+  {
+    // never returns: the thread waits until the process exits
+    switchTask(lock);
+  }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  waitFor(nullptr, ticks);
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return mockMillis;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+  return 0;
+}
+
+BaseType_t xPortGetCoreID()
+{
+  return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+  std::lock_guard<std::mutex> lock(schedulerMutex());
+  ((MockTask*)handle)->notifyCount++;
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait)
+{
+  MockTask* self;
+  {
+    std::lock_guard<std::mutex> lock(schedulerMutex());
+    self = currentTask();
+  }
+  if (!waitFor([self] { return self->notifyCount > 0; }, wait))
+  {
+    return 0;
+  }
+  std::lock_guard<std::mutex> lock(schedulerMutex());
+  uint32_t value = self->notifyCount;
+  self->notifyCount = clear ? 0 : value - 1;
+  return value;
+}
+
+// ============================================================================================================================
+// mutexes: a recursive mutex may be taken again by its owner
+
+static SemaphoreHandle_t createMutex()
+{
+  MockHeapUntracked untracked;
+  return new MockSemaphore;
+}
+
+static BaseType_t takeMutex(SemaphoreHandle_t handle, TickType_t wait, bool isRecursive)
+{
+  MockSemaphore* semaphore = (MockSemaphore*)handle;
+  MockTask* self;
+  {
+    std::lock_guard<std::mutex> lock(schedulerMutex());
+    self = currentTask();
+  }
+  if (!waitFor([semaphore, self, isRecursive] { return (semaphore->owner == NULL) || (isRecursive && (semaphore->owner == self)); }, wait))
+  {
+    return pdFALSE;
+  }
+  semaphore->owner = self;
+  semaphore->depth++;
+  return pdTRUE;
+}
+
+static BaseType_t giveMutex(SemaphoreHandle_t handle)
+{
+  MockSemaphore* semaphore = (MockSemaphore*)handle;
+  std::lock_guard<std::mutex> lock(schedulerMutex());
+  if ((semaphore->owner != currentTask()) || (semaphore->depth == 0))
+  {
+    return pdFALSE;
+  }
+  if (--semaphore->depth == 0)
+  {
+    semaphore->owner = NULL;
+  }
+  return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  return createMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+  return createMutex();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+  return takeMutex(semaphore, wait, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+  return giveMutex(semaphore);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+  return takeMutex(semaphore, wait, true);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+  return giveMutex(semaphore);
+}
+
+// ============================================================================================================================
+// queues (the storage is allocated like by FreeRTOS: length * item size)
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  MockQueue* queue = new MockQueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  queue->storage = new uint8_t[length * itemSize];
+  return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t wait)
+{
+  MockQueue* queue = (MockQueue*)handle;
+  if (!waitFor([queue] { return queue->items.size() < queue->length; }, wait))
+  {
+    return pdFALSE;
+  }
+  MockHeapUntracked untracked;
+  queue->items.emplace_back((const uint8_t*)item, (const uint8_t*)item + queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t handle, const void* item)
+{
+  // for queues of length 1 (FreeRTOS): the newest item replaces all waiting ones
+  MockQueue* queue = (MockQueue*)handle;
+  MockHeapUntracked untracked;
+  queue->items.clear();
+  queue->items.emplace_back((const uint8_t*)item, (const uint8_t*)item + queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t wait)
+{
+  MockQueue* queue = (MockQueue*)handle;
+  if (!waitFor([queue] { return !queue->items.empty(); }, wait))
+  {
+    return pdFALSE;
+  }
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t handle)
+{
+  ((MockQueue*)handle)->items.clear();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+  return ((MockQueue*)handle)->items.size();
+}
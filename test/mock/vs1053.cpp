@@ -0,0 +1,181 @@
+#include <vs1053_ext.h>
+#include <HTTPClient.h>
+
+constexpr uint32_t inputBufferSize = 1600 * 5;     // RAM input buffer of vs1053_ext
+constexpr uint32_t streamBitRate = 128;            // kbit/s of every stream and file
+constexpr uint32_t speechBitRate = 32;             // kbit/s of the TTS service
+constexpr uint32_t networkRateFactor = 2;          // a stream arrives that much faster than it is played
+constexpr uint32_t maxRedirects = 3;
+
+void VS1053::begin()
+{
+  inputBuffer = new uint8_t[inputBufferSize];
+}
+
+void VS1053::setVolume(uint8_t newVolume)
+{
+  volume = newVolume;
+}
+
+uint8_t VS1053::getVolume()
+{
+  return volume;
+}
+
+void VS1053::start(Source newSource, uint32_t size, uint32_t rate)
+{
+  source = newSource;
+  filled = 0;
+  remaining = size;
+  bytesPerSecond = rate;
+  lastLoopTime = millis();
+  isTitleSent = false;
+}
+
+bool VS1053::connecttohost(const char* url)
+{
+  stop_mp3client();
+  std::string current = url;
+  for (uint32_t step = 0; step <= maxRedirects; step++)
+  {
+    if (!mockHttpConnect(current.c_str()))
+    {
+      return false;
+    }
+    const MockHttpResponse* response = mockHttpRequest(current.c_str());
+    if (response == NULL)
+    {
+      return false;
+    }
+    if ((response->code >= 300) && (response->code < 400))
+    {
+      current = response->location;
+      continue;
+    }
+    if (response->code != HTTP_CODE_OK)
+    {
+      return false;
+    }
+    bool isPlaylist = (response->contentType.find("mpegurl") != std::string::npos) || (response->contentType.find("scpls") != std::string::npos);
+    if (isPlaylist)
+    {
+      // first entry of the playlist
+      size_t start = response->body.find("http");
+      if (start == std::string::npos)
+      {
+        return false;
+      }
+      current = response->body.substr(start, response->body.find_first_of("\r\n", start) - start);
+      continue;
+    }
+    // audio: the library reports the URL it finally connected to
+    if (vs1053_lasthost)
+    {
+      vs1053_lasthost(current.c_str());
+    }
+    title = response->body;
+    start(Source::STREAM, 0, streamBitRate * 125);
+    return true;
+  }
+  return false;
+}
+
+bool VS1053::connecttoFS(fs::FS& fs, const char* path)
+{
+  stop_mp3client();
+  File file = fs.open(path);
+  if (!file || file.isDirectory())
+  {
+    return false;
+  }
+  eofInfo = path;
+  start(Source::FILE, file.size(), streamBitRate * 125);
+  file.close();
+  return true;
+}
+
+bool VS1053::connecttospeech(const char* text, const char* language)
+{
+  stop_mp3client();
+  std::string url = std::string("https://translate.google.com/translate_tts?tl=") + language + "&q=" + text;
+  if (!mockHttpConnect(url.c_str()))
+  {
+    return false;
+  }
+  const MockHttpResponse* response = mockHttpRequest(url.c_str());
+  if ((response == NULL) || (response->code != HTTP_CODE_OK))
+  {
+    return false;
+  }
+  eofInfo = text;
+  start(Source::SPEECH, response->body.size(), speechBitRate * 125);
+  return true;
+}
+
+void VS1053::stop_mp3client()
+{
+  source = Source::NONE;
+  filled = 0;
+  remaining = 0;
+}
+
+void VS1053::loop()
+{
+  if (source == Source::NONE)
+  {
+    return;
+  }
+  unsigned long currentTime = millis();
+  uint32_t elapsed = currentTime - lastLoopTime;
+  lastLoopTime = currentTime;
+
+  // decoder plays what is there, then the buffer is refilled
+  uint32_t played = bytesPerSecond * elapsed / 1000;
+  filled -= min(filled, played);
+  uint32_t arriving = (source == Source::STREAM) ? networkRateFactor * played : remaining;
+  uint32_t received = min(arriving, inputBufferSize - filled);
+  filled += received;
+  if (source != Source::STREAM)
+  {
+    remaining -= received;
+  }
+
+  if ((source == Source::STREAM) && (filled > 0) && !isTitleSent)
+  {
+    isTitleSent = true;
+    if (vs1053_bitrate)
+    {
+      vs1053_bitrate(std::to_string(streamBitRate).c_str());
+    }
+    if (vs1053_showstreamtitle)
+    {
+      vs1053_showstreamtitle(title.c_str());
+    }
+  }
+  if ((source == Source::FILE) && (filled == 0) && (remaining == 0))
+  {
+    stop_mp3client();
+    if (vs1053_eof_mp3)
+    {
+      vs1053_eof_mp3(eofInfo.c_str());
+    }
+  }
+  if ((source == Source::SPEECH) && (filled == 0) && (remaining == 0))
+  {
+    stop_mp3client();
+    if (vs1053_eof_speech)
+    {
+      vs1053_eof_speech(eofInfo.c_str());
+    }
+  }
+}
+
+uint32_t VS1053::inBufferFilled()
+{
+  return filled;
+}
+
+uint32_t VS1053::inBufferFree()
+{
+  return inputBufferSize - filled;
+}
@@ -0,0 +1,56 @@
+#pragma once
+/*
+   Host stand-in for the VS1053 class of vs1053_ext
+
+   Streams, files and speech are "played" in simulated time by loop(): a stream fills the input buffer
+   faster than the decoder empties it, files and speech end after their size at their bit rate and
+   are reported by vs1053_eof_mp3()/vs1053_eof_speech() like by the library. connecttohost() follows
+   playlists and redirects of the responses registered with mockHttpResponse() (HTTPClient.h); the
+   body of the audio response is reported as stream title.
+*/
+#include <Arduino.h>
+#include <FS.h>
+
+extern __attribute__((weak)) void vs1053_info(const char* info);
+extern __attribute__((weak)) void vs1053_showstation(const char* info);
+extern __attribute__((weak)) void vs1053_showstreamtitle(const char* info);
+extern __attribute__((weak)) void vs1053_showstreaminfo(const char* info);
+extern __attribute__((weak)) void vs1053_eof_mp3(const char* info);
+extern __attribute__((weak)) void vs1053_bitrate(const char* info);
+extern __attribute__((weak)) void vs1053_commercial(const char* info);
+extern __attribute__((weak)) void vs1053_icyurl(const char* info);
+extern __attribute__((weak)) void vs1053_eof_speech(const char* info);
+extern __attribute__((weak)) void vs1053_lasthost(const char* info);
+
+class VS1053
+{
+  public:
+    VS1053(uint8_t csPin, uint8_t dcsPin, uint8_t dreqPin) {}
+    void begin();
+    void printVersion() {}
+    void setVolume(uint8_t volume);
+    uint8_t getVolume();
+    bool connecttohost(const char* url);
+    bool connecttoFS(fs::FS& fs, const char* path);
+    bool connecttospeech(const char* text, const char* language);
+    void stop_mp3client();
+    void loop();
+    uint32_t inBufferFilled();
+    uint32_t inBufferFree();
+
+  private:
+    enum class Source { NONE, STREAM, FILE, SPEECH };
+
+    void start(Source newSource, uint32_t size, uint32_t bytesPerSecond);
+
+    uint8_t* inputBuffer = NULL;
+    uint8_t volume = 0;
+    Source source = Source::NONE;
+    uint32_t filled = 0;
+    uint32_t remaining = 0;             // of a file or speech, still to be read into the buffer
+    uint32_t bytesPerSecond = 0;
+    unsigned long lastLoopTime = 0;
+    bool isTitleSent = false;
+    std::string title;
+    std::string eofInfo;
+};
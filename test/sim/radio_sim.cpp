@@ -0,0 +1,245 @@
+/*
+   Host simulation of the whole radio firmware
+
+     radio_sim <data directory> [<seconds>] [<event script>]
+
+   setup() and loop() of radio.ino run with all sources of the sketch against the stand-ins in mock/:
+   the FreeRTOS tasks (audio feed, standby, fuel, clock, display receive) are scheduled like on a
+   single core, Serial2 is connected to a Nextion stand-in, LITTLEFS is a temporary directory with
+   a copy of the data directory, the NVS is kept in memory, and WiFi, DNS, HTTP and the VS1053
+   answer from the table set up below:
+
+     network.json   every network is on air
+     stations.json  every station answers; playlists (.m3u, .pls) point to a stream, whose body is
+                    reported as stream title
+     tanken.json    the price server answers for all stations; the first station is below the
+                    diesel limit, so the alarm is announced (gong and speech)
+
+   The event script (default: the events.txt of the data directory) is started at once like with
+   'x' on the serial console. After the given time (default 60 s) a summary is printed:
+
+     loop() latency   simulated time of a loop() pass: waiting for locks, UART and network
+                      (computing takes no simulated time - so it is the same on every run)
+     loop() CPU       host CPU time of a loop() pass (not deterministic, not comparable to the ESP32)
+     heap             like ESP.getFreeHeap(): allocations of the sketch, without the stand-ins
+     UART             bytes and write() calls of the sketch, time blocked on the transmit FIFO
+
+   Serial output of the sketch: RADIO_TEST_VERBOSE=1
+*/
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <time.h>
+#include <vector>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include "config.h"
+
+void setup();
+void loop();
+
+constexpr time_t simulationStartTime = 1714982400;   // Monday, 2024-05-06 10:00 CEST: in the fuel scan window
+constexpr unsigned long defaultDuration = 60;         // seconds
+constexpr int32_t simulationLimitDiesel = 140;        // cents
+constexpr int32_t simulationLimitSuper = 150;
+constexpr size_t simulationDocumentSize = 16384;
+constexpr size_t speechSize = 6000;                   // bytes of a TTS answer (1.5 s at 32 kbit/s)
+
+// the clock of the sketch follows the simulated time
+extern "C" time_t time(time_t* result) noexcept
+{
+  time_t now = simulationStartTime + millis() / 1000;
+  if (result)
+  {
+    *result = now;
+  }
+  return now;
+}
+
+static bool readJson(const std::filesystem::path& path, JsonDocument& doc)
+{
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream content;
+  content << file.rdbuf();
+  DeserializationError error = deserializeJson(doc, content.str().c_str());
+  if (!file || error)
+  {
+    fprintf(stderr, "radio_sim: %s: %s\n", path.c_str(), file ? error.c_str() : "not readable");
+    return false;
+  }
+  return true;
+}
+
+static bool addNetworks(const std::filesystem::path& dataDirectory)
+{
+  DynamicJsonDocument doc(simulationDocumentSize);
+  if (!readJson(dataDirectory / "network.json", doc))
+  {
+    return false;
+  }
+  int32_t rssi = -55;
+  for (JsonObject network : doc["NetworkList"].as<JsonArray>())
+  {
+    mockWiFiNetwork(network["ssid"] | "", rssi);
+    rssi -= 10;
+  }
+  return true;
+}
+
+static bool addStations(const std::filesystem::path& dataDirectory)
+{
+  DynamicJsonDocument doc(simulationDocumentSize);
+  if (!readJson(dataDirectory / "stations.json", doc))
+  {
+    return false;
+  }
+  for (JsonObject station : doc["StationList"].as<JsonArray>())
+  {
+    std::string url = station["url"] | "";
+    std::string title = std::string(station["name"] | "") + " - Nachrichten";
+    if (url.find(".m3u") != std::string::npos)
+    {
+      std::string stream = std::string("http://stream.radio.example/") + (station["key"] | "") + ".mp3";
+      mockHttpResponse(url.c_str(), 200, "audio/x-mpegurl", "#EXTM3U\n" + stream + "\n");
+      mockHttpResponse(stream.c_str(), 200, "audio/mpeg", title);
+    }
+    else if (url.find(".pls") != std::string::npos)
+    {
+      std::string stream = std::string("http://stream.radio.example/") + (station["key"] | "") + ".mp3";
+      mockHttpResponse(url.c_str(), 200, "audio/x-scpls", "[playlist]\nFile1=" + stream + "\n");
+      mockHttpResponse(stream.c_str(), 200, "audio/mpeg", title);
+    }
+    else
+    {
+      mockHttpResponse(url.c_str(), 200, "audio/mpeg", title);
+    }
+  }
+  return true;
+}
+
+static bool addFuelStations(const std::filesystem::path& dataDirectory)
+{
+  DynamicJsonDocument doc(simulationDocumentSize);
+  if (!readJson(dataDirectory / "tanken.json", doc))
+  {
+    return false;
+  }
+  std::string body = "{\"ok\":true,\"license\":\"CC BY 4.0 -  https://creativecommons.tankerkoenig.de\",\"data\":\"MTS-K\",\"prices\":{";
+  int count = 0;
+  for (JsonObject station : doc["StationList"].as<JsonArray>())
+  {
+    char prices[128];
+    snprintf(prices, sizeof(prices), "%s\"%s\":{\"status\":\"open\",\"e5\":1.719,\"e10\":1.699,\"diesel\":%s}",
+             count ? "," : "", station["key"] | "", count ? "1.579" : "1.379");
+    body += prices;
+    count++;
+  }
+  body += "}}";
+  mockHttpResponse(doc["APIurl"] | fuelPricesUrl, 200, "application/json", body);
+  // TTS service of the sketch (ttsUrl) and of the library
+  mockHttpResponse("https://translate.google.com/translate_tts", 200, "audio/mpeg", std::string(speechSize, '\xff'));
+
+  // limits as set on the display
+  Preferences prefs;
+  prefs.begin(settingsNamespace);
+  prefs.putInt(settingsKeyLimitDiesel, simulationLimitDiesel);
+  prefs.putInt(settingsKeyLimitSuper, simulationLimitSuper);
+  prefs.end();
+  mockNextionValue("currentLimitDiesel", simulationLimitDiesel);
+  mockNextionValue("currentLimitSuper", simulationLimitSuper);
+  return true;
+}
+
+static unsigned long getCpuTime()
+{
+  // microseconds of this thread (loop task)
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+int main(int argc, char* argv[])
+{
+  if ((argc < 2) || (argc > 4))
+  {
+    fprintf(stderr, "usage: %s <data directory> [<seconds>] [<event script>]\n", argv[0]);
+    return 2;
+  }
+  unsigned long duration = (argc > 2) ? strtoul(argv[2], NULL, 10) : defaultDuration;
+  std::vector<unsigned long> latencies;
+  {
+    // the simulation itself is not part of the firmware heap
+    MockHeapUntracked untracked;
+    std::filesystem::path dataDirectory = argv[1];
+    std::error_code error;
+    std::filesystem::copy(dataDirectory, mockFileSystemRoot(),
+                          std::filesystem::copy_options::recursive | std::filesystem::copy_options::overwrite_existing, error);
+    if (!error && (argc > 3))
+    {
+      std::filesystem::copy_file(argv[3], std::string(mockFileSystemRoot()) + eventScriptFile,
+                                 std::filesystem::copy_options::overwrite_existing, error);
+    }
+    if (error)
+    {
+      fprintf(stderr, "radio_sim: %s\n", error.message().c_str());
+      return 2;
+    }
+    if (!addNetworks(dataDirectory) || !addStations(dataDirectory) || !addFuelStations(dataDirectory))
+    {
+      return 2;
+    }
+    latencies.reserve(duration * 1000);
+  }
+
+  mockStartScheduler();
+  unsigned long startTime = millis();
+  setup();
+  unsigned long setupTime = millis() - startTime;
+  mockSerialInput("x");
+
+  // loop task: one loop() pass, then the other tasks get the core for a tick
+  unsigned long endTime = millis() + duration * 1000;
+  unsigned long sumCpuTime = 0;
+  unsigned long maxCpuTime = 0;
+  while (millis() < endTime)
+  {
+    unsigned long loopStartTime = millis();
+    unsigned long cpuStartTime = getCpuTime();
+    loop();
+    unsigned long cpuTime = getCpuTime() - cpuStartTime;
+    {
+      MockHeapUntracked untracked;
+      latencies.push_back(millis() - loopStartTime);
+    }
+    sumCpuTime += cpuTime;
+    maxCpuTime = max(maxCpuTime, cpuTime);
+    delay(1);
+  }
+
+  size_t passes = latencies.size();
+  unsigned long sumLatency = 0;
+  for (unsigned long latency : latencies)
+  {
+    sumLatency += latency;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  MockUartStatistics display = mockUartStatistics(2);
+  MockUartStatistics console = mockUartStatistics(0);
+  printf("radio_sim: %lu s simulated after setup() (%lu ms), %zu loop() passes\n", duration, setupTime, passes);
+  if (passes)
+  {
+    printf("  loop() latency (simulated) : avg %.3f ms, 99%% %lu ms, max %lu ms\n",
+           (double)sumLatency / passes, latencies[passes * 99 / 100], latencies.back());
+    printf("  loop() CPU (host)          : avg %.1f us, max %lu us\n", (double)sumCpuTime / passes, maxCpuTime);
+  }
+  printf("  heap                       : %zu bytes used, peak %zu, free min %u\n", mockHeapUsed(), mockHeapPeak(), ESP.getMinFreeHeap());
+  printf("  Serial2 (display)          : %u bytes in %u writes, blocked %lu ms (max %lu ms), %u bytes read\n",
+         display.bytesWritten, display.writeCalls, display.blockedTime, display.maxBlockedTime, display.bytesRead);
+  printf("  Serial (console)           : %u bytes in %u writes\n", console.bytesWritten, console.writeCalls);
+  fflush(stdout);
+  return 0;
+}
@@ -0,0 +1,9 @@
+/*
+   radio.ino and util.ino as one translation unit, like the Arduino IDE builds the sketch:
+   the prototypes of their functions (generated by CMake) come first.
+*/
+#include <Arduino.h>
+#include "sketch_prototypes.h"
+
+#include "radio.ino"
+#include "util.ino"
@@ -0,0 +1,83 @@
+#include "unittest.h"
+#include "eventqueue.h"
+
+enum class TestEvent { NONE, FIRST, SECOND, THIRD };
+
+static void testOrder()
+{
+  EventQueue<int, 4> queue;
+  int value = 0;
+
+  CHECK(!queue.pop(value));
+  CHECK(queue.push(1));
+  CHECK(queue.push(2));
+  CHECK_EQUAL(2, queue.size());
+  CHECK(queue.pop(value));
+  CHECK_EQUAL(1, value);
+  CHECK(queue.pop(value));
+  CHECK_EQUAL(2, value);
+  CHECK(!queue.pop(value));
+  CHECK_EQUAL(0, queue.size());
+}
+
+static void testOverflow()
+{
+  // a full queue drops the new event, not the oldest
+  EventQueue<int, 4> queue;
+  int value = 0;
+
+  for (int count = 0; count < 4; count++)
+  {
+    CHECK(queue.push(count));
+  }
+  CHECK(!queue.push(4));
+  CHECK_EQUAL(1, queue.getOverflowCount());
+  CHECK(queue.pop(value));
+  CHECK_EQUAL(0, value);
+  CHECK(queue.push(5));
+  for (int expected : {1, 2, 3, 5})
+  {
+    CHECK(queue.pop(value));
+    CHECK_EQUAL(expected, value);
+  }
+}
+
+static void testWrapAround()
+{
+  // free running indices: many more events than slots
+  EventQueue<TestEvent, 2> queue;
+  TestEvent event = TestEvent::NONE;
+
+  for (int count = 0; count < 1000; count++)
+  {
+    TestEvent pushed = (count & 1) ? TestEvent::FIRST : TestEvent::SECOND;
+    CHECK(queue.push(pushed));
+    CHECK(queue.pop(event));
+    CHECK(event == pushed);
+  }
+  CHECK_EQUAL(0, queue.getOverflowCount());
+}
+
+static void testClear()
+{
+  EventQueue<TestEvent, 8> queue;
+  TestEvent event = TestEvent::NONE;
+
+  queue.push(TestEvent::FIRST);
+  queue.push(TestEvent::SECOND);
+  queue.clear();
+  CHECK_EQUAL(0, queue.size());
+  CHECK(!queue.pop(event));
+  queue.push(TestEvent::THIRD);
+  CHECK(queue.pop(event));
+  CHECK(event == TestEvent::THIRD);
+}
+
+int main()
+{
+  testOrder();
+  testOverflow();
+  testWrapAround();
+  testClear();
+  return testResult();
+}
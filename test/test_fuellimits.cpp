@@ -0,0 +1,191 @@
+#include "unittest.h"
+#include "fuelstationstest.h"
+
+using Status = FuelPriceResult::Status;
+
+static const uint32_t stations = 40;   // two mask words
+static FuelStations fuelStations;
+
+static void setAllPrices(float diesel)
+{
+  for (uint32_t station = 0; station < stations; station++)
+  {
+    FuelStationsTest::setResult(fuelStations, station, Status::OPEN, diesel, 1.999, 1.999);
+  }
+}
+
+static bool isNew(uint32_t station, FuelType fuelType)
+{
+  for (uint32_t index = 0; index < fuelStations.getNumberOfNewAlarms(); index++)
+  {
+    if ((fuelStations.getNewAlarm(index).station == station) && (fuelStations.getNewAlarm(index).fuelType == fuelType))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool isCleared(uint32_t station, FuelType fuelType)
+{
+  for (uint32_t index = 0; index < fuelStations.getNumberOfClearedAlarms(); index++)
+  {
+    if ((fuelStations.getClearedAlarm(index).station == station) && (fuelStations.getClearedAlarm(index).fuelType == fuelType))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void update()
+{
+  FuelStationsTest::applyPrices(fuelStations);
+  fuelStations.checkLimits();
+}
+
+static void testBelowLimitMask()
+{
+  int16_t prices[32] = {0};
+
+  prices[0] = 1599;       // below
+  prices[1] = 1600;       // at the limit: not below
+  prices[2] = 1601;
+  prices[3] = 0;          // no price
+  prices[31] = 1000;
+  CHECK_EQUAL(0x80000001UL, belowLimitMask(prices, 1600));
+  CHECK_EQUAL(0x80000003UL, belowLimitMask(prices, 1601));
+  CHECK_EQUAL(0x0UL, belowLimitMask(prices, 1000));
+  for (uint32_t bit = 0; bit < 32; bit++)
+  {
+    prices[bit] = 1 + bit;
+  }
+  CHECK_EQUAL(0xFFFFFFFFUL, belowLimitMask(prices, 1700));
+  CHECK_EQUAL(0x0000FFFFUL, belowLimitMask(prices, 17));
+}
+
+static void testNewAndCleared()
+{
+  setAllPrices(1.700);
+  update();
+  CHECK(!fuelStations.isAlarmActive());
+  CHECK_EQUAL(0, fuelStations.getNumberOfNewAlarms());
+
+  // station of the second mask word
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.590, 1.999, 1.999);
+  update();
+  CHECK(fuelStations.isAlarmActive());
+  CHECK_EQUAL(1, fuelStations.getNumberOfNewAlarms());
+  CHECK(isNew(35, FuelType::DIESEL));
+  CHECK(fuelStations.getAlarm(35, FuelType::DIESEL));
+  CHECK_EQUAL(35, fuelStations.getCurrentStationIndex());
+
+  // unchanged: no delta
+  update();
+  CHECK_EQUAL(0, fuelStations.getNumberOfNewAlarms());
+  CHECK_EQUAL(0, fuelStations.getNumberOfClearedAlarms());
+
+  // a second station: only the new one is listed
+  FuelStationsTest::setResult(fuelStations, 3, Status::OPEN, 1.550, 1.999, 1.999);
+  update();
+  CHECK_EQUAL(1, fuelStations.getNumberOfNewAlarms());
+  CHECK(isNew(3, FuelType::DIESEL));
+}
+
+static void testHysteresis()
+{
+  // active alarm of station 35 is kept inside the band and cleared at limit + band
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.605, 1.999, 1.999);
+  update();
+  CHECK(fuelStations.getAlarm(35, FuelType::DIESEL));
+  CHECK_EQUAL(0, fuelStations.getNumberOfClearedAlarms());
+
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.600 + fuelAlarmHysteresis / 1000.0, 1.999, 1.999);
+  update();
+  CHECK(!fuelStations.getAlarm(35, FuelType::DIESEL));
+  CHECK_EQUAL(1, fuelStations.getNumberOfClearedAlarms());
+  CHECK(isCleared(35, FuelType::DIESEL));
+
+  // inside the band without active alarm: no new alarm
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.605, 1.999, 1.999);
+  update();
+  CHECK(!fuelStations.getAlarm(35, FuelType::DIESEL));
+}
+
+static void testReannounce()
+{
+  // below again within fuelReannounceInterval: active, but not listed again
+  mockAdvanceMillis(60 * 1000);
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.590, 1.999, 1.999);
+  update();
+  CHECK(fuelStations.getAlarm(35, FuelType::DIESEL));
+  CHECK_EQUAL(0, fuelStations.getNumberOfNewAlarms());
+
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.700, 1.999, 1.999);
+  update();
+  CHECK(isCleared(35, FuelType::DIESEL));
+
+  mockAdvanceMillis(fuelReannounceInterval);
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.590, 1.999, 1.999);
+  update();
+  CHECK(isNew(35, FuelType::DIESEL));
+}
+
+static void testClosedAndMissing()
+{
+  // closed, missing in the answer or without prices: the alarm is cleared
+  FuelStationsTest::setResult(fuelStations, 3, Status::CLOSED);
+  update();
+  CHECK(!fuelStations.isStationOpen(3));
+  CHECK(isCleared(3, FuelType::DIESEL));
+
+  FuelStationsTest::setResult(fuelStations, 35, Status::MISSING);
+  update();
+  CHECK(!fuelStations.isStationOpen(35));
+  CHECK(isCleared(35, FuelType::DIESEL));
+  CHECK(!fuelStations.isAlarmActive());
+
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.590, 1.999, 1.999);
+  update();
+  CHECK(fuelStations.getAlarm(35, FuelType::DIESEL));
+  FuelStationsTest::setResult(fuelStations, 35, Status::NO_PRICES);
+  update();
+  CHECK(!fuelStations.getAlarm(35, FuelType::DIESEL));
+
+  // all stations closed after failed updates
+  FuelStationsTest::setResult(fuelStations, 35, Status::OPEN, 1.590, 1.999, 1.999);
+  update();
+  fuelStations.updatePrices(true);
+  fuelStations.checkLimits();
+  CHECK(!fuelStations.isAlarmActive());
+  CHECK(isCleared(35, FuelType::DIESEL));
+}
+
+static void testListLength()
+{
+  // more changes than fuelAlarmListLength: the list is cut, the masks are complete
+  mockAdvanceMillis(fuelReannounceInterval);
+  setAllPrices(1.500);
+  update();
+  CHECK_EQUAL(fuelAlarmListLength, fuelStations.getNumberOfNewAlarms());
+  for (uint32_t station = 0; station < stations; station++)
+  {
+    CHECK(fuelStations.getAlarm(station, FuelType::DIESEL));
+  }
+}
+
+int main()
+{
+  FuelStationsTest::createStations(fuelStations, stations);
+  fuelStations.setLimit(FuelType::DIESEL, 160);
+  fuelStations.setLimit(FuelType::SUPER, 150);
+  fuelStations.setLimit(FuelType::SUPER_E10, 150);
+
+  testBelowLimitMask();
+  testNewAndCleared();
+  testHysteresis();
+  testReannounce();
+  testClosedAndMissing();
+  testListLength();
+  return testResult();
+}
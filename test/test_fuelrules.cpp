@@ -0,0 +1,128 @@
+#include "unittest.h"
+#include "fuelstationstest.h"
+
+// Monday 2023-11-20 07:00 UTC
+static const time_t monday7 = 1700463600;
+
+static FuelStations fuelStations;
+
+// prices of three stations in tenth cent; station 1 is "S1"
+static int16_t diesel[32] = {1600, 1600, 1700};
+static int16_t e5[32] = {1800, 1800, 1800};
+static int16_t e10[32] = {1750, 1700, 1710};
+static int16_t* const prices[numberOfFuelTypes] = {diesel, e5, e10};
+static uint32_t openStations = 0x7;
+
+static uint32_t evaluate(FuelRules& rules, time_t time, uint32_t fuel, uint32_t active = 0)
+{
+  uint32_t alarms[numberOfFuelTypes] = {0, 0, 0};
+  uint32_t activeAlarms[numberOfFuelTypes] = {0, 0, 0};
+  uint32_t* const alarmColumns[numberOfFuelTypes] = {&alarms[0], &alarms[1], &alarms[2]};
+  uint32_t* const activeColumns[numberOfFuelTypes] = {&activeAlarms[0], &activeAlarms[1], &activeAlarms[2]};
+
+  activeAlarms[fuel] = active;
+  rules.evaluate(prices, &openStations, time, activeColumns, fuelAlarmHysteresis, alarmColumns);
+  return alarms[fuel];
+}
+
+static void testCompile()
+{
+  FuelRules rules;
+  rules.begin(3);
+
+  CHECK(rules.compile(fuelStations, "S1", "diesel", "1-5", "6-9", 1.65, 0, false));
+  CHECK(rules.compile(fuelStations, "id2", "e5", NULL, NULL, 1.75, 0, false));
+  CHECK(rules.compile(fuelStations, "*", "*", NULL, NULL, 0, 0, true));
+  CHECK_EQUAL(3, rules.getNumberOfRules());
+
+  // rejected: unknown station or fuel, bad ranges, no condition
+  CHECK(!rules.compile(fuelStations, "X", "e10", NULL, NULL, 1.5, 0, false));
+  CHECK(!rules.compile(fuelStations, NULL, "gas", NULL, NULL, 1.5, 0, false));
+  CHECK(!rules.compile(fuelStations, NULL, "e10", NULL, "9-30", 1.5, 0, false));
+  CHECK(!rules.compile(fuelStations, NULL, "e10", "0-3", NULL, 1.5, 0, false));
+  CHECK(!rules.compile(fuelStations, NULL, "e10", NULL, NULL, 0, 0, false));
+  CHECK_EQUAL(3, rules.getNumberOfRules());
+}
+
+static void testLimitAndWindow()
+{
+  FuelRules rules;
+  rules.begin(3);
+  rules.compile(fuelStations, "S1", "diesel", "1-5", "6-9", 1.65, 0, false);
+
+  CHECK_EQUAL(0x2, evaluate(rules, monday7, 0));
+  // hours are end exclusive: 9:00 is outside of "6-9"
+  CHECK_EQUAL(0x0, evaluate(rules, monday7 + 2 * 3600, 0));
+  CHECK_EQUAL(0x0, evaluate(rules, monday7 + 5 * 86400, 0));       // Saturday
+  CHECK_EQUAL(0x0, evaluate(rules, monday7, 1));                   // other fuel type
+  // closed stations never raise an alarm
+  openStations = 0x5;
+  CHECK_EQUAL(0x0, evaluate(rules, monday7, 0));
+  openStations = 0x7;
+}
+
+static void testHysteresis()
+{
+  FuelRules rules;
+  rules.begin(3);
+  rules.compile(fuelStations, "S1", "diesel", NULL, NULL, 1.60, 0, false);
+
+  // 1.600 is not below 1.60; an active alarm is kept up to limit + band
+  CHECK_EQUAL(0x0, evaluate(rules, monday7, 0));
+  CHECK_EQUAL(0x2, evaluate(rules, monday7, 0, 0x2));
+  diesel[1] = 1600 + fuelAlarmHysteresis;
+  CHECK_EQUAL(0x0, evaluate(rules, monday7, 0, 0x2));
+  diesel[1] = 1600;
+}
+
+static void testCheapest()
+{
+  FuelRules rules;
+  rules.begin(3);
+  rules.compile(fuelStations, NULL, "e10", NULL, NULL, 0, 0, true);
+
+  CHECK_EQUAL(0x2, evaluate(rules, monday7, 2));
+  // the cheapest station closes: the next one takes over
+  openStations = 0x5;
+  CHECK_EQUAL(0x4, evaluate(rules, monday7, 2));
+  openStations = 0x7;
+}
+
+static void testAverage()
+{
+  FuelRules rules;
+  rules.begin(3);
+  rules.compile(fuelStations, "S0", "e5", NULL, NULL, 0, 0.05, false);
+
+  // no alarm before fuelAverageMinAge of samples
+  rules.updateAverages(prices, &openStations, monday7);
+  CHECK_EQUAL(1800, rules.getAverage(0, 1));
+  e5[0] = 1740;
+  CHECK_EQUAL(0x0, evaluate(rules, monday7 + 600, 1));
+
+  e5[0] = 1800;
+  for (time_t time = monday7 + 600; time <= monday7 + 2 * 86400; time += 600)
+  {
+    rules.updateAverages(prices, &openStations, time);
+  }
+  CHECK_EQUAL(1800, rules.getAverage(0, 1));
+  e5[0] = 1760;
+  CHECK_EQUAL(0x0, evaluate(rules, monday7 + 2 * 86400 + 1, 1));
+  e5[0] = 1750;
+  CHECK_EQUAL(0x1, evaluate(rules, monday7 + 2 * 86400 + 1, 1));
+  e5[0] = 1800;
+}
+
+int main()
+{
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  FuelStationsTest::createStations(fuelStations, 3);
+
+  testCompile();
+  testLimitAndWindow();
+  testHysteresis();
+  testCheapest();
+  testAverage();
+  return testResult();
+}
@@ -0,0 +1,119 @@
+#include "unittest.h"
+#include "fuelstationstest.h"
+#include "pricehistory.h"
+
+using Status = FuelPriceResult::Status;
+
+static const uint32_t stations = 3;
+static const time_t startTime = 1700000040;   // full minute
+static const time_t cycleTime = 600;
+static FuelStations fuelStations;
+
+// prices of one update cycle; Diesel changes by more than a delta record can hold
+static bool isOpen(uint32_t cycle, uint32_t station)
+{
+  return (cycle + station) % 7 != 0;
+}
+
+static int16_t dieselPrice(uint32_t cycle, uint32_t station)
+{
+  return 1500 + (cycle * 7 + station * 131) % 300;
+}
+
+static int16_t e5Price(uint32_t cycle)
+{
+  return 1700 + cycle % 5;
+}
+
+static void addCycle(PriceHistory& history, uint32_t cycle)
+{
+  for (uint32_t station = 0; station < stations; station++)
+  {
+    if (isOpen(cycle, station))
+    {
+      FuelStationsTest::setResult(fuelStations, station, Status::OPEN, dieselPrice(cycle, station) / 1000.0, e5Price(cycle) / 1000.0, 1.650);
+    }
+    else
+    {
+      FuelStationsTest::setResult(fuelStations, station, Status::CLOSED);
+    }
+  }
+  FuelStationsTest::applyPrices(fuelStations);
+  CHECK(history.add(fuelStations, startTime + cycle * cycleTime));
+}
+
+// all samples of the window [first, last] match the written prices
+static void checkWindow(PriceHistory& history, uint32_t first, uint32_t last)
+{
+  PriceHistoryReader reader(history);
+  PriceSample sample;
+  uint32_t count = 0;
+  uint32_t wrong = 0;
+
+  CHECK(reader.begin(startTime + first * cycleTime, startTime + last * cycleTime));
+  while (reader.next(sample))
+  {
+    uint32_t cycle = (sample.time - startTime) / cycleTime;
+    bool isCorrect = ((sample.time - startTime) % cycleTime == 0) && (cycle >= first) && (cycle <= last) &&
+                     (sample.isOpen == isOpen(cycle, sample.station));
+    if (sample.isOpen)
+    {
+      isCorrect = isCorrect && (sample.diesel == dieselPrice(cycle, sample.station)) && (sample.e5 == e5Price(cycle)) && (sample.e10 == 1650);
+    }
+    if (!isCorrect && (wrong++ < 5))
+    {
+      printf("cycle %u station %u: open %d diesel %d e5 %d e10 %d\n", cycle, sample.station, sample.isOpen, sample.diesel, sample.e5, sample.e10);
+    }
+    count++;
+  }
+  CHECK_EQUAL(0, wrong);
+  CHECK_EQUAL((last - first + 1) * stations, count);
+}
+
+static void testEncodeDecode()
+{
+  PriceHistory history;
+  CHECK(history.begin());
+  for (uint32_t cycle = 0; cycle < 3000; cycle++)
+  {
+    addCycle(history, cycle);
+  }
+  // several segments: windows inside one segment and across segment borders
+  CHECK(history.getLastSegment() > history.getFirstSegment());
+  checkWindow(history, 0, 99);
+  checkWindow(history, 1000, 2999);
+  checkWindow(history, 2999, 2999);
+}
+
+static void testRestart()
+{
+  // the decoder state of the last segment is restored: the next deltas continue correctly
+  PriceHistory history;
+  CHECK(history.begin());
+  addCycle(history, 3000);
+  addCycle(history, 3001);
+  checkWindow(history, 2990, 3001);
+}
+
+static void testSegmentLimit()
+{
+  // the oldest segments are removed
+  PriceHistory history;
+  CHECK(history.begin());
+  for (uint32_t cycle = 3002; cycle < 16000; cycle++)
+  {
+    addCycle(history, cycle);
+  }
+  CHECK(history.getLastSegment() - history.getFirstSegment() + 1 <= historyMaxSegments);
+  checkWindow(history, 15000, 15999);
+}
+
+int main()
+{
+  FuelStationsTest::createStations(fuelStations, stations);
+
+  testEncodeDecode();
+  testRestart();
+  testSegmentLimit();
+  return testResult();
+}
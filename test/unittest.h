@@ -0,0 +1,46 @@
+#pragma once
+/*
+   Minimal checks for the host tests: a failed check is reported with its line and the test
+   continues; main() returns testResult() so that ctest sees the failure.
+*/
+#include <stdio.h>
+
+static int failedChecks = 0;
+static int passedChecks = 0;
+
+#define CHECK(condition)                                                        \
+  do                                                                            \
+  {                                                                             \
+    if (condition)                                                              \
+    {                                                                           \
+      passedChecks++;                                                           \
+    }                                                                           \
+    else                                                                        \
+    {                                                                           \
+      failedChecks++;                                                           \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);      \
+    }                                                                           \
+  } while (0)
+
+#define CHECK_EQUAL(expected, actual)                                           \
+  do                                                                            \
+  {                                                                             \
+    long long expectedValue = (long long)(expected);                            \
+    long long actualValue = (long long)(actual);                                \
+    if (expectedValue == actualValue)                                           \
+    {                                                                           \
+      passedChecks++;                                                           \
+    }                                                                           \
+    else                                                                        \
+    {                                                                           \
+      failedChecks++;                                                           \
+      printf("%s:%d: check failed: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, \
+             #expected, #actual, expectedValue, actualValue);                   \
+    }                                                                           \
+  } while (0)
+
+static int testResult()
+{
+  printf("%d checks passed, %d failed\n", passedChecks, failedChecks);
+  return failedChecks ? 1 : 0;
+}